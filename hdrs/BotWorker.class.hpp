@@ -0,0 +1,80 @@
+#ifndef BOTWORKER_CLASS_HPP
+#define BOTWORKER_CLASS_HPP
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include "ChannelRegistry.class.hpp" // ChannelRef
+#include "ClientTable.class.hpp" // ClientRef
+#include "SpscQueue.class.hpp"
+
+#define BOT_QUEUE_SLOTS 64 // requests waiting for the bot, then dropped
+
+// a message the bot should answer, see botSubscribe
+// by reference, not by name or id: a nick can change hands before the
+// answer, and a channel id be given to a new channel
+struct BotRequest
+{
+	ClientRef	requester;
+	ChannelRef	channel; // id -1 for a private message
+	std::string	text;
+};
+
+// its answer, one NOTICE per line, in order
+struct BotReply
+{
+	ClientRef					requester;
+	ChannelRef					channel;
+	std::vector<std::string>	lines;
+};
+
+// The bot's answers are computed on their own thread.
+// The reactor pushes requests and takes replies, it never waits:
+// a request that does not fit is dropped, and a pipe (wakeFd) makes
+// poll() return when replies are ready. answer only sees its request,
+// never the State.
+// Example: w.push(req); ... poll(wakeFd()) ... w.front(), w.pop()
+class BotWorker
+{
+	public:
+		typedef void answer_fn(const BotRequest &, BotReply &);
+
+		explicit BotWorker(answer_fn *answer);
+		~BotWorker(); // stops the thread
+
+		int			start(); // OK, or ERROR if the thread can't start
+		void		stop();
+		bool		running() const;
+
+		// reactor side, never blocks
+		bool		push(const ClientRef &requester, const ChannelRef &channel,
+						const std::string &text);
+		BotReply	*front(); // NULL if no reply is ready
+		void		pop();
+		int			wakeFd() const; // readable when replies are ready
+		void		clearWake(); // empties wakeFd before front()
+		size_t		dropped() const; // requests over BOT_QUEUE_SLOTS
+
+	private:
+		answer_fn								*_answer;
+		SpscQueue<BotRequest, BOT_QUEUE_SLOTS>	_requests;
+		SpscQueue<BotReply, BOT_QUEUE_SLOTS>	_replies;
+		pthread_t								_thread;
+		int										_to_worker[2];
+		int										_to_reactor[2];
+		bool									_running;
+		int										_stopping; // atomic
+		size_t									_dropped;
+
+		static void	*run(void *worker);
+		void		loop();
+		BotReply	*waitReplySlot(); // NULL if stopping
+
+		BotWorker();
+		BotWorker(const BotWorker &);
+		BotWorker &operator=(const BotWorker &);
+};
+
+#endif // #ifndef BOTWORKER_CLASS_HPP
@@ -0,0 +1,69 @@
+#ifndef CAPTURE_CLASS_HPP
+#define CAPTURE_CLASS_HPP
+
+#include <istream>
+#include <string>
+
+#include <stdint.h> // uint8_t, int32_t, uint64_t, uint32_t
+
+#include "LogRing.class.hpp"
+
+#define CAPTURE_MAGIC "ircap001" // the first 8 bytes of a capture file
+#define CAPTURE_MAX_DATA LOG_RING_BYTES // bytes of an entry, the ring's size
+
+enum e_capture
+{
+	CAPTURE_ACCEPT,
+	CAPTURE_DATA, // the bytes of one recv()
+	CAPTURE_CLOSE,
+	CAPTURE_DROPPED // the ring was full, fd entries lost: the last entry
+};
+
+// one entry of a capture file, 17 bytes in native byte order,
+// followed by length bytes of data
+struct CaptureEntry
+{
+	uint8_t		type;
+	int32_t		fd;
+	uint64_t	usec; // monotonic clock, since the capture was opened
+	uint32_t	length;
+};
+
+// Everything a client sent, for ircreplay (srcs/replay.cpp).
+// The entries go through a LogRing like the logs, the reactor only
+// copies them and a background thread appends them to the file.
+// A replay needs every entry: the first one the ring can't take ends
+// the capture, the file then ends with CAPTURE_DROPPED.
+// Example: c.open("traffic.cap"); c.received(fd, data, len); c.close()
+class Capture
+{
+	public:
+		Capture();
+		~Capture(); // closes the file
+
+		int		open(const std::string &path); // OK, or ERROR
+		void	close(); // writes what is left first
+		bool	recording() const;
+
+		void	accepted(int fd);
+		void	received(int fd, const char *data, size_t length);
+		void	closed(int fd);
+
+	private:
+		LogRing	_ring;
+		int		_file;
+		uint64_t	_start;
+
+		void	record(e_capture type, int fd, const char *data, size_t length);
+
+		Capture(const Capture &);
+		Capture &operator=(const Capture &);
+};
+
+// false at the end of the file, if it is cut in the middle of an entry,
+// or if an entry is over CAPTURE_MAX_DATA
+bool		readCaptureHeader(std::istream &in);
+bool		readCaptureEntry(std::istream &in, CaptureEntry &entry,
+				std::string &data);
+
+#endif // #ifndef CAPTURE_CLASS_HPP
@@ -0,0 +1,48 @@
+#ifndef CASEMAP_CLASS_HPP
+#define CASEMAP_CLASS_HPP
+
+#include <string>
+#include <vector>
+
+// Hash index from a case-folded name (RFC 1459 casemapping) to an id.
+// Open addressing with linear probing, keys are stored folded and
+// lookups fold on the fly, so finding a name allocates nothing.
+// Example: after insert("Alice[1]", 42), find("ALICE{1}") gives 42
+class CaseMap
+{
+	public:
+		CaseMap();
+
+		int		find(const std::string &key) const; // -1 if not found
+		void	insert(const std::string &key, int value);
+		void	erase(const std::string &key);
+		size_t	size() const;
+		void	clear();
+
+		// A-Z and []\^ lower to a-z and {}|~
+		static char			fold(char c);
+		static std::string	fold(const std::string &str);
+		static bool			equal(const std::string &a, const std::string &b);
+
+	private:
+		enum e_slot { EMPTY, USED, ERASED };
+
+		struct Slot
+		{
+			std::string	key;
+			int			value;
+			e_slot		state;
+
+			Slot() : value(-1), state(EMPTY) {}
+		};
+
+		std::vector<Slot>	_slots;
+		size_t				_used, _erased;
+
+		static size_t	hash(const std::string &key);
+		static bool		matches(const std::string &folded, const std::string &key);
+		size_t			locate(const std::string &key, bool &found) const;
+		void			rehash(size_t capacity);
+};
+
+#endif // #ifndef CASEMAP_CLASS_HPP
@@ -1,15 +1,80 @@
 #ifndef CHANNEL_STRUCT_HPP
 #define CHANNEL_STRUCT_HPP
 
+#include <ctime>
+#include <map>
 #include <string>
-#include <set>
+#include <vector>
+
+#include "dictionary.hpp"
+#include "Message.struct.hpp"
+#include "ModeMask.class.hpp"
+#include "NamesCache.class.hpp"
+#include "Responses.class.hpp"
+
+// per member flags, a member with no flag is a regular user
+enum e_member_flag
+{
+	MEMBER_OP = 1 << 0,
+	MEMBER_VOICE = 1 << 1
+};
+
+struct Member
+{
+	int				fd;
+	unsigned int	flags; // e_member_flag bits
+	std::string		nick; // for the NAMES cache, empty if not registered
+};
+
+// members are kept sorted by fd in one contiguous vector:
+// lookups are binary searches and broadcasts a linear scan
+typedef std::vector<Member> Members;
 
 struct Channel
 {
+	int id; // given by ChannelRegistry, stands for the name
 	std::string name, topic, key;
-	std::set<int> client_ids, op_ids, invited_ids;
-	std::set<char> modes;
+	Members members;
+	std::map<int, time_t> invites; // fd -> expiry, see INVITE_TTL
+	ModeMask modes;
 	size_t userlimit;
+	NamesCache names; // RPL_NAMREPLY chunks, follows members and nicks
+
+	Channel();
+
+	// back to a new channel, the containers keep their capacity
+	void	clear();
+
+	bool	isMember(int fd) const;
+	size_t	size() const;
+	bool	empty() const;
+	void	addMember(int fd, unsigned int flags = 0,
+				const std::string &nick = "");
+	void	removeMember(int fd);
+	void	renameMember(int fd, const std::string &nick);
+
+	bool	hasFlag(int fd, e_member_flag flag) const;
+	void	setFlag(int fd, e_member_flag flag, bool on);
+	size_t	countFlag(e_member_flag flag) const;
+	bool	isOp(int fd) const; // channel op, not IRC op
+
+	// an invite is used by JOIN, or expires
+	void	invite(int fd, time_t expiry);
+	void	uninvite(int fd);
+	bool	isInvited(int fd) const;
+
+	// bytes of names in one RPL_NAMREPLY sent to a nick of that length
+	size_t	namesBudget(size_t nick_len = NAMES_NICK_ROOM) const;
+
+	// appends a copy of m for each member, except the given fd
+	void	broadcast(const Message &m, Responses &out,
+				int except = -1) const;
+
+private:
+	Members::iterator		find(int fd);
+	Members::const_iterator	find(int fd) const;
+
+	static std::string		namesEntry(const Member &member);
 };
 
 #endif // #ifndef CHANNEL_STRUCT_HPP
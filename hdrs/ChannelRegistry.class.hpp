@@ -0,0 +1,61 @@
+#ifndef CHANNELREGISTRY_CLASS_HPP
+#define CHANNELREGISTRY_CLASS_HPP
+
+#include <string>
+#include <vector>
+
+#include "CaseMap.class.hpp"
+#include "Channel.struct.hpp"
+
+// a channel as seen at one point in time, see ChannelRegistry::ref
+struct ChannelRef
+{
+	int				id; // -1 for none
+	unsigned int	generation;
+};
+
+// Channels interned to small ids, found by name through a case-folded
+// index (RFC 1459 casemapping) and by id through a table.
+// A handler resolves the name once, then works on the Channel or its id.
+// Channels never move: a Channel & stays valid until its erase.
+// Erased channels are cleared and pooled for the next ones, so JOIN/PART
+// churn reuses their strings and members capacity instead of allocating.
+// The pool keeps CHANNEL_POOL_MAX of them, the others are deleted.
+// Each erase bumps the id generation: a ChannelRef taken before the
+// channel was erased no longer resolves, even once its id is reused.
+// Example: channels["#Dice"].id == channels.id("#dice")
+class ChannelRegistry
+{
+	public:
+		ChannelRegistry();
+		~ChannelRegistry();
+
+		// creates the channel if it does not exist, like std::map
+		Channel			&operator[](const std::string &name);
+		Channel			*find(const std::string &name); // NULL if not found
+		const Channel	*find(const std::string &name) const;
+		Channel			*find(int id);
+		const Channel	*find(int id) const;
+		Channel			*find(const ChannelRef &ref); // NULL if stale
+		int				id(const std::string &name) const; // -1 if not found
+		size_t			count(const std::string &name) const;
+		void			erase(int id); // the id is given to the next channel
+		size_t			size() const;
+		bool			empty() const;
+		size_t			pooled() const;
+
+		ChannelRef		ref(int id) const;
+
+	private:
+		std::vector<Channel *>	_channels; // by id, NULL once erased
+		std::vector<unsigned int>	_generations; // by id, erases so far
+		std::vector<int>		_free_ids;
+		std::vector<Channel *>	_pool; // erased, cleared
+		CaseMap					_ids;
+		size_t					_size;
+
+		ChannelRegistry(const ChannelRegistry &);
+		ChannelRegistry &operator=(const ChannelRegistry &);
+};
+
+#endif // #ifndef CHANNELREGISTRY_CLASS_HPP
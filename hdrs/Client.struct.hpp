@@ -4,6 +4,8 @@
 #include <string>
 #include <set>
 
+#include "ModeMask.class.hpp"
+
 enum e_client_status
 {
     CONNECTED, // default
@@ -11,11 +13,29 @@ enum e_client_status
     WELCOMED
 };
 
+// IRCv3 capabilities negotiated with CAP REQ
+enum e_client_cap
+{
+    CAP_MESSAGE_TAGS = 1 << 0,
+    CAP_SERVER_TIME = 1 << 1,
+    CAP_COMPACT = 1 << 2
+};
+
 struct Client
 {
     e_client_status status;
     std::string nick, username, realname;
-    std::set<char> modes;
+    ModeMask modes;
+    std::set<int> channels; // channel ids, mirrors Channel::members
+    std::set<int> invites; // channel ids, mirrors Channel::invites
+    unsigned int caps; // e_client_cap bits
+
+    Client();
+
+    // nick and username are read directly but only changed
+    // through these setters, they re-render the cached prefixes
+    void setNick(const std::string &nick);
+    void setUsername(const std::string &username);
 
     // is this client an IRCop (not channel op)
     bool isOp() const;
@@ -23,13 +43,19 @@ struct Client
     // When the spect indicates <client> as source of a broadcast
     // irssi expects the full hostmask <nick>!<user>@<host>
     // so it can handle for example the clients in a channel correctly
-    std::string hostmask() const;
+    const std::string &hostmask() const;
 
     // when the spec indicates <client> in a numeric response
     // irssi expects just the nick
     // however if the nick is empty we need to use "*"
     // This converter to string does that
-    operator std::string() const;
+    operator const std::string &() const;
+
+private:
+    // rendered on NICK/USER changes only, not on every broadcast
+    std::string _hostmask, _name;
+
+    void render();
 };
 
 #endif // #ifndef CLIENT_STRUCT_HPP
@@ -0,0 +1,62 @@
+#ifndef CLIENTTABLE_CLASS_HPP
+#define CLIENTTABLE_CLASS_HPP
+
+#include <vector>
+
+#include "Client.struct.hpp"
+
+#define CLIENT_CHUNK_SLOTS 64
+
+// a client as seen at one point in time, see ClientTable::ref
+struct ClientRef
+{
+	int				fd;
+	unsigned int	generation;
+};
+
+// Clients indexed by fd, one slot per fd in chunks that never move,
+// so a lookup is an index and a Client & stays valid until erase.
+// Each erase bumps the slot generation: a ClientRef taken before the
+// fd was closed and reused no longer resolves.
+// Example: ref = t.ref(5); t.erase(5); t[5]; t.find(ref) gives NULL
+class ClientTable
+{
+	public:
+		ClientTable();
+		~ClientTable();
+
+		// creates the client if it does not exist, like std::map
+		Client			&operator[](int fd);
+		Client			*find(int fd); // NULL if not found
+		const Client	*find(int fd) const;
+		Client			*find(const ClientRef &ref); // NULL if stale
+		size_t			count(int fd) const;
+		void			erase(int fd);
+		size_t			size() const;
+		bool			empty() const;
+
+		ClientRef		ref(int fd) const;
+		unsigned int	generation(int fd) const;
+
+	private:
+		struct Slot
+		{
+			Client			client;
+			unsigned int	generation;
+			bool			used;
+
+			Slot() : generation(0), used(false) {}
+		};
+
+		std::vector<Slot *>	_chunks;
+		size_t				_size;
+
+		// fds are small and dense, BOT_ID is negative: 0, -1, 1, -2...
+		static size_t	index(int fd);
+		Slot			*slot(int fd) const; // NULL past the last chunk
+
+		ClientTable(const ClientTable &);
+		ClientTable &operator=(const ClientTable &);
+};
+
+#endif // #ifndef CLIENTTABLE_CLASS_HPP
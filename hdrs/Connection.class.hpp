@@ -13,23 +13,35 @@
 #include <sys/types.h>  // socket-related types like socklen_t
 #include <unistd.h>     // close(), read(), write()
 
+#include "Capture.class.hpp"
 #include "colors.hpp"     // UNDERLINE, RESET
 #include "Logs.class.hpp"
+#include "Metrics.class.hpp"
 #include "dictionary.hpp"
 #include "handlers.hpp"
 #include "State.struct.hpp"
 #include "utils.hpp"      // spe_error()
 
+// called when a service fd is readable, its responses are sent as usual
+typedef void service_fn(State &state, Responses &out);
+
 class Connection
 {
 private:
 	struct pollfd				_pfd[MAX_CLIENT];
 	int							_n_fds;
 	std::map<int, std::string>	buffer_in, buffer_out;
+	std::map<int, size_t>		bytes_saved; // by plain replies, until hangUp
 	State						&state;
 	message_handler_fn			*message_handler;
 	Logs						logs;
+	Capture						capture; // off unless startCapture()
+	Metrics						metrics; // off unless startMetrics()
 	std::set<int>				pending_disconnect_fds;
+	std::map<int, service_fn *>	services; // polled after the listening fd
+	std::string					frame;
+	Message						in; // the line being handled
+	Responses					output; // its responses, reset per line
 
 	Connection();
 
@@ -38,9 +50,12 @@ private:
 	int		sendData(int &index);
 	int		receiveData(int &index);
 	int		disconnectClient(int &index);
+	void	runService(int index);
+	void	runMetrics(int &index);
 	int		shrinkArray(int &index);
 	void	closeAll();
 	void	fillRegisterOut(Responses &);
+	void	appendTags(std::string &out, const Message &m, std::string &time);
 	void	onRead(int fd);
 	void	onDisconnect(int fd, int index);
 	void	clearBuffers(int fd);
@@ -51,6 +66,26 @@ public:
 	Connection(State &state, message_handler_fn *message_handler);
 
 	int		pollLoop(int listen_s_fd);
+
+	// an fd of the server itself (the bot's replies), not a client
+	// it is neither read nor closed here, ready has to empty it
+	void	addService(int fd, service_fn *ready);
+
+	// records the accepted clients and all they send, see Capture
+	int		startCapture(const std::string &path);
+
+	// serves the counters of state.stats over HTTP, see Metrics
+	// address: a port on 127.0.0.1, or the path of a Unix socket
+	int		startMetrics(const std::string &address);
+
+	// feeds raw bytes as if received from fd, NOK if the line is too long
+	int		feed(int fd, const char *data, size_t len);
+
+	// as if fd hung up, without a socket: its QUIT, its buffers cleared
+	void	hangUp(int fd);
+
+	// bytes queued for fd, sent and erased by sendData
+	std::string	&pendingOutput(int fd);
 };
 
 #endif // #ifndef CONNECTION_CLASS_HPP
@@ -0,0 +1,59 @@
+#ifndef EVENTBUS_CLASS_HPP
+#define EVENTBUS_CLASS_HPP
+
+#include <vector>
+
+#include "Message.struct.hpp"
+
+struct State;
+class Responses;
+
+// what happened, published by the handlers once it is done
+enum e_event
+{
+	EVENT_JOIN, // fd joined channel
+	EVENT_PART, // fd left channel, which may no longer exist
+	EVENT_QUIT, // fd quit, it is no longer in the state
+	EVENT_PRIVMSG, // fd sent message to target, or to channel
+	EVENT_COUNT
+};
+
+struct Event
+{
+	e_event			type;
+	int				fd;
+	int				channel; // id, -1 if none
+	int				target; // PRIVMSG to a nick, -1 otherwise
+	const Message	*message; // the command that caused it
+};
+
+typedef void event_handler_fn(const Event &, State &, Responses &);
+
+// Services (the bot) subscribe to the events they handle, as a client:
+// a PRIVMSG is only delivered to a subscriber it was sent to, directly
+// or through a channel it is a member of.
+// With no subscriber for a type, publishing it costs a single test.
+// Example: bus.subscribe(EVENT_JOIN, BOT_ID, onJoin)
+class EventBus
+{
+	public:
+		void	subscribe(e_event type, int fd, event_handler_fn *handler);
+		bool	wants(e_event type) const;
+
+		// the handlers may route commands, which publish events in turn
+		void	publish(const Event &event, State &s, Responses &r) const;
+
+	private:
+		struct Subscriber
+		{
+			int					fd;
+			event_handler_fn	*handler;
+		};
+
+		std::vector<Subscriber>	_subscribers[EVENT_COUNT];
+
+		bool	delivered(const Event &event, const Subscriber &sub,
+					const State &s) const;
+};
+
+#endif // #ifndef EVENTBUS_CLASS_HPP
@@ -0,0 +1,83 @@
+#ifndef LOGRING_CLASS_HPP
+#define LOGRING_CLASS_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+
+#include <pthread.h>
+
+#include "SpscQueue.class.hpp" // CACHE_LINE
+
+#define LOG_RING_BYTES (1 << 20) // records waiting for the writer
+#define LOG_BATCH_BYTES (64 << 10) // formatted text per write()
+
+// types of the records made by the ring itself, the others are the user's
+enum e_log_ring
+{
+	LOG_RING_PAD = -1, // the end of the ring, skipped
+	LOG_RING_DROPPED = -2 // value records were lost to a full ring
+};
+
+// the fixed part of a record, its text follows it in the ring
+struct LogRecord
+{
+	int		type;
+	int		fd;
+	long	value;
+	time_t	elapsed; // seconds since the server started
+	size_t	length; // of the text
+};
+
+// Log records go from one producer thread to a writer thread, through
+// a ring of bytes, lock-free (GCC __atomic builtins, like SpscQueue).
+// The producer only copies the record: format turns it into text on
+// the writer thread, which then writes whole batches to the fd.
+// A record that does not fit is dropped and counted, push never waits.
+// The writer sleeps on a pipe, woken only if it said it was sleeping.
+// Example: ring.start(STDOUT_FILENO); ring.push(record, text); ring.stop()
+class LogRing
+{
+	public:
+		typedef void format_fn(const LogRecord &record, const char *text,
+			std::string &out);
+
+		explicit LogRing(format_fn *format);
+		~LogRing(); // stops the thread
+
+		int		start(int fd); // OK, or ERROR if the thread can't start
+		void	stop(); // writes what is left first
+		bool	running() const;
+
+		// producer side, false if dropped
+		bool	push(const LogRecord &record, const char *text);
+		size_t	dropped() const;
+		size_t	queued() const; // bytes not written yet
+
+	private:
+		format_fn	*_format;
+		char		*_bytes; // LOG_RING_BYTES, while running
+		pthread_t	_thread;
+		int			_out;
+		int			_wake[2];
+		bool		_running;
+		int			_stopping; // atomic
+		size_t		_dropped; // atomic
+		size_t		_reported; // dropped count already written
+		std::string	_batch; // the writer's
+		// each index on its own cache line, written by one side only
+		size_t		_head __attribute__((aligned(CACHE_LINE)));
+		size_t		_tail __attribute__((aligned(CACHE_LINE)));
+		int			_sleeping __attribute__((aligned(CACHE_LINE))); // atomic
+
+		static void	*run(void *ring);
+		void		loop();
+		bool		drain(); // false if there was nothing to write
+		void		reportDropped();
+
+		LogRing();
+		LogRing(const LogRing &);
+		LogRing &operator=(const LogRing &);
+};
+
+#endif // #ifndef LOGRING_CLASS_HPP
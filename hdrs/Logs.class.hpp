@@ -5,8 +5,75 @@
 #include <iostream>
 
 #include "colors.hpp"
+#include "LogRing.class.hpp"
 #include "utils.hpp"
 
+// what a record is about, each one has its own rendering
+enum e_log
+{
+	LOG_CONNECT, // value: connected count
+	LOG_DISCONNECT, // value: connected count
+	LOG_BUFFER_IN, // text: the buffer
+	LOG_BUFFER_OUT,
+	LOG_OVER_LIMIT,
+	LOG_BYTES_SAVED, // value: bytes
+	LOG_END_CLIENT,
+	LOG_END_SOCKET,
+	LOG_CLOSE_ALL,
+	LOG_POLL_ERROR, // value: SO_ERROR
+	LOG_BOT_IN, // text: the message
+	LOG_BOT_OUT
+};
+
+// what can be turned down at runtime, see LOGLEVEL and SIGUSR1
+enum e_log_category
+{
+	LOG_CAT_CONNECT, // connections, disconnections, shutdown
+	LOG_CAT_BUFFER, // the bytes read and sent
+	LOG_CAT_ERROR, // poll errors, clients over the limit
+	LOG_CAT_BOT, // the bot's messages
+	LOG_CAT_COUNT
+};
+
+enum e_log_level
+{
+	LOG_LEVEL_OFF,
+	LOG_LEVEL_SHORT, // a buffer is only its size
+	LOG_LEVEL_FULL
+};
+
+// at full, only one record with a text in sample is kept, and only
+// its first max_bytes (0: all of it)
+// Example: {LOG_LEVEL_FULL, 10, 256}: one buffer in 10, cut at 256 bytes
+struct LogConfig
+{
+	e_log_level	level;
+	size_t		sample;
+	size_t		max_bytes;
+};
+
+// everything is logged in full until changed
+void				setLogConfig(e_log_category category, const LogConfig &config);
+const LogConfig		&logConfig(e_log_category category);
+// false if a record of this type would be filtered out, nothing to build
+bool				logWanted(e_log type);
+const char			*logCategoryName(e_log_category category);
+const char			*logLevelName(e_log_level level);
+// LOG_CAT_COUNT or (e_log_level)-1 if unknown
+e_log_category		logCategoryByName(const std::string &name);
+e_log_level			logLevelByName(const std::string &name);
+
+// Once startLogWriter() ran, the logs are only copied into a ring and
+// a background thread renders and writes them to fd, the server never
+// waits for stdout. Until then (tests, benches) they are rendered
+// right away to std::cout.
+int		startLogWriter(int fd);
+void	stopLogWriter(); // writes what is left, back to std::cout
+size_t	logQueueBytes(); // waiting for the writer
+size_t	logsDropped(); // lost to a full ring
+void	pushLog(e_log type, time_t start, int fd, long value,
+			const char *text = "", size_t length = 0);
+
 class Logs
 {
 	public:
@@ -16,7 +83,9 @@ class Logs
 		void	logsDisconnect(int s_fd, int n_fds);
 		void	logsBuffer(int s_fd, std::string &buffer, bool which);
 		void	logsBufferOverLimit(int s_fd);
+		void	logsBytesSaved(int s_fd, size_t bytes);
 		void	logsEnd(int s_fd, bool which);
+		void	logsCloseAll();
 		void	logsError(int s_fd);
 
 	private:
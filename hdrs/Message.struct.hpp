@@ -11,7 +11,24 @@ struct Message
 	std::string source, verb;
 	std::vector<std::string> params;
 
+	// IRCv3 tags in their escaped wire form, without the leading '@'
+	// ("key=value;+client-tag"): all the tags of a message share
+	// this single buffer, values are only unescaped when asked for
+	std::string tags;
+
+	// the tags were over MAX_TAGS_LEN, parse dropped them all
+	// the line is answered with ERR_INPUTTOOLONG, never relayed
+	bool too_long;
+
+	// bytes a plain numeric reply saves over the colored one, counted
+	// per client by Connection once queued, see replies.hpp
+	size_t saved;
+
 	Message(int fd, const std::string &raw);
+
+	// same as the constructor, into an existing message
+	// a message parsed again and again stops allocating
+	void parse(int fd, const std::string &raw);
 	Message(
 		const std::string &source,
 		int fd,
@@ -24,6 +41,21 @@ struct Message
 	// assemble/serialize outcoming message to raw
 	std::string assemble() const;
 
+	// same without the tags, appended to out
+	// so one frame can be shared by all the recipients of a broadcast
+	void assembleBody(std::string &out) const;
+
+	// tags helpers, values are escaped/unescaped in a single pass
+	bool getTag(const std::string &key, std::string &value) const;
+	void addTag(const std::string &key, const std::string &value);
+
+	// only the valid tags starting with '+', the ones a server relays
+	// a key is [+][vendor/]name, a value has no NUL, CR or LF
+	std::string clientTags() const;
+
+	// same frame for another recipient (everything but the fd)
+	bool sameFrame(const Message &other) const;
+
 	// validate message, middle params with no space, verb not empty
 	bool isValid() const;
 
@@ -80,7 +112,4 @@ bool operator==(const Message &msg1, const Message &msg2);
 bool operator==(const Message &msg, const std::string &raw);
 bool operator==(const std::string &raw, const Message &msg);
 
-// easy find a message by its fd, nullptr if not found
-const Message* find_by_fd(const std::vector<Message>& vec, int id);
-
 #endif // #ifndef MESSAGE_STRUCT_HPP
@@ -0,0 +1,60 @@
+#ifndef METRICS_CLASS_HPP
+#define METRICS_CLASS_HPP
+
+#include <map>
+#include <string>
+
+#include "State.struct.hpp"
+
+#define METRICS_MAX_REQUEST 4096 // bytes of headers, the scrape is closed above
+
+// one scrape: its request, then the part of the reply not sent yet
+struct Scrape
+{
+	std::string	request, out;
+	size_t		sent; // bytes of out
+	size_t		section; // the next family to render
+	bool		replying;
+
+	Scrape();
+};
+
+// The counters of the server in the Prometheus text format, served
+// over HTTP on 127.0.0.1 or a Unix socket by the poll() loop itself.
+// A reply is rendered one family at a time, each one once the previous
+// is sent, so a scrape costs the loop a few lines per event and never
+// more than one family of memory. The families are read at different
+// times: each one is consistent, the reply as a whole is not.
+// Example: m.listen("9100"); then curl 127.0.0.1:9100/metrics
+class Metrics
+{
+	public:
+		Metrics();
+		~Metrics(); // closes the listener and the scrapes
+
+		int		listen(const std::string &address); // OK, or ERROR
+		int		listenFd() const; // -1 unless listening
+		bool	owns(int fd) const; // the listener or one of its scrapes
+
+		int		accept(); // the new scrape, or ERROR if none
+		void	drop(int fd);
+
+		// the events to poll fd for next, 0 once it is closed
+		short	ready(int fd, short revents, const State &state);
+
+		// the reply to GET /metrics, all at once (tests)
+		static std::string	render(const State &state);
+
+	private:
+		int						_listen;
+		std::string				_path; // of the Unix socket, removed at the end
+		std::map<int, Scrape>	_scrapes;
+
+		bool	readRequest(int fd, Scrape &scrape);
+		bool	writeReply(int fd, Scrape &scrape, const State &state);
+
+		Metrics(const Metrics &);
+		Metrics &operator=(const Metrics &);
+};
+
+#endif // #ifndef METRICS_CLASS_HPP
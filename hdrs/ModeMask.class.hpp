@@ -0,0 +1,46 @@
+#ifndef MODEMASK_CLASS_HPP
+#define MODEMASK_CLASS_HPP
+
+#include <string>
+
+// one bit per mode letter a-z, a mode check is a single AND
+#define MODE_BIT(c) (1u << ((c) - 'a'))
+
+enum e_mode
+{
+	MODE_INVITE = MODE_BIT('i'),
+	MODE_KEY = MODE_BIT('k'),
+	MODE_LIMIT = MODE_BIT('l'),
+	MODE_OPER = MODE_BIT('o'),
+	MODE_TOPIC = MODE_BIT('t')
+};
+
+// Client and Channel modes, set-like by letter for modestrings
+// Example: insert('t'), insert('i') renders "+it", has(MODE_TOPIC) is true
+class ModeMask
+{
+	public:
+		ModeMask();
+
+		bool		has(unsigned int modes) const { return _bits & modes; }
+		unsigned int bits() const;
+
+		// letters outside a-z are not modes: not counted, not inserted
+		size_t		count(char c) const;
+		void		insert(char c);
+		void		erase(char c);
+		bool		empty() const;
+		void		clear();
+
+		// "+" followed by the letters in alphabetical order
+		std::string	render() const;
+		// reverse of render, the leading '+' is optional
+		static ModeMask	parse(const std::string &modestring);
+
+		static unsigned int bit(char c); // 0 if not a mode letter
+
+	private:
+		unsigned int _bits;
+};
+
+#endif // #ifndef MODEMASK_CLASS_HPP
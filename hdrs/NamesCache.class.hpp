@@ -0,0 +1,37 @@
+#ifndef NAMESCACHE_CLASS_HPP
+#define NAMESCACHE_CLASS_HPP
+
+#include <string>
+#include <vector>
+
+// The RPL_NAMREPLY texts of a channel, kept up to date on each change.
+// Entries ("@alice", "bob") are separated by spaces, in chunks of at
+// most budget bytes so each chunk fits in one reply of MAX_MSG_LEN.
+// A change edits one chunk, NAMES sends the chunks as they are.
+// Example: add("@alice", 400), add("bob", 400) gives {"@alice bob"}
+class NamesCache
+{
+	public:
+		NamesCache();
+
+		const std::vector<std::string>	&chunks() const;
+
+		void	add(const std::string &entry, size_t budget);
+		void	remove(const std::string &entry);
+		void	replace(const std::string &old_entry,
+					const std::string &new_entry, size_t budget);
+		void	clear(); // keeps the capacity of the chunk list
+
+		// the same entries in chunks of a smaller budget
+		void	rechunk(size_t budget, std::vector<std::string> &out) const;
+
+	private:
+		std::vector<std::string>	_chunks;
+		size_t						_bytes; // of entries, without spaces
+		size_t						_budget; // of the last add
+
+		void	repack();
+		static void	split(const std::string &chunk, NamesCache &into);
+};
+
+#endif // #ifndef NAMESCACHE_CLASS_HPP
@@ -0,0 +1,28 @@
+#ifndef RANDOM_CLASS_HPP
+#define RANDOM_CLASS_HPP
+
+#include <cstddef>
+#include <stdint.h> // uint64_t, uint32_t
+
+// xoshiro256** (Blackman, Vigna), seeded through splitmix64.
+// Not for secrets; fast, with no shared state unlike std::rand(),
+// so each thread can own one.
+// Example: Random rng(time(0)); rng.below(6) + 1 is a fair d6
+class Random
+{
+	public:
+		explicit Random(uint64_t seed = 0);
+
+		void		seed(uint64_t seed);
+		uint64_t	next();
+
+		// uniform in [0, n), without the bias of next() % n (Lemire)
+		uint32_t	below(uint32_t n);
+		// count values of below(n), one pass over out
+		void		fill(uint32_t n, uint32_t *out, size_t count);
+
+	private:
+		uint64_t	_s[4];
+};
+
+#endif // #ifndef RANDOM_CLASS_HPP
@@ -0,0 +1,55 @@
+#ifndef RESPONSES_CLASS_HPP
+#define RESPONSES_CLASS_HPP
+
+#include <vector>
+
+#include "Message.struct.hpp"
+
+// The messages a handler produces for one event, read like a vector.
+// clear() keeps the slots: the next push_back assigns into an old
+// Message, whose strings keep their capacity, so a buffer reused for
+// every event stops allocating once it has seen the largest one.
+// Example: r.push_back(m); r.clear(); r.push_back(m) reuses the slot
+class Responses
+{
+	public:
+		typedef std::vector<Message>::iterator			iterator;
+		typedef std::vector<Message>::const_iterator	const_iterator;
+
+		Responses();
+
+		void			push_back(const Message &m);
+		void			clear(); // capacity kept, see above
+		void			reserve(size_t n);
+		size_t			size() const;
+		bool			empty() const;
+
+		Message			&operator[](size_t i);
+		const Message	&operator[](size_t i) const;
+		Message			&at(size_t i); // std::out_of_range past size
+		const Message	&at(size_t i) const;
+		Message			&back();
+		const Message	&back() const;
+
+		iterator		begin();
+		iterator		end();
+		const_iterator	begin() const;
+		const_iterator	end() const;
+
+		// push_back of each message in [first, last)
+		template <typename It>
+		void			append(It first, It last)
+		{
+			for (; first != last; ++first)
+				push_back(*first);
+		}
+
+	private:
+		std::vector<Message>	_slots; // only the first _size are used
+		size_t					_size;
+};
+
+// easy find a message by its fd, nullptr if not found
+const Message* find_by_fd(const Responses &r, int fd);
+
+#endif // #ifndef RESPONSES_CLASS_HPP
@@ -1,32 +1,43 @@
 #ifndef ROLLS_CLASS_HPP
 #define ROLLS_CLASS_HPP
 
-#include <ctime> // time()
-#include <iostream>
-#include <map>
 #include <string>
-#include <sstream>
 #include <vector>
 
-#include <unistd.h> // getpid()
+#include <stdint.h> // uint32_t
 
+#define ROLLS_N_DICE 8
+#define ROLLS_MAX_COUNT 100 // rolls per dice type
+
+// one kind of die of the static table
+struct Die
+{
+	const char	*key; // "d6"
+	uint32_t	sides;
+};
+
+// The dice requested by one message, counted per kind.
+// The table of dice and the help text are shared by every request,
+// a Rolls is only its counts.
 class Rolls
 {
 	public:
 		Rolls();
 
-		std::vector<std::string>	info() const;
-		std::string					list() const;
-		std::string					getKey(size_t index) const;
-		size_t						getKeysNum() const;
-		void						addToCount(const std::string& key);
-		void						addToCount(const std::string& key, int value);
-		size_t						getCount(const std::string& key) const;
-	
+		// rendered once, the same lines for every request
+		static const std::vector<std::string>	&info();
+		static size_t							getKeysNum();
+		static const Die						&getDie(size_t index);
+		// index of the die written token[begin, end) ("d6"), -1 if none
+		static int								find(const std::string &token,
+													size_t begin, size_t end);
+
+		std::string	list() const;
+		void		addToCount(size_t die, int value); // ROLLS_MAX_COUNT max
+		size_t		getCount(size_t die) const;
+
 	private:
-		std::map<std::string, size_t>	_counts;
-		std::vector<std::string>		_keys;
-		size_t							_n_keys;
+		size_t	_counts[ROLLS_N_DICE];
 };
 
 #endif // #ifndef ROLLS_CLASS_HPP
@@ -0,0 +1,109 @@
+#ifndef SERVERSTATS_CLASS_HPP
+#define SERVERSTATS_CLASS_HPP
+
+#include <cstddef>
+#include <string>
+
+#include <stdint.h> // uint64_t
+
+#include "verbs.hpp"
+
+#define STATS_BUCKETS 128 // 4 per power of two, up to 2^32 ns
+#define STATS_N_VERBS (N_ROUTED_VERBS + 1) // then one for all the others
+#define STATS_SIZE_BUCKETS 21 // <= 1, 2, 4... 2^20, then above
+
+// Durations in log-linear buckets: a percentile is the upper bound of
+// its bucket, at most 25% above the real value, in a fixed array.
+// Example: h.add(1500); h.percentile(0.5) gives 1500 (ns), its bucket
+// ends at 1535 but no percentile goes above max()
+class LatencyHistogram
+{
+	public:
+		LatencyHistogram();
+
+		void		add(uint64_t nsec);
+		size_t		count() const;
+		uint64_t	percentile(double p) const; // 0 if empty
+		uint64_t	max() const;
+		uint64_t	sum() const;
+
+	private:
+		size_t		_buckets[STATS_BUCKETS];
+		size_t		_count;
+		uint64_t	_max, _sum;
+};
+
+// Sizes in power of two buckets, exact, as a Prometheus histogram
+// Example: h.add(3) counts in bucket(2), the one of "<= 4"
+class SizeHistogram
+{
+	public:
+		SizeHistogram();
+
+		void		add(size_t size);
+		size_t		bucket(size_t i) const; // <= 2^i, STATS_SIZE_BUCKETS: above
+		size_t		count() const;
+		uint64_t	sum() const;
+
+	private:
+		size_t		_buckets[STATS_SIZE_BUCKETS + 1];
+		size_t		_count;
+		uint64_t	_sum;
+};
+
+struct VerbStats
+{
+	const char			*verb; // "*" for the unknown ones
+	size_t				bytes;
+	LatencyHistogram	latency; // its count() is the lines handled
+};
+
+// Counters for STATS, kept up to date by Connection.
+// Only the reactor writes them, with relaxed atomic stores instead of
+// locked adds: another thread reading them never sees a torn value,
+// and an update costs no more than a plain increment.
+class ServerStats
+{
+	public:
+		ServerStats();
+
+		// one line dispatched to messageRouter, bytes with its "\r\n"
+		void	message(const std::string &verb, size_t bytes, uint64_t nsec);
+		// poll() returned ready fds, then the loop took nsec to call it
+		// again: how late an event arriving meanwhile is handled
+		void	wakeup(int ready);
+		void	lag(uint64_t nsec);
+		// the clients' sockets
+		void	opened();
+		void	closed();
+		void	received(size_t bytes);
+		void	queued(size_t bytes); // added to a SendQ
+		void	sent(size_t bytes, size_t depth); // depth: SendQ before
+		void	dropped(size_t bytes); // a SendQ cleared unsent
+		// the messages one line produced
+		void	fanout(size_t messages);
+
+		const VerbStats			&verb(size_t i) const; // i < STATS_N_VERBS
+		size_t					iterations() const;
+		size_t					busyWakeups() const; // with ready fds
+		size_t					readyFds() const; // in all wakeups
+		size_t					maxReady() const;
+		const LatencyHistogram	&loopLag() const;
+		size_t					accepted() const;
+		size_t					connections() const; // open now
+		uint64_t				bytesIn() const;
+		uint64_t				bytesOut() const;
+		size_t					sendQueued() const; // in all SendQs now
+		const SizeHistogram		&sendQueueDepth() const; // at each send
+		const SizeHistogram		&fanouts() const;
+
+	private:
+		VerbStats			_verbs[STATS_N_VERBS];
+		size_t				_iterations, _busy_wakeups, _ready, _max_ready;
+		LatencyHistogram	_lag;
+		size_t				_accepted, _connections, _send_queued;
+		uint64_t			_bytes_in, _bytes_out;
+		SizeHistogram		_send_depth, _fanout;
+};
+
+#endif // #ifndef SERVERSTATS_CLASS_HPP
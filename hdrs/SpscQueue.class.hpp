@@ -0,0 +1,58 @@
+#ifndef SPSCQUEUE_CLASS_HPP
+#define SPSCQUEUE_CLASS_HPP
+
+#include <cstddef>
+
+#define CACHE_LINE 64
+
+// Bounded queue between exactly one producer thread and one consumer
+// thread, lock-free with the GCC __atomic builtins (C++98 has no
+// <atomic>). Neither side ever waits: reserve() gives NULL when full,
+// front() NULL when empty.
+// Slots are filled and read in place, their strings keep their
+// capacity from one round to the next.
+// Example: producer: if ((slot = q.reserve())) { *slot = x; q.commit(); }
+//          consumer: if ((slot = q.front())) { use(*slot); q.pop(); }
+template <typename T, size_t N>
+class SpscQueue
+{
+	public:
+		SpscQueue() : _head(0), _tail(0) {}
+
+		// producer side
+		T	*reserve()
+		{
+			size_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+			if (tail - __atomic_load_n(&_head, __ATOMIC_ACQUIRE) == N)
+				return NULL;
+			return &_slots[tail % N];
+		}
+		void	commit() // publishes the reserved slot
+		{
+			__atomic_store_n(&_tail, _tail + 1, __ATOMIC_RELEASE);
+		}
+
+		// consumer side
+		T	*front()
+		{
+			size_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+			if (head == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE))
+				return NULL;
+			return &_slots[head % N];
+		}
+		void	pop() // gives the front slot back to the producer
+		{
+			__atomic_store_n(&_head, _head + 1, __ATOMIC_RELEASE);
+		}
+
+	private:
+		T		_slots[N];
+		// each index on its own cache line, written by one side only
+		size_t	_head __attribute__((aligned(CACHE_LINE)));
+		size_t	_tail __attribute__((aligned(CACHE_LINE)));
+
+		SpscQueue(const SpscQueue &);
+		SpscQueue &operator=(const SpscQueue &);
+};
+
+#endif // #ifndef SPSCQUEUE_CLASS_HPP
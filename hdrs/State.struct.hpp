@@ -3,28 +3,66 @@
 
 #include <map>
 #include <vector>
-#include "Client.struct.hpp"
-#include "Channel.struct.hpp"
+#include "CaseMap.class.hpp"
+#include "ChannelRegistry.class.hpp"
+#include "ClientTable.class.hpp"
+#include "EventBus.class.hpp"
+#include "ServerStats.class.hpp"
 #include <ctime>
 
 struct State
 {
-	std::map<int, Client> clients;
-	std::map<std::string, Channel> channels;
+	ClientTable clients;
+	ChannelRegistry channels;
 	std::string password, motd, oper_name, oper_pass;
 	time_t start_time;
 
+	// case-folded nick -> fd, kept in sync by setNick and removeClient
+	CaseMap nicks;
+
+	// published by the handlers, the bot subscribes to it
+	EventBus events;
+
+	// LUSERS counters, kept by welcome, setOper, addClient and removeClient
+	// a client only becomes WELCOMED or an oper through them
+	// the unregistered ones are the other entries of clients: Connection
+	// creates one per accepted socket, before its first line
+	size_t n_registered, n_opers, max_registered;
+
+	// STATS counters, kept by Connection
+	ServerStats stats;
+
+	State();
+
+	// a client created registered (the bot), counted as it is
+	void addClient(int fd, const Client &client);
+	// the end of registration, status becomes WELCOMED
+	void welcome(int fd);
+	void setOper(int fd, bool on);
+	size_t unregistered() const;
+
+	// a client's nick must be changed here to be found by its nick
+	void setNick(int fd, const std::string &nick);
+
 	// should be used by QUIT and PART handlers
 	void removeClient(int fd);
 
+	// channel membership, keeps Client::channels in sync
+	// removeMember also deletes an empty channel, channel is then invalid
+	void addMember(int fd, Channel &channel, unsigned int flags = 0);
+	void addMember(int fd, const std::string &channel_name,
+		unsigned int flags = 0); // creates the channel
+	void removeMember(int fd, Channel &channel);
+	void invite(int fd, Channel &channel); // for INVITE_TTL
+	void uninvite(int fd, Channel &channel);
+
 	// helper functions for broadcasting
 	std::vector<int> clientsInChannelsWith(int fd) const;
 
-	// helper function for targetted commands
+	// helper function for targetted commands, case-insensitive
 	// returns their fd, -1 if nick not found
 	int findClientByNick(const std::string &) const;
 
-	std::string getNamesInChannel(const std::string &channel_name);
 };
 
 #endif // #ifndef STATE_STRUCT_HPP
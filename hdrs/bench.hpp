@@ -0,0 +1,22 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstddef>
+#include <string>
+
+// Benchmarks are built into ircbench by `make bench` (srcs/bench*.cpp)
+// ./ircbench runs all of them, ./ircbench <name> only the matching ones
+
+// wall clock, in seconds
+double	benchNow();
+
+// heap allocations since the start, operator new is counted in ircbench
+size_t	benchAllocations();
+
+// Example: "quit x10 channels (50000 total): 1000 ops, 2.1 us/op"
+void	benchReport(const std::string &name, size_t ops, double seconds);
+// Example: "join+part: 1000 ops, 1.2 us/op, 3.00 allocs/op"
+void	benchReport(const std::string &name, size_t ops, double seconds,
+			size_t allocations);
+
+#endif // #ifndef BENCH_HPP
@@ -8,11 +8,34 @@
 // Connection
 #define L_QUEUE 32
 #define MAX_CLIENT 200
+#define MAX_MSG_LEN 512 // including \r\n, without tags
+#define MAX_TAGS_LEN 4096 // including '@' and the space
+
+// Channels
+#define CHANNEL_POOL_MAX 64 // erased channels kept for reuse, the rest freed
+
+// NAMES command
+#define NAMES_NICK_ROOM 30 // nick length the cached NAMES chunks leave room for
 
 // Server info for welcome msg
 #define SERVER_NAME "ft_irc"
 #define SERVER_VERSION "1.0b"
 
+// CAP negotiation
+#define COMPACT_CAP SERVER_NAME "/compact" // replies without colors
+#define SUPPORTED_CAPS "message-tags server-time " COMPACT_CAP
+
+// INVITE command
+#define INVITE_TTL 3600 // seconds an invite can be used to JOIN
+
+// comma-separated targets, TARGMAX
+#define MAX_JOIN_TARGETS 10
+#define MAX_PART_TARGETS 10
+#define MAX_MSG_TARGETS 4 // PRIVMSG and NOTICE
+
+// MODE command
+#define MAX_MODES 4 // flags applied per MODE command, the others sent back
+
 // OPER command
 #define OPER_NAME "oper"
 #define OPER_PASS "oper"
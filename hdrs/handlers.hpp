@@ -1,12 +1,12 @@
 #ifndef HANDLERS_HPP
 #define HANDLERS_HPP
 
+#include "BotWorker.class.hpp"
 #include "Message.struct.hpp"
+#include "Responses.class.hpp"
 #include "State.struct.hpp"
 #include "dictionary.hpp"
 
-typedef std::vector<Message> Responses;
-
 typedef 
     void message_handler_fn(
         const Message &in, 
@@ -27,9 +27,12 @@ void quitHandler(const Message &, State &, Responses &);
 
 void welcomeHandler(const Message &, State &, Responses &);
 void motdHandler(const Message &, State &, Responses &);
+void lusersHandler(const Message &, State &, Responses &);
+void statsHandler(const Message &, State &, Responses &);
 void operHandler(const Message &, State &, Responses &);
 void modeHandler(const Message &, State &, Responses &);
 void pingHandler(const Message &, State &, Responses &);
+void logLevelHandler(const Message &, State &, Responses &);
 
 void partHandler(const Message &, State &, Responses &);
 void joinHandler(const Message &, State &, Responses &);
@@ -40,14 +43,27 @@ void namesHandler(const Message &, State &, Responses &);
 
 void privmsgHandler(const Message &, State &, Responses &);
 void noticeHandler(const Message &, State &, Responses &);
+void tagmsgHandler(const Message &, State &, Responses &);
 
 // bonus
 Client createBotClient();
-void botRouter(const Message &, State &, Responses &);
-void botHandler(const Message &, State &, Responses &); 
+// subscribes the bot (BOT_ID) to the events of s, starts its worker
+void botSubscribe(State &s);
+// readable when the worker has replies, botDrain sends them
+int botWakeFd();
+void botDrain(State &s, Responses &r);
+// joins the worker, before the statics it uses are destroyed
+void botStop();
+// the answer to one request, on the worker thread
+void botAnswer(const BotRequest &request, BotReply &reply);
 
 // handlers_utils.cpp
 size_t		str_to_size(const std::string &str);
 std::string size_to_str(size_t);
+// "#a,#b" gives {"#a", "#b"}, empty targets are kept to be reported
+std::vector<std::string> split_targets(const std::string &list);
+// the number of targets to process, ERR_TOOMANYTARGETS above max
+size_t		limit_targets(int fd, const Client &client,
+				const std::vector<std::string> &targets, size_t max, Responses &r);
 
 #endif
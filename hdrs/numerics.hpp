@@ -8,6 +8,7 @@
 #define RPL_ENDOFSTATS "219"
 #define RPL_UMODEIS "221"
 #define RPL_STATSUPTIME "242"
+#define RPL_STATSDEBUG "249"
 #define RPL_LUSERCLIENT "251"
 #define RPL_LUSEROP "252"
 #define RPL_LUSERUNKNOWN "253"
@@ -79,6 +80,7 @@
 #define ERR_CANNOTSENDTOCHAN "404"
 #define ERR_TOOMANYCHANNELS "405"
 #define ERR_WASNOSUCHNICK "406"
+#define ERR_TOOMANYTARGETS "407"
 #define ERR_NOORIGIN "409"
 #define ERR_NORECIPIENT "411"
 #define ERR_NOTEXTTOSEND "412"
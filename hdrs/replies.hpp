@@ -0,0 +1,105 @@
+#ifndef REPLIES_HPP
+#define REPLIES_HPP
+
+#include <string>
+#include <vector>
+
+#include "Client.struct.hpp"
+#include "Message.struct.hpp"
+
+// Numeric replies sent by the handlers.
+// Each entry is rendered once (server prefix, numeric, colored text)
+// so a handler only has to fill in the variable parameters.
+enum e_reply
+{
+	REPLY_WELCOME,
+	REPLY_YOURHOST,
+	REPLY_CREATED,
+	REPLY_MYINFO,
+	REPLY_ISUPPORT,
+	REPLY_UMODEIS,
+	REPLY_LUSERCLIENT,
+	REPLY_LUSEROP,
+	REPLY_LUSERUNKNOWN,
+	REPLY_LUSERCHANNELS,
+	REPLY_LUSERME,
+	REPLY_LOCALUSERS,
+	REPLY_GLOBALUSERS,
+	REPLY_STATSCOMMANDS,
+	REPLY_STATSUPTIME,
+	REPLY_STATSDEBUG,
+	REPLY_ENDOFSTATS,
+	REPLY_NOTOPIC,
+	REPLY_TOPIC,
+	REPLY_INVITING,
+	REPLY_NAMREPLY,
+	REPLY_ENDOFNAMES,
+	REPLY_MOTD,
+	REPLY_MOTDSTART,
+	REPLY_ENDOFMOTD,
+	REPLY_YOUREOPER,
+	REPLY_NOSUCHNICK,
+	REPLY_NOSUCHCHANNEL,
+	REPLY_TOOMANYTARGETS,
+	REPLY_CANNOTSENDTOCHAN,
+	REPLY_NORECIPIENT,
+	REPLY_NOTEXTTOSEND,
+	REPLY_NOMOTD,
+	REPLY_NONICKNAMEGIVEN,
+	REPLY_ERRONEUSNICKNAME,
+	REPLY_NICKNAMEINUSE,
+	REPLY_USERNOTINCHANNEL,
+	REPLY_NOTONCHANNEL,
+	REPLY_INPUTTOOLONG,
+	REPLY_USERONCHANNEL,
+	REPLY_NOTREGISTERED,
+	REPLY_NEEDMOREPARAMS,
+	REPLY_EMPTYKEY,
+	REPLY_ALREADYREGISTERED,
+	REPLY_PASSWDMISMATCH,
+	REPLY_OPERMISMATCH,
+	REPLY_CHANNELISFULL,
+	REPLY_INVITEONLYCHAN,
+	REPLY_BADCHANNELKEY,
+	REPLY_NOPRIVILEGES,
+	REPLY_CHANOPRIVSNEEDED,
+	REPLY_TOPICPROTECTED,
+	REPLY_UMODEUNKNOWNFLAG,
+	REPLY_USERSDONTMATCH,
+	REPLY_INVALIDKEY,
+	REPLY_TOOMANYMODES,
+	REPLY_COUNT
+};
+
+// rendered form of a numeric reply
+// params are appended after the variable ones, the last one is the text
+// color/reset wrap the text of replies rendered by their handler
+struct ReplyTemplate
+{
+	std::string source, numeric;
+	std::vector<std::string> params;
+	std::string color, reset;
+	size_t saved; // bytes less than the colored rendering
+};
+
+// renders the colored and plain tables, called once at startup
+// (and lazily otherwise), compact makes plain the default for everyone
+void initReplies(bool compact = false);
+
+const ReplyTemplate &replyTemplate(e_reply id, bool plain = false);
+
+// plain if the server is compact or the client asked for COMPACT_CAP
+const ReplyTemplate &replyTemplate(e_reply id, const Client &client);
+
+// Example: numericReply(fd, REPLY_NEEDMOREPARAMS, client, "JOIN")
+// gives ":ft_irc 461 alice JOIN :Not enough parameters"
+Message numericReply(int fd, e_reply id, const Client &client);
+Message numericReply(int fd, e_reply id, const Client &client,
+	const std::string &param);
+Message numericReply(int fd, e_reply id, const Client &client,
+	const std::string &param1, const std::string &param2);
+Message numericReply(int fd, e_reply id, const Client &client,
+	const std::string &param1, const std::string &param2,
+	const std::string &param3);
+
+#endif // #ifndef REPLIES_HPP
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <stdint.h> // uint64_t
 
 #include "colors.hpp"
 #include "State.struct.hpp"
@@ -10,15 +11,22 @@
 // ui
 void		displayBanner(int port, State &state);
 void		displayFullTime(time_t time);
-void		displayElapsedTime(time_t start);
 std::string	timeToStr(time_t start);
 std::string	dateToStr(time_t start);
+std::string	isoTimeStr();
+uint64_t	monotonicNsec(); // for durations, never goes back
 
 // socket
 int		initListeningSocket(int port);
+// address: a port on 127.0.0.1, or the path of a Unix socket
+int		initLocalSocket(const std::string &address);
+int		acceptNonBlocking(int listen_s_fd); // ERROR if none, errno kept
 
 // signal
 bool	isStopped();
+void	handleSignal(int _);
+bool	quietLogs();
+void	handleLogSignal(int _);
 
 // error
 int		error(const std::string &msg);
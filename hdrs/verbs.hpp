@@ -0,0 +1,34 @@
+#ifndef VERBS_HPP
+#define VERBS_HPP
+
+// The verbs messageRouter dispatches and their handlers, in the order of
+// their ServerStats slots. Both are built from this list: a verb routed
+// here is counted under its own name, never with the unknown ones.
+// Example: #define NAME(verb, handler) verb, then ROUTED_VERBS(NAME)
+#define ROUTED_VERBS(X) \
+	X("PRIVMSG", privmsgHandler) \
+	X("NOTICE", noticeHandler) \
+	X("TAGMSG", tagmsgHandler) \
+	X("JOIN", joinHandler) \
+	X("PART", partHandler) \
+	X("KICK", kickHandler) \
+	X("MODE", modeHandler) \
+	X("TOPIC", topicHandler) \
+	X("INVITE", inviteHandler) \
+	X("NAMES", namesHandler) \
+	X("PING", pingHandler) \
+	X("NICK", nickHandler) \
+	X("USER", userHandler) \
+	X("PASS", passHandler) \
+	X("CAP", capHandler) \
+	X("QUIT", quitHandler) \
+	X("MOTD", motdHandler) \
+	X("LUSERS", lusersHandler) \
+	X("OPER", operHandler) \
+	X("STATS", statsHandler) \
+	X("LOGLEVEL", logLevelHandler)
+
+#define VERB_ONE(verb, handler) + 1
+#define N_ROUTED_VERBS (0 ROUTED_VERBS(VERB_ONE))
+
+#endif // #ifndef VERBS_HPP
@@ -1,4 +1,5 @@
 #include "BotLogs.class.hpp"
+#include "Logs.class.hpp"
 
 BotLogs::BotLogs(time_t start)
 	: _start_time(start)
@@ -8,13 +9,6 @@ BotLogs::BotLogs(time_t start)
 
 void	BotLogs::botLogsBuffer(const std::string &buffer, bool which)
 {
-	displayElapsedTime(_start_time);
-
-	if (which) // buffer_in
-		std::cout << TEAL "Buffer_in" RESET;
-	else // buffer_out
-		std::cout << MAGENTA "Buffer_out" RESET;
-	
-	std::cout << " for " << ORANGE "BOT" RESET << ":" << std::endl;
-	std::cout << buffer << std::endl; 
+	pushLog(which ? LOG_BOT_IN : LOG_BOT_OUT, _start_time, -1, 0,
+		buffer.data(), buffer.size());
 }
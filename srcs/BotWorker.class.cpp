@@ -0,0 +1,173 @@
+#include <cerrno>
+#include <fcntl.h>  // fcntl(), O_NONBLOCK
+#include <unistd.h> // pipe(), read(), write(), close(), usleep()
+
+#include "BotWorker.class.hpp"
+#include "dictionary.hpp"
+#include "utils.hpp"
+
+#define BOT_FULL_SLEEP_USEC 1000 // while the reactor has not taken replies
+
+BotWorker::BotWorker(answer_fn *answer)
+	: _answer(answer), _running(false), _stopping(0), _dropped(0)
+{
+	_to_worker[0] = _to_worker[1] = -1;
+	_to_reactor[0] = _to_reactor[1] = -1;
+}
+
+BotWorker::~BotWorker()
+{
+	stop();
+}
+
+// a pipe is a semaphore the other side can poll or block on
+// the writes never block, a full pipe already wakes its reader
+static int openWakePipe(int fds[2], bool blocking_read)
+{
+	if (pipe(fds) == ERROR)
+		return ERROR;
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+	if (!blocking_read)
+		fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	return OK;
+}
+
+static void closePipe(int fds[2])
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		if (fds[i] >= 0)
+			close(fds[i]);
+		fds[i] = -1;
+	}
+}
+
+static void wake(int fd)
+{
+	char byte = 0;
+	if (write(fd, &byte, 1) == ERROR)
+		errno = 0; // full, the reader is awake anyway
+}
+
+int BotWorker::start()
+{
+	if (_running)
+		return OK;
+	if (openWakePipe(_to_worker, true) == ERROR
+		|| openWakePipe(_to_reactor, false) == ERROR)
+		return (closePipe(_to_worker), spe_error("pipe"), ERROR);
+	__atomic_store_n(&_stopping, 0, __ATOMIC_RELAXED);
+	if (pthread_create(&_thread, NULL, run, this) != 0)
+	{
+		closePipe(_to_worker);
+		closePipe(_to_reactor);
+		return (error("bot thread"), ERROR);
+	}
+	_running = true;
+	return OK;
+}
+
+void BotWorker::stop()
+{
+	if (!_running)
+		return;
+	__atomic_store_n(&_stopping, 1, __ATOMIC_RELEASE);
+	wake(_to_worker[1]);
+	pthread_join(_thread, NULL);
+	closePipe(_to_worker);
+	closePipe(_to_reactor);
+	_running = false;
+}
+
+bool BotWorker::running() const
+{
+	return _running;
+}
+
+bool BotWorker::push(const ClientRef &requester, const ChannelRef &channel,
+	const std::string &text)
+{
+	BotRequest *request = _running ? _requests.reserve() : NULL;
+	if (!request)
+		return (++_dropped, false);
+	request->requester = requester;
+	request->channel = channel;
+	request->text = text;
+	_requests.commit();
+	wake(_to_worker[1]);
+	return true;
+}
+
+BotReply *BotWorker::front()
+{
+	return _replies.front();
+}
+
+void BotWorker::pop()
+{
+	_replies.pop();
+}
+
+int BotWorker::wakeFd() const
+{
+	return _to_reactor[0];
+}
+
+void BotWorker::clearWake()
+{
+	char bytes[64];
+	while (read(_to_reactor[0], bytes, sizeof(bytes)) > 0)
+		;
+	errno = 0;
+}
+
+size_t BotWorker::dropped() const
+{
+	return _dropped;
+}
+
+void *BotWorker::run(void *worker)
+{
+	static_cast<BotWorker *>(worker)->loop();
+	return NULL;
+}
+
+// only the worker waits: for a request, or for the reactor to take
+// its replies
+void BotWorker::loop()
+{
+	char bytes[64];
+	while (!__atomic_load_n(&_stopping, __ATOMIC_ACQUIRE))
+	{
+		BotRequest *request = _requests.front();
+		if (!request)
+		{
+			if (read(_to_worker[0], bytes, sizeof(bytes)) == ERROR
+				&& errno != EINTR)
+				return;
+			continue;
+		}
+		BotReply *reply = waitReplySlot();
+		if (!reply)
+			return;
+		reply->requester = request->requester;
+		reply->channel = request->channel;
+		reply->lines.clear();
+		_answer(*request, *reply);
+		_requests.pop();
+		_replies.commit();
+		wake(_to_reactor[1]);
+	}
+}
+
+BotReply *BotWorker::waitReplySlot()
+{
+	BotReply *reply;
+	while (!(reply = _replies.reserve()))
+	{
+		if (__atomic_load_n(&_stopping, __ATOMIC_ACQUIRE))
+			return NULL;
+		usleep(BOT_FULL_SLEEP_USEC);
+	}
+	return reply;
+}
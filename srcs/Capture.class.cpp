@@ -0,0 +1,118 @@
+#include <cstring> // memcpy()
+#include <fcntl.h> // open()
+#include <unistd.h> // write(), close()
+
+#include "Capture.class.hpp"
+#include "dictionary.hpp"
+#include "utils.hpp"
+
+#define CAPTURE_ENTRY_SIZE 17
+
+// on the writer thread: a ring record becomes a file entry
+static void encodeEntry(const LogRecord &record, const char *data,
+	std::string &out)
+{
+	CaptureEntry entry;
+	entry.type = record.type == LOG_RING_DROPPED ? CAPTURE_DROPPED : record.type;
+	entry.fd = record.type == LOG_RING_DROPPED ? record.value : record.fd;
+	entry.usec = record.type == LOG_RING_DROPPED ? 0 : record.value;
+	entry.length = record.length;
+
+	char bytes[CAPTURE_ENTRY_SIZE];
+	bytes[0] = entry.type;
+	memcpy(bytes + 1, &entry.fd, 4);
+	memcpy(bytes + 5, &entry.usec, 8);
+	memcpy(bytes + 13, &entry.length, 4);
+	out.append(bytes, sizeof(bytes));
+	out.append(data, record.length);
+}
+
+Capture::Capture()
+	: _ring(encodeEntry), _file(-1), _start(0)
+{
+
+}
+
+Capture::~Capture()
+{
+	close();
+}
+
+int Capture::open(const std::string &path)
+{
+	close();
+	_file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (_file == ERROR)
+		return (spe_error(path.c_str()), ERROR);
+	if (write(_file, CAPTURE_MAGIC, 8) != 8 || _ring.start(_file) == ERROR)
+	{
+		::close(_file);
+		_file = -1;
+		return (error("cannot capture to " + path), ERROR);
+	}
+	_start = monotonicNsec() / 1000;
+	return OK;
+}
+
+void Capture::close()
+{
+	if (_file < 0)
+		return;
+	_ring.stop();
+	::close(_file);
+	_file = -1;
+}
+
+bool Capture::recording() const
+{
+	return _file >= 0;
+}
+
+void Capture::accepted(int fd)
+{
+	record(CAPTURE_ACCEPT, fd, "", 0);
+}
+
+void Capture::received(int fd, const char *data, size_t length)
+{
+	record(CAPTURE_DATA, fd, data, length);
+}
+
+void Capture::closed(int fd)
+{
+	record(CAPTURE_CLOSE, fd, "", 0);
+}
+
+// the time in value, the ring has no use for it
+void Capture::record(e_capture type, int fd, const char *data, size_t length)
+{
+	if (_file < 0)
+		return;
+	LogRecord record = {type, fd, (long)(monotonicNsec() / 1000 - _start), 0, length};
+	if (!_ring.push(record, data))
+	{
+		error("capture queue full, the capture stops here");
+		close();
+	}
+}
+
+bool readCaptureHeader(std::istream &in)
+{
+	char magic[8];
+	return in.read(magic, 8) && memcmp(magic, CAPTURE_MAGIC, 8) == 0;
+}
+
+bool readCaptureEntry(std::istream &in, CaptureEntry &entry, std::string &data)
+{
+	char bytes[CAPTURE_ENTRY_SIZE];
+	if (!in.read(bytes, sizeof(bytes)))
+		return false;
+	entry.type = bytes[0];
+	memcpy(&entry.fd, bytes + 1, 4);
+	memcpy(&entry.usec, bytes + 5, 8);
+	memcpy(&entry.length, bytes + 13, 4);
+	if (entry.length > CAPTURE_MAX_DATA)
+		return false;
+	data.resize(entry.length);
+	return entry.length == 0 || in.read(&data[0], entry.length);
+}
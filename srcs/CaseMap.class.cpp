@@ -0,0 +1,150 @@
+#include "CaseMap.class.hpp"
+
+#define CASEMAP_MIN_CAPACITY 16
+
+CaseMap::CaseMap()
+	: _slots(CASEMAP_MIN_CAPACITY), _used(0), _erased(0)
+{
+
+}
+
+char	CaseMap::fold(char c)
+{
+	// 'A'..'^' is A-Z then [\]^, their lower case is 32 further
+	if (c >= 'A' && c <= '^')
+		return c + ('a' - 'A');
+	return c;
+}
+
+std::string	CaseMap::fold(const std::string &str)
+{
+	std::string folded(str);
+	for (size_t i = 0; i < folded.size(); ++i)
+		folded[i] = fold(folded[i]);
+	return folded;
+}
+
+bool	CaseMap::equal(const std::string &a, const std::string &b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); ++i)
+		if (fold(a[i]) != fold(b[i]))
+			return false;
+	return true;
+}
+
+// FNV-1a over the folded characters
+size_t	CaseMap::hash(const std::string &key)
+{
+	size_t h = 2166136261u;
+	for (size_t i = 0; i < key.size(); ++i)
+	{
+		h ^= static_cast<unsigned char>(fold(key[i]));
+		h *= 16777619u;
+	}
+	return h;
+}
+
+bool	CaseMap::matches(const std::string &folded, const std::string &key)
+{
+	if (folded.size() != key.size())
+		return false;
+	for (size_t i = 0; i < key.size(); ++i)
+		if (folded[i] != fold(key[i]))
+			return false;
+	return true;
+}
+
+// index of the key if found, otherwise of the slot to insert it
+size_t	CaseMap::locate(const std::string &key, bool &found) const
+{
+	size_t mask = _slots.size() - 1;
+	size_t i = hash(key) & mask;
+	size_t free_slot = _slots.size();
+
+	found = false;
+	while (_slots[i].state != EMPTY)
+	{
+		if (_slots[i].state == USED && matches(_slots[i].key, key))
+		{
+			found = true;
+			return i;
+		}
+		if (_slots[i].state == ERASED && free_slot == _slots.size())
+			free_slot = i;
+		i = (i + 1) & mask;
+	}
+	return free_slot == _slots.size() ? i : free_slot;
+}
+
+int	CaseMap::find(const std::string &key) const
+{
+	bool found;
+	size_t i = locate(key, found);
+	return found ? _slots[i].value : -1;
+}
+
+void	CaseMap::insert(const std::string &key, int value)
+{
+	// keep at least half of the slots empty, probes stay short
+	if ((_used + _erased + 1) * 2 > _slots.size())
+		rehash(_used * 4 > _slots.size() ? _slots.size() * 2 : _slots.size());
+
+	bool found;
+	size_t i = locate(key, found);
+	if (!found)
+	{
+		if (_slots[i].state == ERASED)
+			--_erased;
+		++_used;
+		_slots[i].key = fold(key);
+		_slots[i].state = USED;
+	}
+	_slots[i].value = value;
+}
+
+void	CaseMap::erase(const std::string &key)
+{
+	bool found;
+	size_t i = locate(key, found);
+	if (!found)
+		return;
+	_slots[i].key.clear();
+	_slots[i].state = ERASED;
+	--_used;
+	++_erased;
+}
+
+size_t	CaseMap::size() const
+{
+	return _used;
+}
+
+void	CaseMap::clear()
+{
+	_slots.assign(CASEMAP_MIN_CAPACITY, Slot());
+	_used = 0;
+	_erased = 0;
+}
+
+// also drops the erased slots, capacity stays a power of 2
+void	CaseMap::rehash(size_t capacity)
+{
+	std::vector<Slot> old;
+	old.swap(_slots);
+	_slots.assign(capacity, Slot());
+	_used = 0;
+	_erased = 0;
+	for (size_t i = 0; i < old.size(); ++i)
+	{
+		if (old[i].state != USED)
+			continue;
+		bool found;
+		size_t j = locate(old[i].key, found);
+		_slots[j].key.swap(old[i].key);
+		_slots[j].value = old[i].value;
+		_slots[j].state = USED;
+		++_used;
+	}
+}
@@ -0,0 +1,172 @@
+#include "Channel.struct.hpp"
+
+#include <algorithm>
+#include <cstring> // strlen()
+
+static bool fdLess(const Member &member, int fd)
+{
+	return member.fd < fd;
+}
+
+Channel::Channel()
+	: id(-1), userlimit(0)
+{
+
+}
+
+void Channel::clear()
+{
+	id = -1;
+	name.clear();
+	topic.clear();
+	key.clear();
+	members.clear();
+	invites.clear();
+	modes.clear();
+	userlimit = 0;
+	names.clear();
+}
+
+// "@alice" for an op, "+bob" for a voiced member
+std::string Channel::namesEntry(const Member &member)
+{
+	if (member.nick.empty())
+		return member.nick;
+	if (member.flags & MEMBER_OP)
+		return "@" + member.nick;
+	if (member.flags & MEMBER_VOICE)
+		return "+" + member.nick;
+	return member.nick;
+}
+
+// what is left in ":ft_irc 353 <nick> = <channel> :<names>\r\n"
+size_t Channel::namesBudget(size_t nick_len) const
+{
+	size_t fixed = strlen(":" SERVER_NAME " 353 ") + nick_len
+		+ strlen(" = ") + name.size() + strlen(" :\r\n");
+	return fixed < MAX_MSG_LEN ? MAX_MSG_LEN - fixed : 0;
+}
+
+Members::iterator Channel::find(int fd)
+{
+	Members::iterator it = std::lower_bound(members.begin(), members.end(), fd, fdLess);
+	if (it != members.end() && it->fd != fd)
+		return members.end();
+	return it;
+}
+
+Members::const_iterator Channel::find(int fd) const
+{
+	Members::const_iterator it = std::lower_bound(members.begin(), members.end(), fd, fdLess);
+	if (it != members.end() && it->fd != fd)
+		return members.end();
+	return it;
+}
+
+bool Channel::isMember(int fd) const
+{
+	return find(fd) != members.end();
+}
+
+size_t Channel::size() const
+{
+	return members.size();
+}
+
+bool Channel::empty() const
+{
+	return members.empty();
+}
+
+void Channel::addMember(int fd, unsigned int flags, const std::string &nick)
+{
+	Members::iterator it = std::lower_bound(members.begin(), members.end(), fd, fdLess);
+	if (it != members.end() && it->fd == fd)
+		return;
+	Member member = {fd, flags, nick};
+	names.add(namesEntry(member), namesBudget());
+	members.insert(it, member);
+}
+
+void Channel::removeMember(int fd)
+{
+	Members::iterator it = find(fd);
+	if (it == members.end())
+		return;
+	names.remove(namesEntry(*it));
+	members.erase(it);
+}
+
+void Channel::renameMember(int fd, const std::string &nick)
+{
+	Members::iterator it = find(fd);
+	if (it == members.end() || it->nick == nick)
+		return;
+	std::string old_entry = namesEntry(*it);
+	it->nick = nick;
+	names.replace(old_entry, namesEntry(*it), namesBudget());
+}
+
+bool Channel::hasFlag(int fd, e_member_flag flag) const
+{
+	Members::const_iterator it = find(fd);
+	return it != members.end() && (it->flags & flag);
+}
+
+void Channel::setFlag(int fd, e_member_flag flag, bool on)
+{
+	Members::iterator it = find(fd);
+	if (it == members.end())
+		return;
+	std::string old_entry = namesEntry(*it);
+	if (on)
+		it->flags |= flag;
+	else
+		it->flags &= ~flag;
+	std::string new_entry = namesEntry(*it);
+	if (new_entry != old_entry)
+		names.replace(old_entry, new_entry, namesBudget());
+}
+
+size_t Channel::countFlag(e_member_flag flag) const
+{
+	size_t count = 0;
+	for (Members::const_iterator it = members.begin(); it != members.end(); ++it)
+		if (it->flags & flag)
+			++count;
+	return count;
+}
+
+bool Channel::isOp(int fd) const
+{
+	return hasFlag(fd, MEMBER_OP);
+}
+
+// expired invites are dropped by State::invite, on both sides
+void Channel::invite(int fd, time_t expiry)
+{
+	invites[fd] = expiry;
+}
+
+void Channel::uninvite(int fd)
+{
+	invites.erase(fd);
+}
+
+bool Channel::isInvited(int fd) const
+{
+	std::map<int, time_t>::const_iterator it = invites.find(fd);
+	return it != invites.end() && it->second > time(0);
+}
+
+void Channel::broadcast(const Message &m, Responses &out, int except) const
+{
+	out.reserve(out.size() + members.size());
+	for (Members::const_iterator it = members.begin(); it != members.end(); ++it)
+	{
+		if (it->fd == except)
+			continue;
+		out.push_back(m);
+		out.back().fd = it->fd;
+	}
+}
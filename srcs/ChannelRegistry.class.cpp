@@ -0,0 +1,134 @@
+#include "ChannelRegistry.class.hpp"
+#include "dictionary.hpp"
+
+ChannelRegistry::ChannelRegistry()
+	: _size(0)
+{
+
+}
+
+ChannelRegistry::~ChannelRegistry()
+{
+	for (size_t i = 0; i < _channels.size(); ++i)
+		delete _channels[i];
+	for (size_t i = 0; i < _pool.size(); ++i)
+		delete _pool[i];
+}
+
+Channel &ChannelRegistry::operator[](const std::string &name)
+{
+	int id = _ids.find(name);
+	if (id != -1)
+		return *_channels[id];
+
+	if (_free_ids.empty())
+	{
+		id = _channels.size();
+		_channels.push_back(NULL);
+		_generations.push_back(0);
+	}
+	else
+	{
+		id = _free_ids.back();
+		_free_ids.pop_back();
+	}
+	Channel *channel;
+	if (_pool.empty())
+		channel = new Channel();
+	else
+	{
+		channel = _pool.back();
+		_pool.pop_back();
+	}
+	channel->id = id;
+	channel->name = name;
+	_channels[id] = channel;
+	_ids.insert(name, id);
+	++_size;
+	return *channel;
+}
+
+Channel *ChannelRegistry::find(const std::string &name)
+{
+	return find(_ids.find(name));
+}
+
+const Channel *ChannelRegistry::find(const std::string &name) const
+{
+	return find(_ids.find(name));
+}
+
+Channel *ChannelRegistry::find(int id)
+{
+	if (id < 0 || (size_t)id >= _channels.size())
+		return NULL;
+	return _channels[id];
+}
+
+const Channel *ChannelRegistry::find(int id) const
+{
+	if (id < 0 || (size_t)id >= _channels.size())
+		return NULL;
+	return _channels[id];
+}
+
+Channel *ChannelRegistry::find(const ChannelRef &ref)
+{
+	Channel *channel = find(ref.id);
+	if (!channel || _generations[ref.id] != ref.generation)
+		return NULL;
+	return channel;
+}
+
+int ChannelRegistry::id(const std::string &name) const
+{
+	return _ids.find(name);
+}
+
+size_t ChannelRegistry::count(const std::string &name) const
+{
+	return _ids.find(name) == -1 ? 0 : 1;
+}
+
+void ChannelRegistry::erase(int id)
+{
+	Channel *channel = find(id);
+	if (!channel)
+		return;
+	_ids.erase(channel->name);
+	if (_pool.size() < CHANNEL_POOL_MAX)
+	{
+		channel->clear();
+		_pool.push_back(channel);
+	}
+	else
+		delete channel; // a burst of channels is not kept for good
+	_channels[id] = NULL;
+	++_generations[id];
+	_free_ids.push_back(id);
+	--_size;
+}
+
+size_t ChannelRegistry::size() const
+{
+	return _size;
+}
+
+bool ChannelRegistry::empty() const
+{
+	return _size == 0;
+}
+
+size_t ChannelRegistry::pooled() const
+{
+	return _pool.size();
+}
+
+ChannelRef ChannelRegistry::ref(int id) const
+{
+	ChannelRef ref;
+	ref.id = id;
+	ref.generation = (id < 0 || (size_t)id >= _generations.size())
+		? 0 : _generations[id];
+	return ref;
+}
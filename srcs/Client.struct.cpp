@@ -1,22 +1,47 @@
 #include "Client.struct.hpp"
 
-// full hostmask for message sources
-std::string Client::hostmask() const
+Client::Client()
+	: status(CONNECTED), caps(0)
 {
-	if (nick.empty())
-		return "*";
-	return nick + "!" + username + "@0.0.0.0";
+	render();
+}
+
+void Client::setNick(const std::string &new_nick)
+{
+	nick = new_nick;
+	render();
+}
+
+void Client::setUsername(const std::string &new_username)
+{
+	username = new_username;
+	render();
 }
 
-// just the nick or * for numeric replies
-Client::operator std::string() const
+// full hostmask for message sources, just the nick or * for numeric replies
+void Client::render()
 {
 	if (nick.empty())
-		return "*";
-	return nick;
+	{
+		_hostmask = "*";
+		_name = "*";
+		return;
+	}
+	_hostmask = nick + "!" + username + "@0.0.0.0";
+	_name = nick;
+}
+
+const std::string &Client::hostmask() const
+{
+	return _hostmask;
+}
+
+Client::operator const std::string &() const
+{
+	return _name;
 }
 
 bool Client::isOp() const
 {
-	return modes.count('o') == 1;
+	return modes.has(MODE_OPER);
 }
@@ -0,0 +1,103 @@
+#include "ClientTable.class.hpp"
+
+ClientTable::ClientTable()
+	: _size(0)
+{
+
+}
+
+ClientTable::~ClientTable()
+{
+	for (size_t i = 0; i < _chunks.size(); ++i)
+		delete[] _chunks[i];
+}
+
+size_t ClientTable::index(int fd)
+{
+	if (fd < 0)
+		return 2 * (size_t)(-(long)fd) - 1;
+	return 2 * (size_t)fd;
+}
+
+ClientTable::Slot *ClientTable::slot(int fd) const
+{
+	size_t i = index(fd);
+	if (i / CLIENT_CHUNK_SLOTS >= _chunks.size())
+		return NULL;
+	return &_chunks[i / CLIENT_CHUNK_SLOTS][i % CLIENT_CHUNK_SLOTS];
+}
+
+Client &ClientTable::operator[](int fd)
+{
+	size_t i = index(fd);
+	while (i / CLIENT_CHUNK_SLOTS >= _chunks.size())
+		_chunks.push_back(new Slot[CLIENT_CHUNK_SLOTS]);
+	Slot &s = _chunks[i / CLIENT_CHUNK_SLOTS][i % CLIENT_CHUNK_SLOTS];
+	if (!s.used)
+	{
+		s.used = true;
+		++_size;
+	}
+	return s.client;
+}
+
+Client *ClientTable::find(int fd)
+{
+	Slot *s = slot(fd);
+	return (s && s->used) ? &s->client : NULL;
+}
+
+const Client *ClientTable::find(int fd) const
+{
+	const Slot *s = slot(fd);
+	return (s && s->used) ? &s->client : NULL;
+}
+
+Client *ClientTable::find(const ClientRef &ref)
+{
+	Slot *s = slot(ref.fd);
+	if (!s || !s->used || s->generation != ref.generation)
+		return NULL;
+	return &s->client;
+}
+
+size_t ClientTable::count(int fd) const
+{
+	return find(fd) ? 1 : 0;
+}
+
+// the slot keeps its memory, the next client on this fd reuses it
+void ClientTable::erase(int fd)
+{
+	Slot *s = slot(fd);
+	if (!s || !s->used)
+		return;
+	s->client = Client();
+	s->used = false;
+	++s->generation;
+	--_size;
+}
+
+size_t ClientTable::size() const
+{
+	return _size;
+}
+
+bool ClientTable::empty() const
+{
+	return _size == 0;
+}
+
+ClientRef ClientTable::ref(int fd) const
+{
+	ClientRef ref;
+	ref.fd = fd;
+	ref.generation = generation(fd);
+	return ref;
+}
+
+unsigned int ClientTable::generation(int fd) const
+{
+	const Slot *s = slot(fd);
+	return s ? s->generation : 0;
+}
@@ -1,7 +1,8 @@
 #include "Connection.class.hpp"
 
 Connection::Connection(State &state, message_handler_fn *message_handler)
-	: state(state), message_handler(message_handler), logs(state.start_time)
+	: _n_fds(0), state(state), message_handler(message_handler),
+	  logs(state.start_time), in(-1, "")
 {
 
 }
@@ -21,6 +22,26 @@ void	Connection::initPollfd(int listen_s_fd)
 		_pfd[i].events = 0;
 		_pfd[i].revents = 0;
 	}
+
+	// the services stay first, clients are only added and removed after
+	std::map<int, service_fn *>::iterator it;
+	for (it = services.begin(); it != services.end(); ++it)
+	{
+		_pfd[_n_fds].fd = it->first;
+		_pfd[_n_fds].events = POLLIN;
+		_n_fds++;
+	}
+	if (metrics.listenFd() >= 0)
+	{
+		_pfd[_n_fds].fd = metrics.listenFd();
+		_pfd[_n_fds].events = POLLIN;
+		_n_fds++;
+	}
+}
+
+void	Connection::addService(int fd, service_fn *ready)
+{
+	services[fd] = ready;
 }
 
 int	Connection::pollLoop(int listen_s_fd)
@@ -29,16 +50,24 @@ int	Connection::pollLoop(int listen_s_fd)
 
 	initPollfd(listen_s_fd);
 
+	uint64_t woke = 0;
 	while (!isStopped())
 	{
+		if (woke)
+			state.stats.lag(monotonicNsec() - woke);
 		poll_ret = poll(_pfd, _n_fds, 100);
+		woke = monotonicNsec();
+		state.stats.wakeup(poll_ret);
 		if (poll_ret == ERROR)
 		{
-			closeAll();
+			// a signal: SIGINT ends the loop above, SIGUSR1 does not
 			if (errno == EINTR)
-				return (OK);
-			else
-				return (spe_error("poll"), ERROR);
+			{
+				errno = 0;
+				continue;
+			}
+			closeAll();
+			return (spe_error("poll"), ERROR);
 		}
 
 		else if (poll_ret > 0)
@@ -48,7 +77,14 @@ int	Connection::pollLoop(int listen_s_fd)
 			{
 				if (_pfd[index].revents)
 				{
-					if (_pfd[index].revents & POLLHUP) // client disconnects
+					if (index > 0 && services.count(_pfd[index].fd))
+						runService(index);
+					else if (index > 0 && metrics.owns(_pfd[index].fd))
+					{
+						runMetrics(index);
+						continue;
+					}
+					else if (_pfd[index].revents & POLLHUP) // client disconnects
 					{
 						if (disconnectClient(index) == ERROR)
 							return (closeAll(), ERROR);
@@ -114,6 +150,9 @@ int	Connection::acceptNewClient()
 	}
 
 	logs.logsConnect(new_s_fd, _n_fds);
+	capture.accepted(new_s_fd);
+	state.stats.opened();
+	state.clients[new_s_fd]; // an unknown connection until it registers
 
 	_pfd[_n_fds].fd = new_s_fd;
 	_pfd[_n_fds].events = POLLIN;
@@ -126,6 +165,7 @@ int Connection::sendData(int &index)
 {
 	int			s_fd = _pfd[index].fd;
 	std::string	&buffer = buffer_out[s_fd];
+	size_t		depth = buffer.size();
 	int			b_send;
 
 	if (buffer.empty())
@@ -156,6 +196,7 @@ int Connection::sendData(int &index)
 	}
 
 	buffer.erase(0, b_send);
+	state.stats.sent(b_send, depth);
 
 	if (buffer.empty())
 	{
@@ -171,7 +212,7 @@ int Connection::sendData(int &index)
 int Connection::receiveData(int &index)
 {
 	int		s_fd = _pfd[index].fd;
-	char	buffer[513];
+	char	buffer[MAX_MSG_LEN + MAX_TAGS_LEN + 1];
 	int		b_read;
 
 	b_read = recv(s_fd, buffer, sizeof(buffer), 0);
@@ -192,24 +233,36 @@ int Connection::receiveData(int &index)
 			return (OK);
 		}
 	}
-	else if (b_read == 513)
-	{
-		logs.logsBufferOverLimit(s_fd);
 
+	state.stats.received(b_read);
+	if (feed(s_fd, buffer, b_read) == NOK)
+	{
 		// disconnect client to avoid flooding
 		// does not send message to malfunctioning client
 		if (disconnectClient(index) == ERROR)
 			return (closeAll(), ERROR);
-
-		return (OK);
 	}
 
-	buffer_in[s_fd].append(buffer, b_read);
+	return (OK);
+}
+
+// what remains after the complete lines are handled is an unfinished
+// line, bounded so a client can't grow it by sending small chunks
+int Connection::feed(int fd, const char *data, size_t len)
+{
+	capture.received(fd, data, len);
+	std::string &buff = buffer_in[fd];
+	buff.append(data, len);
 
-	logs.logsBuffer(s_fd, buffer_in[s_fd], true);
+	logs.logsBuffer(fd, buff, true);
 
-	onRead(s_fd);
+	onRead(fd);
 
+	if (buff.size() > MAX_MSG_LEN + MAX_TAGS_LEN)
+	{
+		logs.logsBufferOverLimit(fd);
+		return (NOK);
+	}
 	return (OK);
 }
 
@@ -229,10 +282,57 @@ int	Connection::disconnectClient(int &index)
 	shrinkArray(index);
 
 	logs.logsDisconnect(s_fd, _n_fds);
+	capture.closed(s_fd);
+	state.stats.closed();
 
 	return (OK);
 }
 
+// a service that hung up is no longer polled
+void	Connection::runService(int index)
+{
+	short revents = _pfd[index].revents;
+	_pfd[index].revents = 0;
+	if (revents & (POLLHUP | POLLERR | POLLNVAL))
+	{
+		_pfd[index].fd = -1; // ignored by poll()
+		return;
+	}
+	output.clear();
+	services[_pfd[index].fd](state, output);
+	fillRegisterOut(output);
+}
+
+// the metrics listener accepts, a scrape moves on by one step per event
+void	Connection::runMetrics(int &index)
+{
+	int fd = _pfd[index].fd;
+	short revents = _pfd[index].revents;
+	_pfd[index].revents = 0;
+	if (fd == metrics.listenFd())
+	{
+		int scrape = metrics.accept();
+		if (scrape == ERROR)
+			return;
+		if (_n_fds >= MAX_CLIENT)
+		{
+			metrics.drop(scrape);
+			error("too many clients");
+			return;
+		}
+		_pfd[_n_fds].fd = scrape;
+		_pfd[_n_fds].events = POLLIN;
+		_pfd[_n_fds].revents = 0;
+		_n_fds++;
+		return;
+	}
+	short events = metrics.ready(fd, revents, state);
+	if (events)
+		_pfd[index].events = events;
+	else
+		shrinkArray(index);
+}
+
 int	Connection::shrinkArray(int &index)
 {
 	for (int i = index; i < _n_fds - 1; i++)
@@ -252,13 +352,13 @@ int	Connection::shrinkArray(int &index)
 
 void	Connection::closeAll()
 {
-	// debug
-	std::cout << UNDERLINE "\n\nClosing all connections:" RESET << std::endl;
+	logs.logsCloseAll();
 
-	// client sockets
+	// client sockets, the services are closed by their owner
 	for (size_t i = 1; i < MAX_CLIENT; i++)
 	{
-		if (_pfd[i].fd >= 0)
+		if (_pfd[i].fd >= 0 && !services.count(_pfd[i].fd)
+			&& !metrics.owns(_pfd[i].fd))
 		{
 			logs.logsEnd(_pfd[i].fd, true);
 
@@ -274,52 +374,123 @@ void	Connection::closeAll()
 	_pfd[0].fd = -1;
 }
 
+// the line is parsed in place, in and output are reused for every line
 void Connection::onRead(int fd)
 {
 	std::string &buff = buffer_in.at(fd);
-	while (buff.find("\r\n") != std::string::npos)
+	size_t end;
+	while ((end = buff.find("\r\n")) != std::string::npos)
 	{
-		size_t size = buff.find("\r\n") + 2;
-		Message in(fd, buff.substr(0, size));
-		buff.erase(0, size);
-		Responses output;
+		in.parse(fd, buff);
+		buff.erase(0, end + 2);
+		output.clear();
+		uint64_t start = monotonicNsec();
 		message_handler(in, state, output);
+		state.stats.message(in.verb, end + 2, monotonicNsec() - start);
+		state.stats.fanout(output.size());
 		fillRegisterOut(output);
 	}
 }
 
 void Connection::onDisconnect(int fd, int index)
 {
-	Message msg(fd, "QUIT :Disconnected");
-	Responses output;
-	message_handler(msg, state, output);
+	hangUp(fd);
+	clearEvents(index);
+}
+
+void Connection::hangUp(int fd)
+{
+	static const std::string quit = "QUIT :Disconnected";
+
+	in.parse(fd, quit);
+	output.clear();
+	message_handler(in, state, output);
 	fillRegisterOut(output);
+	std::map<int, size_t>::iterator saved = bytes_saved.find(fd);
+	if (saved != bytes_saved.end())
+		logs.logsBytesSaved(fd, saved->second);
 	clearBuffers(fd);
-	clearEvents(index);
 }
 
+int Connection::startCapture(const std::string &path)
+{
+	return capture.open(path);
+}
+
+int Connection::startMetrics(const std::string &address)
+{
+	return metrics.listen(address);
+}
+
+// A broadcast is a run of identical messages for different fds:
+// its body is rendered once, only the tags differ per recipient
 void Connection::fillRegisterOut(Responses &r)
 {
+	const Message *rendered = NULL;
+	std::string time;
+
 	for (Responses::iterator it = r.begin(); it != r.end(); ++it)
 	{
 		int fd = it->fd;
 		if (fd < 0)
 			continue;
-		buffer_out[fd] += it->assemble();
+		if (!rendered || !rendered->sameFrame(*it))
+		{
+			frame.clear();
+			it->assembleBody(frame);
+			rendered = &*it;
+		}
+		std::string &out = buffer_out[fd];
+		size_t queued = out.size();
+		appendTags(out, *it, time);
+		out += frame;
+		state.stats.queued(out.size() - queued);
 
-		if (!buffer_out[fd].empty())
+		if (!out.empty())
 		{
 			int index = findIndexByFd(fd);
 			if (index != ERROR)
 				_pfd[index].events |= POLLOUT;
 		}
 
+		if (it->saved)
+			bytes_saved[fd] += it->saved;
+
 		// will disconnect after sending
 		if (it->shouldDisconnect())
 			pending_disconnect_fds.insert(it->fd);
 	}
 }
 
+// tags are only sent to the clients that asked for them (CAP REQ)
+// time is shared by all the messages of the same event
+void Connection::appendTags(std::string &out, const Message &m, std::string &time)
+{
+	const Client *client = state.clients.find(m.fd);
+	if (!client || !client->caps)
+		return;
+
+	size_t start = out.size();
+	out += '@';
+	if (client->caps & CAP_SERVER_TIME)
+	{
+		if (time.empty())
+			time = isoTimeStr();
+		out += "time=";
+		out += time;
+	}
+	if ((client->caps & CAP_MESSAGE_TAGS) && !m.tags.empty())
+	{
+		if (out.size() > start + 1)
+			out += ';';
+		out += m.tags;
+	}
+	if (out.size() == start + 1)
+		out.erase(start);
+	else
+		out += ' ';
+}
+
 int Connection::findIndexByFd(int fd)
 {
 	for (int index = 0; index < _n_fds; index++)
@@ -330,13 +501,21 @@ int Connection::findIndexByFd(int fd)
 	return (ERROR);
 }
 
+std::string &Connection::pendingOutput(int fd)
+{
+	return buffer_out[fd];
+}
+
 void Connection::clearBuffers(int fd)
 {
+	state.stats.dropped(buffer_out[fd].size());
 	buffer_in[fd].clear();
 	buffer_out[fd].clear();
 	pending_disconnect_fds.erase(fd);
+	bytes_saved.erase(fd);
 }
 
+
 void Connection::clearEvents(int index)
 {
 	_pfd[index].events = 0;
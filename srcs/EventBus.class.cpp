@@ -0,0 +1,35 @@
+#include "EventBus.class.hpp"
+#include "State.struct.hpp"
+
+void EventBus::subscribe(e_event type, int fd, event_handler_fn *handler)
+{
+	Subscriber sub = {fd, handler};
+	_subscribers[type].push_back(sub);
+}
+
+bool EventBus::wants(e_event type) const
+{
+	return !_subscribers[type].empty();
+}
+
+// a subscriber does not get its own messages
+bool EventBus::delivered(const Event &event, const Subscriber &sub,
+	const State &s) const
+{
+	if (event.type != EVENT_PRIVMSG)
+		return true;
+	if (event.fd == sub.fd)
+		return false;
+	if (event.target != -1)
+		return event.target == sub.fd;
+	const Channel *channel = s.channels.find(event.channel);
+	return channel && channel->isMember(sub.fd);
+}
+
+void EventBus::publish(const Event &event, State &s, Responses &r) const
+{
+	const std::vector<Subscriber> &subs = _subscribers[event.type];
+	for (size_t i = 0; i < subs.size(); ++i)
+		if (delivered(event, subs[i], s))
+			subs[i].handler(event, s, r);
+}
@@ -0,0 +1,196 @@
+#include <cerrno>
+#include <cstring>  // memcpy()
+#include <fcntl.h>  // fcntl(), O_NONBLOCK
+#include <unistd.h> // pipe(), read(), write(), close()
+
+#include "LogRing.class.hpp"
+#include "dictionary.hpp"
+#include "utils.hpp"
+
+// records stay aligned, so their fixed part can be read in place
+// and the room left before the end always holds a pad record
+static size_t recordSize(size_t length)
+{
+	size_t size = sizeof(LogRecord) + length;
+	return (size + sizeof(LogRecord) - 1) / sizeof(LogRecord) * sizeof(LogRecord);
+}
+
+LogRing::LogRing(format_fn *format)
+	: _format(format), _bytes(NULL), _out(-1), _running(false),
+	  _stopping(0), _dropped(0), _reported(0), _head(0), _tail(0),
+	  _sleeping(0)
+{
+	_wake[0] = _wake[1] = -1;
+}
+
+LogRing::~LogRing()
+{
+	stop();
+}
+
+static void wake(int fd)
+{
+	char byte = 0;
+	if (write(fd, &byte, 1) == ERROR)
+		errno = 0; // full, the writer is awake anyway
+}
+
+int LogRing::start(int fd)
+{
+	if (_running)
+		return OK;
+	if (pipe(_wake) == ERROR)
+		return (spe_error("pipe"), ERROR);
+	fcntl(_wake[1], F_SETFL, O_NONBLOCK);
+	_bytes = new char[LOG_RING_BYTES];
+	_out = fd;
+	_head = _tail = 0;
+	__atomic_store_n(&_stopping, 0, __ATOMIC_RELAXED);
+	if (pthread_create(&_thread, NULL, run, this) != 0)
+	{
+		close(_wake[0]);
+		close(_wake[1]);
+		delete[] _bytes;
+		_bytes = NULL;
+		return (error("log thread"), ERROR);
+	}
+	_running = true;
+	return OK;
+}
+
+void LogRing::stop()
+{
+	if (!_running)
+		return;
+	__atomic_store_n(&_stopping, 1, __ATOMIC_SEQ_CST);
+	wake(_wake[1]);
+	pthread_join(_thread, NULL);
+	close(_wake[0]);
+	close(_wake[1]);
+	delete[] _bytes;
+	_bytes = NULL;
+	_running = false;
+}
+
+bool LogRing::running() const
+{
+	return _running;
+}
+
+// a record that would cross the end starts over at 0, the end is padding
+bool LogRing::push(const LogRecord &record, const char *text)
+{
+	if (!_running)
+		return false;
+	size_t size = recordSize(record.length);
+	size_t tail = _tail; // only written here
+	size_t room = LOG_RING_BYTES - tail % LOG_RING_BYTES;
+	size_t skip = room < size ? room : 0;
+	if (tail + skip + size - __atomic_load_n(&_head, __ATOMIC_ACQUIRE)
+		> LOG_RING_BYTES)
+		return (__atomic_add_fetch(&_dropped, 1, __ATOMIC_RELAXED), false);
+
+	if (skip)
+	{
+		LogRecord pad = {LOG_RING_PAD, -1, 0, 0, skip - sizeof(LogRecord)};
+		memcpy(_bytes + tail % LOG_RING_BYTES, &pad, sizeof(pad));
+	}
+	char *at = _bytes + (tail + skip) % LOG_RING_BYTES;
+	memcpy(at, &record, sizeof(record));
+	memcpy(at + sizeof(record), text, record.length);
+	// seq_cst against the writer going to sleep, see loop()
+	__atomic_store_n(&_tail, tail + skip + size, __ATOMIC_SEQ_CST);
+	if (__atomic_exchange_n(&_sleeping, 0, __ATOMIC_SEQ_CST))
+		wake(_wake[1]);
+	return true;
+}
+
+size_t LogRing::dropped() const
+{
+	return __atomic_load_n(&_dropped, __ATOMIC_RELAXED);
+}
+
+size_t LogRing::queued() const
+{
+	return __atomic_load_n(&_tail, __ATOMIC_RELAXED)
+		- __atomic_load_n(&_head, __ATOMIC_RELAXED);
+}
+
+void *LogRing::run(void *ring)
+{
+	static_cast<LogRing *>(ring)->loop();
+	return NULL;
+}
+
+// the writer says it sleeps, then looks once more: either it sees the
+// last record, or the producer sees it sleeping and wakes it
+void LogRing::loop()
+{
+	char bytes[64];
+	for (;;)
+	{
+		if (drain())
+			continue;
+		if (__atomic_load_n(&_stopping, __ATOMIC_SEQ_CST))
+			return;
+		__atomic_store_n(&_sleeping, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&_tail, __ATOMIC_SEQ_CST) != _head
+			|| __atomic_load_n(&_stopping, __ATOMIC_SEQ_CST))
+		{
+			__atomic_store_n(&_sleeping, 0, __ATOMIC_SEQ_CST);
+			continue;
+		}
+		if (read(_wake[0], bytes, sizeof(bytes)) == ERROR && errno != EINTR)
+			return;
+	}
+}
+
+static void writeAll(int fd, const std::string &text)
+{
+	size_t done = 0;
+	while (done < text.size())
+	{
+		ssize_t n = write(fd, text.data() + done, text.size() - done);
+		if (n == ERROR && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return; // nowhere to write, the logs are lost
+		done += n;
+	}
+}
+
+// formats up to LOG_BATCH_BYTES of records, frees them, then writes
+bool LogRing::drain()
+{
+	size_t head = _head; // only written here
+	size_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+	if (head == tail && __atomic_load_n(&_dropped, __ATOMIC_RELAXED) == _reported)
+		return false;
+
+	_batch.clear();
+	while (head != tail && _batch.size() < LOG_BATCH_BYTES)
+	{
+		const char *at = _bytes + head % LOG_RING_BYTES;
+		LogRecord record;
+		memcpy(&record, at, sizeof(record));
+		if (record.type != LOG_RING_PAD)
+			_format(record, at + sizeof(record), _batch);
+		head += recordSize(record.length);
+	}
+	__atomic_store_n(&_head, head, __ATOMIC_RELEASE);
+	// the loss follows the records pushed before it
+	if (head == tail)
+		reportDropped();
+	writeAll(_out, _batch);
+	return true;
+}
+
+void LogRing::reportDropped()
+{
+	size_t dropped = __atomic_load_n(&_dropped, __ATOMIC_RELAXED);
+	if (dropped == _reported)
+		return;
+	LogRecord record = {LOG_RING_DROPPED, -1, (long)(dropped - _reported), 0, 0};
+	_format(record, "", _batch);
+	_reported = dropped;
+}
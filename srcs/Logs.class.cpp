@@ -2,86 +2,345 @@
 #include <unistd.h>
 #include <sys/socket.h>
 
+static void formatLog(const LogRecord &record, const char *text,
+	std::string &out);
+
+static LogRing g_ring(formatLog);
+
+static LogConfig g_config[LOG_CAT_COUNT] = {
+	{LOG_LEVEL_FULL, 1, 0},
+	{LOG_LEVEL_FULL, 1, 0},
+	{LOG_LEVEL_FULL, 1, 0},
+	{LOG_LEVEL_FULL, 1, 0},
+};
+static size_t g_sampled[LOG_CAT_COUNT]; // records with a text seen
+
+static const char *g_category_names[LOG_CAT_COUNT] = {
+	"connect", "buffer", "error", "bot"
+};
+static const char *g_level_names[] = {"off", "short", "full"};
+
 Logs::Logs(time_t start)
 	: _start_time(start)
 {
 
 }
 
-static std::string badEndlinesInRed(const std::string& text)
+int startLogWriter(int fd)
+{
+	std::cout.flush(); // what was written before stays first
+	return g_ring.start(fd);
+}
+
+void stopLogWriter()
+{
+	g_ring.stop();
+}
+
+size_t logQueueBytes()
+{
+	return g_ring.queued();
+}
+
+size_t logsDropped()
+{
+	return g_ring.dropped();
+}
+
+static e_log_category categoryOf(e_log type)
 {
-	std::string	result;
-	for (std::string::size_type i = 0; i < text.length(); ++i)
+	switch (type)
 	{
-		if (text[i] == '\r') {
-			if (i + 1 < text.length() && text[i + 1] == '\n')
-			{
-				result += "\n";
-				++i;
-			}
-			else
-				result += RED "\\r" RESET;
+		case LOG_BUFFER_IN:
+		case LOG_BUFFER_OUT:
+			return LOG_CAT_BUFFER;
+		case LOG_OVER_LIMIT:
+		case LOG_POLL_ERROR:
+			return LOG_CAT_ERROR;
+		case LOG_BOT_IN:
+		case LOG_BOT_OUT:
+			return LOG_CAT_BOT;
+		default:
+			return LOG_CAT_CONNECT;
+	}
+}
+
+void setLogConfig(e_log_category category, const LogConfig &config)
+{
+	g_config[category] = config;
+	if (!g_config[category].sample)
+		g_config[category].sample = 1;
+	g_sampled[category] = 0;
+}
+
+const LogConfig &logConfig(e_log_category category)
+{
+	return g_config[category];
+}
+
+// the errors are kept when SIGUSR1 made the logs quiet
+bool logWanted(e_log type)
+{
+	e_log_category category = categoryOf(type);
+	if (quietLogs() && category != LOG_CAT_ERROR)
+		return false;
+	return g_config[category].level != LOG_LEVEL_OFF;
+}
+
+const char *logCategoryName(e_log_category category)
+{
+	return g_category_names[category];
+}
+
+const char *logLevelName(e_log_level level)
+{
+	return g_level_names[level];
+}
+
+e_log_category logCategoryByName(const std::string &name)
+{
+	int i = 0;
+	while (i < LOG_CAT_COUNT && name != g_category_names[i])
+		++i;
+	return static_cast<e_log_category>(i);
+}
+
+e_log_level logLevelByName(const std::string &name)
+{
+	for (int i = LOG_LEVEL_OFF; i <= LOG_LEVEL_FULL; ++i)
+		if (name == g_level_names[i])
+			return static_cast<e_log_level>(i);
+	return static_cast<e_log_level>(-1);
+}
+
+// a text is sampled and cut here, value keeps its full size
+// the time is the only thing computed here, the rest on the writer
+void pushLog(e_log type, time_t start, int fd, long value, const char *text,
+	size_t length)
+{
+	if (!logWanted(type))
+		return;
+	if (length)
+	{
+		e_log_category category = categoryOf(type);
+		const LogConfig &config = g_config[category];
+		if (g_sampled[category]++ % config.sample)
+			return;
+		value = length;
+		if (config.level == LOG_LEVEL_SHORT)
+			length = 0;
+		else if (config.max_bytes && length > config.max_bytes)
+			length = config.max_bytes;
+	}
+	LogRecord record = {type, fd, value, time(0) - start, length};
+	if (g_ring.push(record, text) || g_ring.running())
+		return;
+
+	static std::string out;
+	out.clear();
+	formatLog(record, text, out);
+	std::cout << out << std::flush;
+}
+
+static void appendNumber(std::string &out, long n)
+{
+	char digits[24];
+	size_t i = sizeof(digits);
+	bool negative = n < 0;
+	unsigned long u = negative ? -(unsigned long)n : n;
+	do
+		digits[--i] = '0' + u % 10;
+	while (u /= 10);
+	if (negative)
+		digits[--i] = '-';
+	out.append(digits + i, sizeof(digits) - i);
+}
+
+static void appendTwoDigits(std::string &out, long n)
+{
+	if (n < 10)
+		out += '0';
+	appendNumber(out, n);
+}
+
+// Example: "[01:02:03] "
+static void appendElapsed(std::string &out, time_t elapsed)
+{
+	out += '[';
+	appendTwoDigits(out, elapsed / 3600);
+	out += ':';
+	appendTwoDigits(out, (elapsed % 3600) / 60);
+	out += ':';
+	appendTwoDigits(out, elapsed % 60);
+	out += "] ";
+}
+
+static void badEndlinesInRed(std::string &out, const char *text, size_t length)
+{
+	size_t start = 0;
+	for (size_t i = 0; i < length; ++i)
+	{
+		if (text[i] != '\r' && text[i] != '\n')
+			continue;
+		out.append(text + start, i - start);
+		if (text[i] == '\r' && i + 1 < length && text[i + 1] == '\n')
+		{
+			out += '\n';
+			++i;
 		}
-		else if (text[i] == '\n')
-			result += RED "\\n" RESET;
+		else if (text[i] == '\r')
+			out += RED "\\r" RESET;
 		else
-			result += text[i];
+			out += RED "\\n" RESET;
+		start = i + 1;
 	}
-	return (result);
+	out.append(text + start, length - start);
 }
 
-void	Logs::logsConnect(int new_s_fd, int n_fds)
+// the text, or its size only if it was cut to nothing
+static void appendText(std::string &out, const LogRecord &r, const char *text,
+	bool escape)
 {
-	displayElapsedTime(_start_time);
-
-	std::cout << GREEN "New connection" RESET << " with client (" << new_s_fd << ")" << std::endl;
-	std::cout << "Total connected: " << n_fds << "\n" << std::endl;
+	if (r.value && !r.length)
+	{
+		out += ' ';
+		appendNumber(out, r.value);
+		out += " bytes\n";
+		return;
+	}
+	out += '\n';
+	if (escape)
+		badEndlinesInRed(out, text, r.length);
+	else
+		out.append(text, r.length);
+	if (r.value > (long)r.length)
+	{
+		out += ORANGE "... ";
+		appendNumber(out, r.value);
+		out += " bytes" RESET;
+	}
+	out += '\n';
 }
 
-void	Logs::logsDisconnect(int s_fd, int n_fds)
+static void appendClient(std::string &out, const char *before, int fd,
+	const char *after)
 {
-	displayElapsedTime(_start_time);
+	out += before;
+	appendNumber(out, fd);
+	out += after;
+}
 
-	std::cout << RED "Disconnected" RESET << " client (" << s_fd << ")" << std::endl;
-	std::cout << "Total connected: " << n_fds - 1 << "\n" << std::endl;
+// on the writer thread, or right away before it starts
+static void formatLog(const LogRecord &r, const char *text, std::string &out)
+{
+	if (r.type == LOG_RING_DROPPED)
+	{
+		out += ORANGE;
+		appendNumber(out, r.value);
+		out += " log records dropped" RESET "\n";
+		return;
+	}
+	if (r.type == LOG_CLOSE_ALL)
+	{
+		out += UNDERLINE "\n\nClosing all connections:" RESET "\n";
+		return;
+	}
+	appendElapsed(out, r.elapsed);
+	switch (r.type)
+	{
+		case LOG_CONNECT:
+			appendClient(out, GREEN "New connection" RESET " with client (", r.fd, ")\n");
+			out += "Total connected: ";
+			appendNumber(out, r.value);
+			out += "\n\n";
+			break;
+		case LOG_DISCONNECT:
+			appendClient(out, RED "Disconnected" RESET " client (", r.fd, ")\n");
+			out += "Total connected: ";
+			appendNumber(out, r.value);
+			out += "\n\n";
+			break;
+		case LOG_BUFFER_IN:
+		case LOG_BUFFER_OUT:
+			out += r.type == LOG_BUFFER_IN ? TEAL "Buffer_in" RESET
+				: MAGENTA "Buffer_out" RESET;
+			appendClient(out, " for client (", r.fd, "):");
+			appendText(out, r, text, true);
+			break;
+		case LOG_OVER_LIMIT:
+			appendClient(out, "Client (", r.fd, ") incoming data is "
+				ORANGE "over 512 bytes" RESET "\n");
+			out += "It will be disconnected to avoid flooding\n\n";
+			break;
+		case LOG_BYTES_SAVED:
+			appendClient(out, "Client (", r.fd, ") saved " GREEN);
+			appendNumber(out, r.value);
+			out += " bytes" RESET " with plain replies\n";
+			break;
+		case LOG_END_CLIENT:
+			appendClient(out, "Closing connection with client (", r.fd, ")\n");
+			break;
+		case LOG_END_SOCKET:
+			out += "Closing the listening socket\n";
+			break;
+		case LOG_POLL_ERROR:
+			out += RED "Poll error: ";
+			appendNumber(out, r.value);
+			out += RESET "\n";
+			break;
+		case LOG_BOT_IN:
+		case LOG_BOT_OUT:
+			out += r.type == LOG_BOT_IN ? TEAL "Buffer_in" RESET
+				: MAGENTA "Buffer_out" RESET;
+			out += " for " ORANGE "BOT" RESET ":";
+			appendText(out, r, text, false);
+			break;
+	}
 }
 
-void	Logs::logsBuffer(int s_fd, std::string &buffer, bool which)
+void	Logs::logsConnect(int new_s_fd, int n_fds)
 {
-	displayElapsedTime(_start_time);
+	pushLog(LOG_CONNECT, _start_time, new_s_fd, n_fds);
+}
 
-	if (which) // buffer_in
-		std::cout << TEAL "Buffer_in" RESET;
-	else // buffer_out
-		std::cout << MAGENTA "Buffer_out" RESET;
+void	Logs::logsDisconnect(int s_fd, int n_fds)
+{
+	pushLog(LOG_DISCONNECT, _start_time, s_fd, n_fds - 1);
+}
 
-	std::cout << " for client (" << s_fd << "):" << std::endl;
-	std::cout << badEndlinesInRed(buffer) << std::endl; 
+void	Logs::logsBuffer(int s_fd, std::string &buffer, bool which)
+{
+	pushLog(which ? LOG_BUFFER_IN : LOG_BUFFER_OUT, _start_time, s_fd, 0,
+		buffer.data(), buffer.size());
 }
 
 void	Logs::logsBufferOverLimit(int s_fd)
 {
-	displayElapsedTime(_start_time);
+	pushLog(LOG_OVER_LIMIT, _start_time, s_fd, 0);
+}
 
-	std::cout << "Client (" << s_fd << ") incoming data is " << ORANGE "over 512 bytes" RESET << std::endl;
-	std::cout << "It will be disconnected to avoid flooding\n" << std::endl;
+void	Logs::logsBytesSaved(int s_fd, size_t bytes)
+{
+	pushLog(LOG_BYTES_SAVED, _start_time, s_fd, bytes);
 }
 
 void	Logs::logsEnd(int s_fd, bool which)
 {
-	displayElapsedTime(_start_time);
+	pushLog(which ? LOG_END_CLIENT : LOG_END_SOCKET, _start_time, s_fd, 0);
+}
 
-	if (which) // client
-		std::cout << "Closing connection with client (" << s_fd << ")" << std::endl;
-	else // socket
-		std::cout << "Closing the listening socket" << std::endl;
+void	Logs::logsCloseAll()
+{
+	pushLog(LOG_CLOSE_ALL, _start_time, -1, 0);
 }
+
 void	Logs::logsError(int fd)
 {
+	if (!logWanted(LOG_POLL_ERROR))
+		return;
 	int err = 0;
 	socklen_t len = sizeof(err);
 	getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
 
-	displayElapsedTime(_start_time);
-	std::cout << RED "Poll error: " << err << "" RESET << std::endl;
+	pushLog(LOG_POLL_ERROR, _start_time, fd, err);
 }
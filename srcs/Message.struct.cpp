@@ -1,61 +1,105 @@
+#include <algorithm> // std::min()
+#include <cctype>    // std::isalnum()
+
 #include "Message.struct.hpp"
-#include <sstream>
-#include <algorithm>
+#include "dictionary.hpp"
 #include "numerics.hpp"
 
+static size_t skipSpaces(const std::string &raw, size_t i, size_t end)
+{
+	while (i < end && raw[i] == ' ')
+		++i;
+	return i;
+}
+
+static size_t wordEnd(const std::string &raw, size_t i, size_t end)
+{
+	size_t space = raw.find(' ', i);
+	if (space == std::string::npos || space > end)
+		return end;
+	return space;
+}
+
 // Example: Message(42, "NICK alice\r\n")
 // parse raw string into verb="NICK", params=["alice"]
 Message::Message(int fd, const std::string &raw)
-	: fd(fd)
 {
+	parse(fd, raw);
+}
+
+// the fields are assigned, not rebuilt, so they keep their capacity
+static void setParam(std::vector<std::string> &params, size_t n,
+	const std::string &raw, size_t begin, size_t len)
+{
+	if (n < params.size())
+		params[n].assign(raw, begin, len);
+	else
+		params.push_back(raw.substr(begin, len));
+}
+
+// single pass, tags are kept escaped in their own buffer
+// only the first line of raw is read, up to "\r\n"
+void Message::parse(int fd, const std::string &raw)
+{
+	this->fd = fd;
+	tags.clear();
+	source.clear();
+	too_long = false;
+	saved = 0;
+	size_t n_params = 0;
+
 	// find end, skipping single \r or \n
-	size_t end_pos = raw.find("\r\n");
-	if (end_pos == std::string::npos)
-		end_pos = raw.length();
+	size_t end = raw.find("\r\n");
+	if (end == std::string::npos)
+		end = raw.length();
+
+	// parse optional tags
+	size_t i = 0;
+	if (i < end && raw[i] == '@')
+	{
+		size_t tags_end = wordEnd(raw, i, end);
+		size_t tags_len = tags_end - 1;
+		// not cut: a cut could end in the middle of an escape
+		if (tags_len > MAX_TAGS_LEN - 2)
+			too_long = true;
+		else
+			tags.assign(raw, 1, tags_len);
+		i = skipSpaces(raw, tags_end, end);
+	}
 
-	// max 512 bytes including \r\n
-	if (end_pos > 510)
-		end_pos = 510;
-	
-	std::stringstream ss(raw.substr(0, end_pos));
+	// max 512 bytes including \r\n, tags not included
+	if (end - i > MAX_MSG_LEN - 2)
+		end = i + MAX_MSG_LEN - 2;
 
 	// parse optional source prefix
-	if (ss.peek() == ':')
+	if (i < end && raw[i] == ':')
 	{
-		ss.ignore(1);
-		std::getline(ss, source, ' ');
+		size_t source_end = wordEnd(raw, i + 1, end);
+		source.assign(raw, i + 1, source_end - i - 1);
+		i = skipSpaces(raw, source_end, end);
 	}
 
-	// skip spaces
-	while (ss.peek() == ' ')
-		ss.ignore(1);
-
 	// parse verb
-	std::getline(ss, verb, ' ');
-
-	// skip spaces
-	while (ss.peek() == ' ')
-		ss.ignore(1);
+	size_t verb_end = wordEnd(raw, i, end);
+	verb.assign(raw, i, verb_end - i);
+	i = skipSpaces(raw, verb_end, end);
 
 	// parse optional parameteers, and trailing text
-	std::string param;
-	while (ss.good())
+	while (i < end)
 	{
-		if (ss.peek() == ':')
+		if (raw[i] == ':')
 		{
-			ss.ignore(1);
-			std::getline(ss, param);
-			params.push_back(param);
+			size_t trailing_end = raw.find('\n', i + 1);
+			if (trailing_end == std::string::npos || trailing_end > end)
+				trailing_end = end;
+			setParam(params, n_params++, raw, i + 1, trailing_end - i - 1);
 			break ;
 		}
-		std::getline(ss, param, ' ');
-		if (!param.empty())
-			params.push_back(param);
-
-		// skip spaces
-		while (ss.peek() == ' ')
-			ss.ignore(1);
+		size_t param_end = wordEnd(raw, i, end);
+		setParam(params, n_params++, raw, i, param_end - i);
+		i = skipSpaces(raw, param_end, end);
 	}
+	params.resize(n_params);
 }
 
 // Example: verb="PRIVMSG", params=["#channel", "hello"]
@@ -64,19 +108,177 @@ std::string Message::assemble() const
 {
 	std::string raw;
 
+	if (!tags.empty())
+	{
+		raw += '@';
+		raw += tags;
+		raw += ' ';
+	}
+	assembleBody(raw);
+	return raw;
+}
+
+void Message::assembleBody(std::string &raw) const
+{
 	if (!source.empty())
-		raw += ":" + source + " ";
+	{
+		raw += ':';
+		raw += source;
+		raw += ' ';
+	}
 
 	raw += verb;
 
 	for (size_t i = 0; i + 1 < params.size(); i++)
-		raw += " " + params[i];
+	{
+		raw += ' ';
+		raw += params[i];
+	}
 
 	if (!params.empty())
-		raw += " :" + params.back();
+	{
+		raw += " :";
+		raw += params.back();
+	}
 
 	raw += "\r\n";
-	return raw;
+}
+
+// Example: "a;b" is sent as "a\:b"
+static void escapeTagValue(const std::string &value, std::string &out)
+{
+	for (size_t i = 0; i < value.size(); ++i)
+	{
+		switch (value[i])
+		{
+			case ';': out += "\\:"; break;
+			case ' ': out += "\\s"; break;
+			case '\\': out += "\\\\"; break;
+			case '\r': out += "\\r"; break;
+			case '\n': out += "\\n"; break;
+			default: out += value[i];
+		}
+	}
+}
+
+// reverse of escapeTagValue, a lone trailing '\' is dropped
+static void unescapeTagValue(const std::string &raw, size_t begin, size_t end,
+	std::string &out)
+{
+	out.clear();
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (raw[i] != '\\')
+		{
+			out += raw[i];
+			continue;
+		}
+		if (++i == end)
+			break;
+		switch (raw[i])
+		{
+			case ':': out += ';'; break;
+			case 's': out += ' '; break;
+			case 'r': out += '\r'; break;
+			case 'n': out += '\n'; break;
+			default: out += raw[i];
+		}
+	}
+}
+
+// Example: tags="+typing=active;time=x", getTag("+typing", v) gives "active"
+bool Message::getTag(const std::string &key, std::string &value) const
+{
+	size_t i = 0;
+	while (i < tags.size())
+	{
+		size_t tag_end = tags.find(';', i);
+		if (tag_end == std::string::npos)
+			tag_end = tags.size();
+		size_t key_end = tags.find('=', i);
+		if (key_end == std::string::npos || key_end > tag_end)
+			key_end = tag_end;
+		if (tags.compare(i, key_end - i, key) == 0)
+		{
+			if (key_end == tag_end)
+				value.clear();
+			else
+				unescapeTagValue(tags, key_end + 1, tag_end, value);
+			return true;
+		}
+		i = tag_end + 1;
+	}
+	return false;
+}
+
+void Message::addTag(const std::string &key, const std::string &value)
+{
+	if (!tags.empty())
+		tags += ';';
+	tags += key;
+	if (value.empty())
+		return;
+	tags += '=';
+	escapeTagValue(value, tags);
+}
+
+static bool isKeyChar(char c)
+{
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '-';
+}
+
+// Example: "+example.com/typing=a" is valid, "+/typing", "+a_b" are not
+static bool isValidClientTag(const std::string &tags, size_t begin, size_t end)
+{
+	size_t key_end = std::min(tags.find('=', begin), end);
+	size_t name = begin + 1; // after the '+'
+	size_t slash = tags.find('/', name);
+	if (slash < key_end) // a vendor, a host name
+	{
+		if (slash == name)
+			return false;
+		for (size_t i = name; i < slash; ++i)
+			if (!isKeyChar(tags[i]) && tags[i] != '.')
+				return false;
+		name = slash + 1;
+	}
+	if (name == key_end)
+		return false;
+	for (size_t i = name; i < key_end; ++i)
+		if (!isKeyChar(tags[i]))
+			return false;
+	for (size_t i = key_end; i < end; ++i)
+		if (tags[i] == '\0' || tags[i] == '\r' || tags[i] == '\n')
+			return false;
+	return true;
+}
+
+std::string Message::clientTags() const
+{
+	std::string client_tags;
+	size_t i = 0;
+	while (i < tags.size())
+	{
+		size_t tag_end = tags.find(';', i);
+		if (tag_end == std::string::npos)
+			tag_end = tags.size();
+		if (tags[i] == '+' && isValidClientTag(tags, i, tag_end))
+		{
+			if (!client_tags.empty())
+				client_tags += ';';
+			client_tags.append(tags, i, tag_end - i);
+		}
+		i = tag_end + 1;
+	}
+	return client_tags;
+}
+
+bool Message::sameFrame(const Message &other) const
+{
+	return verb == other.verb &&
+		   source == other.source &&
+		   tags == other.tags &&
+		   params == other.params;
 }
 
 static bool _invalid(const std::string &s)
@@ -86,9 +288,10 @@ static bool _invalid(const std::string &s)
 
 // Validate message format
 // check: verb not empty, params don't contain spaces (except last)
+// a verb starting like a source or tags would not assemble back
 bool Message::isValid() const
 {
-	if (_invalid(verb))
+	if (_invalid(verb) || verb[0] == ':' || verb[0] == '@')
 		return false;
 	if (!source.empty() && _invalid(source))
 		return false;
@@ -103,7 +306,8 @@ bool operator==(const Message &msg1, const Message &msg2)
 	return msg1.fd == msg2.fd &&
 		   msg1.source == msg2.source &&
 		   msg1.verb == msg2.verb &&
-		   msg1.params == msg2.params;
+		   msg1.params == msg2.params &&
+		   msg1.tags == msg2.tags;
 }
 
 bool operator==(const Message &msg, const std::string &raw)
@@ -126,7 +330,7 @@ Message::Message(
 	int fd,
 	const std::string &verb,
 	const std::vector<std::string> &params)
-	: fd(fd), source(source), verb(verb), params(params)
+	: fd(fd), source(source), verb(verb), params(params), too_long(false), saved(0)
 {
 }
 
@@ -134,7 +338,7 @@ Message::Message(
 	const std::string &source,
 	int fd,
 	const std::string &verb)
-	: fd(fd), source(source), verb(verb)
+	: fd(fd), source(source), verb(verb), too_long(false), saved(0)
 {
 }
 
@@ -143,7 +347,7 @@ Message::Message(
 	int fd,
 	const std::string &verb,
 	const std::string &param)
-	: fd(fd), source(source), verb(verb)
+	: fd(fd), source(source), verb(verb), too_long(false), saved(0)
 {
 	params.push_back(param);
 }
@@ -154,7 +358,7 @@ Message::Message(
 	const std::string &verb,
 	const std::string &param1,
 	const std::string &param2)
-	: fd(fd), source(source), verb(verb)
+	: fd(fd), source(source), verb(verb), too_long(false), saved(0)
 {
 	params.push_back(param1);
 	params.push_back(param2);
@@ -167,7 +371,7 @@ Message::Message(
 	const std::string &param1,
 	const std::string &param2,
 	const std::string &param3)
-	: fd(fd), source(source), verb(verb)
+	: fd(fd), source(source), verb(verb), too_long(false), saved(0)
 {
 	params.push_back(param1);
 	params.push_back(param2);
@@ -178,7 +382,7 @@ Message::Message(
 	int fd,
 	const std::string &verb,
 	const std::string &param)
-	: fd(fd), verb(verb)
+	: fd(fd), verb(verb), too_long(false), saved(0)
 {
 	params.push_back(param);
 }
@@ -188,7 +392,7 @@ Message::Message(
 	const std::string &verb,
 	const std::string &param1,
 	const std::string &param2)
-	: fd(fd), verb(verb)
+	: fd(fd), verb(verb), too_long(false), saved(0)
 {
 	params.push_back(param1);
 	params.push_back(param2);
@@ -200,31 +404,13 @@ Message::Message(
 	const std::string &param1,
 	const std::string &param2,
 	const std::string &param3)
-	: fd(fd), verb(verb)
+	: fd(fd), verb(verb), too_long(false), saved(0)
 {
 	params.push_back(param1);
 	params.push_back(param2);
 	params.push_back(param3);
 }
 
-// functor needed for std::find_if
-struct HasFd
-{
-	int target_fd;
-	explicit HasFd(int fd) : target_fd(fd) {}
-	bool operator()(const Message &msg) const
-	{
-		return msg.fd == target_fd;
-	}
-};
-
-// easy find a message by its id (fd)
-const Message* find_by_fd(const std::vector<Message>& vec, int fd) {
-    std::vector<Message>::const_iterator it = 
-        std::find_if(vec.begin(), vec.end(), HasFd(fd));
-    return (it != vec.end()) ? &(*it) : 0;
-}
-
 // helper to broadcast the same message to other clients
 // (the vector doesn't include the original 
 // fd unless it is in the fds parameter)
@@ -237,7 +423,7 @@ std::vector<Message> Message::repeat(const std::vector<int> &fds) const
 }
 
 // helper to broadcast the same message to other clients
-// example usage: msg.repeat(channel.client_ids)
+// example usage: msg.repeat(std::set<int>(fds))
 std::vector<Message> Message::repeat(const std::set<int> &fds) const
 {
 	std::vector<Message> messages(fds.size(), *this);
@@ -260,5 +446,8 @@ Message &Message::operator=(const Message &other)
 	this->source = other.source;
 	this->verb = other.verb;
 	this->params = other.params;
+	this->tags = other.tags;
+	this->too_long = other.too_long;
+	this->saved = other.saved;
 	return *this;
 }
\ No newline at end of file
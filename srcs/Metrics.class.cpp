@@ -0,0 +1,342 @@
+#include <cerrno>   // errno, EWOULDBLOCK
+#include <ctime>    // time()
+
+#include <poll.h>       // POLLIN, POLLOUT, POLLERR, POLLHUP
+#include <sys/socket.h> // recv(), send()
+#include <unistd.h>     // close(), unlink()
+
+#include "dictionary.hpp"
+#include "handlers.hpp" // size_to_str()
+#include "Logs.class.hpp"
+#include "Metrics.class.hpp"
+#include "utils.hpp"
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0 // a scraper that left would raise SIGPIPE
+#endif
+
+#define METRICS_OK "HTTP/1.0 200 OK\r\n" \
+	"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n" \
+	"Connection: close\r\n\r\n"
+#define METRICS_NOT_FOUND "HTTP/1.0 404 Not Found\r\n" \
+	"Content-Type: text/plain\r\n" \
+	"Connection: close\r\n\r\n" \
+	"only GET /metrics\n"
+
+Scrape::Scrape()
+	: sent(0), section(0), replying(false)
+{
+
+}
+
+// --- Rendering, one family (or a few gauges) per section ---
+
+typedef void section_fn(const State &state, std::string &out);
+
+static void family(std::string &out, const char *name, const char *type,
+	const char *help)
+{
+	out += "# HELP ";
+	out += name;
+	out += ' ';
+	out += help;
+	out += "\n# TYPE ";
+	out += name;
+	out += ' ';
+	out += type;
+	out += '\n';
+}
+
+// Example: sample(out, "ircserv_clients", "state=\"registered\"", "3")
+static void sample(std::string &out, const char *name, const std::string &labels,
+	const std::string &value)
+{
+	out += name;
+	if (!labels.empty())
+		out += '{' + labels + '}';
+	out += ' ';
+	out += value;
+	out += '\n';
+}
+
+// Example: 1234567 ns gives "0.001234567"
+static std::string secondsToStr(uint64_t nsec)
+{
+	std::string fraction = size_to_str(nsec % 1000000000);
+	return size_to_str(nsec / 1000000000) + "."
+		+ std::string(9 - fraction.size(), '0') + fraction;
+}
+
+static void counter(std::string &out, const char *name, const char *help,
+	size_t value)
+{
+	family(out, name, "counter", help);
+	sample(out, name, "", size_to_str(value));
+}
+
+static void gauge(std::string &out, const char *name, const char *help,
+	size_t value)
+{
+	family(out, name, "gauge", help);
+	sample(out, name, "", size_to_str(value));
+}
+
+// the samples of a summary, labels is empty or ends with ','
+static void summary(std::string &out, const std::string &name,
+	const std::string &labels, const LatencyHistogram &h)
+{
+	sample(out, name.c_str(), labels + "quantile=\"0.5\"",
+		secondsToStr(h.percentile(0.5)));
+	sample(out, name.c_str(), labels + "quantile=\"0.99\"",
+		secondsToStr(h.percentile(0.99)));
+	std::string bare = labels.empty() ? "" : labels.substr(0, labels.size() - 1);
+	sample(out, (name + "_sum").c_str(), bare, secondsToStr(h.sum()));
+	sample(out, (name + "_count").c_str(), bare, size_to_str(h.count()));
+}
+
+static void histogram(std::string &out, const std::string &name,
+	const char *help, const SizeHistogram &h)
+{
+	family(out, name.c_str(), "histogram", help);
+	std::string bucket = name + "_bucket";
+	size_t cumulative = 0;
+	for (size_t i = 0; i < STATS_SIZE_BUCKETS; ++i)
+	{
+		cumulative += h.bucket(i);
+		sample(out, bucket.c_str(), "le=\"" + size_to_str((size_t)1 << i) + "\"",
+			size_to_str(cumulative));
+	}
+	sample(out, bucket.c_str(), "le=\"+Inf\"", size_to_str(h.count()));
+	sample(out, (name + "_sum").c_str(), "", size_to_str(h.sum()));
+	sample(out, (name + "_count").c_str(), "", size_to_str(h.count()));
+}
+
+static void renderServer(const State &state, std::string &out)
+{
+	gauge(out, "ircserv_uptime_seconds", "Seconds since the server started.",
+		time(0) - state.start_time);
+	family(out, "ircserv_clients", "gauge", "Clients by registration state.");
+	sample(out, "ircserv_clients", "state=\"registered\"",
+		size_to_str(state.n_registered));
+	sample(out, "ircserv_clients", "state=\"unregistered\"",
+		size_to_str(state.unregistered()));
+	gauge(out, "ircserv_opers", "Server operators online.", state.n_opers);
+	gauge(out, "ircserv_channels", "Channels formed.", state.channels.size());
+}
+
+static void renderConnections(const State &state, std::string &out)
+{
+	gauge(out, "ircserv_connections", "Client sockets open.",
+		state.stats.connections());
+	counter(out, "ircserv_connections_accepted_total",
+		"Client sockets accepted.", state.stats.accepted());
+	counter(out, "ircserv_received_bytes_total",
+		"Bytes received from the clients.", state.stats.bytesIn());
+	counter(out, "ircserv_sent_bytes_total",
+		"Bytes sent to the clients.", state.stats.bytesOut());
+}
+
+static void renderSendQueues(const State &state, std::string &out)
+{
+	gauge(out, "ircserv_sendq_bytes", "Bytes waiting in all the SendQs.",
+		state.stats.sendQueued());
+	histogram(out, "ircserv_sendq_depth_bytes",
+		"SendQ of a client when it was sent to.", state.stats.sendQueueDepth());
+}
+
+static std::string verbLabel(const VerbStats &verb)
+{
+	return "verb=\"" + std::string(verb.verb) + "\"";
+}
+
+static void renderCommands(const State &state, std::string &out)
+{
+	family(out, "ircserv_commands_total", "counter", "Lines handled by verb.");
+	for (size_t i = 0; i < STATS_N_VERBS; ++i)
+		sample(out, "ircserv_commands_total", verbLabel(state.stats.verb(i)),
+			size_to_str(state.stats.verb(i).latency.count()));
+	family(out, "ircserv_command_bytes_total", "counter",
+		"Bytes of the lines handled by verb.");
+	for (size_t i = 0; i < STATS_N_VERBS; ++i)
+		sample(out, "ircserv_command_bytes_total", verbLabel(state.stats.verb(i)),
+			size_to_str(state.stats.verb(i).bytes));
+}
+
+static void renderDurations(const State &state, std::string &out)
+{
+	family(out, "ircserv_command_duration_seconds", "summary",
+		"Time in the handler by verb.");
+	for (size_t i = 0; i < STATS_N_VERBS; ++i)
+		summary(out, "ircserv_command_duration_seconds",
+			verbLabel(state.stats.verb(i)) + ",", state.stats.verb(i).latency);
+}
+
+static void renderFanout(const State &state, std::string &out)
+{
+	histogram(out, "ircserv_fanout_messages",
+		"Messages queued for one line received.", state.stats.fanouts());
+}
+
+static void renderEventLoop(const State &state, std::string &out)
+{
+	counter(out, "ircserv_event_loop_iterations_total",
+		"Returns from poll().", state.stats.iterations());
+	counter(out, "ircserv_event_loop_busy_total",
+		"Returns from poll() with ready fds.", state.stats.busyWakeups());
+	counter(out, "ircserv_event_loop_ready_fds_total",
+		"Ready fds over all the returns from poll().", state.stats.readyFds());
+	family(out, "ircserv_event_loop_lag_seconds", "summary",
+		"Time between two calls to poll().");
+	summary(out, "ircserv_event_loop_lag_seconds", "", state.stats.loopLag());
+}
+
+static void renderLogs(const State &state, std::string &out)
+{
+	(void)state;
+	gauge(out, "ircserv_log_queue_bytes",
+		"Log records waiting for the writer thread.", logQueueBytes());
+	counter(out, "ircserv_log_dropped_total",
+		"Log records lost to a full queue.", logsDropped());
+}
+
+static section_fn *const g_sections[] = {
+	renderServer, renderConnections, renderSendQueues, renderCommands,
+	renderDurations, renderFanout, renderEventLoop, renderLogs
+};
+
+#define N_SECTIONS (sizeof(g_sections) / sizeof(g_sections[0]))
+
+std::string Metrics::render(const State &state)
+{
+	std::string out = METRICS_OK;
+	for (size_t i = 0; i < N_SECTIONS; ++i)
+		g_sections[i](state, out);
+	return out;
+}
+
+// --- Serving ---
+
+Metrics::Metrics()
+	: _listen(-1)
+{
+
+}
+
+Metrics::~Metrics()
+{
+	while (!_scrapes.empty())
+		drop(_scrapes.begin()->first);
+	if (_listen < 0)
+		return;
+	close(_listen);
+	if (!_path.empty())
+		unlink(_path.c_str());
+}
+
+int Metrics::listen(const std::string &address)
+{
+	if (_listen >= 0)
+		return (error("metrics already served"), ERROR);
+	_listen = initLocalSocket(address);
+	if (_listen == ERROR)
+		return (_listen = -1, ERROR);
+	if (address[0] == '/')
+		_path = address;
+	return (OK);
+}
+
+int Metrics::listenFd() const
+{
+	return _listen;
+}
+
+bool Metrics::owns(int fd) const
+{
+	return fd >= 0 && (fd == _listen || _scrapes.count(fd));
+}
+
+int Metrics::accept()
+{
+	int fd = acceptNonBlocking(_listen);
+	if (fd == ERROR)
+	{
+		errno = 0;
+		return (ERROR);
+	}
+	_scrapes[fd] = Scrape();
+	return (fd);
+}
+
+void Metrics::drop(int fd)
+{
+	close(fd);
+	_scrapes.erase(fd);
+}
+
+short Metrics::ready(int fd, short revents, const State &state)
+{
+	std::map<int, Scrape>::iterator it = _scrapes.find(fd);
+	if (it == _scrapes.end())
+		return 0;
+	Scrape &scrape = it->second;
+	bool open = !(revents & (POLLERR | POLLHUP | POLLNVAL));
+	if (open && !scrape.replying && (revents & POLLIN))
+		open = readRequest(fd, scrape);
+	if (open && scrape.replying && (revents & (POLLIN | POLLOUT)))
+		open = writeReply(fd, scrape, state);
+	if (!open)
+		return (drop(fd), 0);
+	return scrape.replying ? POLLOUT : POLLIN;
+}
+
+// false to close: the client left or sent too much
+// the request line is the only one looked at, the headers are skipped
+bool Metrics::readRequest(int fd, Scrape &scrape)
+{
+	char buffer[1024];
+	ssize_t b_read = recv(fd, buffer, sizeof(buffer), 0);
+	if (b_read < 0 && errno == EWOULDBLOCK)
+		return (errno = 0, true);
+	if (b_read <= 0)
+		return false;
+	scrape.request.append(buffer, b_read);
+	if (scrape.request.find("\n\r\n") == std::string::npos
+		&& scrape.request.find("\n\n") == std::string::npos)
+		return scrape.request.size() <= METRICS_MAX_REQUEST;
+
+	std::string line = scrape.request.substr(0, scrape.request.find('\n'));
+	std::string path = line.compare(0, 4, "GET ") ? "" : line.substr(4);
+	path = path.substr(0, path.find_first_of(" ?\r"));
+	if (path == "/metrics")
+		scrape.out = METRICS_OK;
+	else
+	{
+		scrape.out = METRICS_NOT_FOUND;
+		scrape.section = N_SECTIONS;
+	}
+	scrape.request.clear();
+	scrape.replying = true;
+	return true;
+}
+
+// renders the next family only once the previous one is sent
+// false to close: all sent, or the client left
+bool Metrics::writeReply(int fd, Scrape &scrape, const State &state)
+{
+	if (scrape.sent == scrape.out.size())
+	{
+		if (scrape.section == N_SECTIONS)
+			return false;
+		scrape.out.clear();
+		scrape.sent = 0;
+		g_sections[scrape.section++](state, scrape.out);
+	}
+	ssize_t b_send = send(fd, scrape.out.data() + scrape.sent,
+		scrape.out.size() - scrape.sent, MSG_NOSIGNAL);
+	if (b_send < 0 && errno == EWOULDBLOCK)
+		return (errno = 0, true);
+	if (b_send < 0)
+		return false;
+	scrape.sent += b_send;
+	return !(scrape.sent == scrape.out.size() && scrape.section == N_SECTIONS);
+}
@@ -0,0 +1,62 @@
+#include "ModeMask.class.hpp"
+
+ModeMask::ModeMask()
+	: _bits(0)
+{
+
+}
+
+unsigned int ModeMask::bit(char c)
+{
+	if (c < 'a' || c > 'z')
+		return 0;
+	return MODE_BIT(c);
+}
+
+unsigned int ModeMask::bits() const
+{
+	return _bits;
+}
+
+size_t ModeMask::count(char c) const
+{
+	return (_bits & bit(c)) ? 1 : 0;
+}
+
+void ModeMask::insert(char c)
+{
+	_bits |= bit(c);
+}
+
+void ModeMask::erase(char c)
+{
+	_bits &= ~bit(c);
+}
+
+bool ModeMask::empty() const
+{
+	return _bits == 0;
+}
+
+void ModeMask::clear()
+{
+	_bits = 0;
+}
+
+std::string ModeMask::render() const
+{
+	std::string modestring = "+";
+	for (char c = 'a'; c <= 'z'; ++c)
+		if (_bits & MODE_BIT(c))
+			modestring += c;
+	return modestring;
+}
+
+ModeMask ModeMask::parse(const std::string &modestring)
+{
+	ModeMask modes;
+	size_t i = (!modestring.empty() && modestring[0] == '+') ? 1 : 0;
+	for (; i < modestring.size(); ++i)
+		modes.insert(modestring[i]);
+	return modes;
+}
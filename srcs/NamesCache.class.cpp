@@ -0,0 +1,120 @@
+#include "NamesCache.class.hpp"
+
+NamesCache::NamesCache()
+	: _bytes(0), _budget(0)
+{
+
+}
+
+const std::vector<std::string> &NamesCache::chunks() const
+{
+	return _chunks;
+}
+
+// appended to the last chunk, a new one is started when it is full
+// an entry longer than the budget still gets a chunk of its own
+void NamesCache::add(const std::string &entry, size_t budget)
+{
+	if (entry.empty())
+		return;
+	_budget = budget;
+	_bytes += entry.size();
+	if (!_chunks.empty()
+		&& _chunks.back().size() + 1 + entry.size() <= budget)
+	{
+		_chunks.back() += ' ';
+		_chunks.back() += entry;
+		return;
+	}
+	_chunks.push_back(entry);
+}
+
+// position of the whole entry in chunk, npos if it is not there
+static size_t findEntry(const std::string &chunk, const std::string &entry)
+{
+	size_t pos = 0;
+	while ((pos = chunk.find(entry, pos)) != std::string::npos)
+	{
+		size_t end = pos + entry.size();
+		if ((pos == 0 || chunk[pos - 1] == ' ')
+			&& (end == chunk.size() || chunk[end] == ' '))
+			return pos;
+		pos = end;
+	}
+	return std::string::npos;
+}
+
+void NamesCache::remove(const std::string &entry)
+{
+	if (entry.empty())
+		return;
+	for (size_t i = 0; i < _chunks.size(); ++i)
+	{
+		std::string &chunk = _chunks[i];
+		size_t pos = findEntry(chunk, entry);
+		if (pos == std::string::npos)
+			continue;
+
+		// the entry and the space after it, or before it for the last one
+		if (pos + entry.size() < chunk.size())
+			chunk.erase(pos, entry.size() + 1);
+		else if (pos > 0)
+			chunk.erase(pos - 1, entry.size() + 1);
+		else
+			chunk.clear();
+		if (chunk.empty())
+			_chunks.erase(_chunks.begin() + i);
+		_bytes -= entry.size();
+
+		// holes left by removals: packed again once half the chunks could go
+		if (_chunks.size() > 1 && _bytes * 2 < (_chunks.size() - 1) * _budget)
+			repack();
+		return;
+	}
+}
+
+// a nick or a prefix change, old or new entry can be empty
+void NamesCache::replace(const std::string &old_entry,
+	const std::string &new_entry, size_t budget)
+{
+	remove(old_entry);
+	add(new_entry, budget);
+}
+
+void NamesCache::clear()
+{
+	_chunks.clear();
+	_bytes = 0;
+}
+
+// adds the entries of chunk to another cache, with its budget
+void NamesCache::split(const std::string &chunk, NamesCache &into)
+{
+	size_t start = 0;
+	while (start < chunk.size())
+	{
+		size_t end = chunk.find(' ', start);
+		if (end == std::string::npos)
+			end = chunk.size();
+		into.add(chunk.substr(start, end - start), into._budget);
+		start = end + 1;
+	}
+}
+
+void NamesCache::repack()
+{
+	std::vector<std::string> chunks;
+	chunks.swap(_chunks);
+	_bytes = 0;
+	for (size_t i = 0; i < chunks.size(); ++i)
+		split(chunks[i], *this);
+}
+
+void NamesCache::rechunk(size_t budget, std::vector<std::string> &out) const
+{
+	NamesCache smaller;
+	smaller._budget = budget;
+	for (size_t i = 0; i < _chunks.size(); ++i)
+		split(_chunks[i], smaller);
+	out.swap(smaller._chunks);
+}
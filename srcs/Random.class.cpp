@@ -0,0 +1,61 @@
+#include "Random.class.hpp"
+
+Random::Random(uint64_t seed)
+{
+	this->seed(seed);
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64 spreads any seed, 0 included, over the four words
+void Random::seed(uint64_t seed)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		_s[i] = z ^ (z >> 31);
+	}
+}
+
+uint64_t Random::next()
+{
+	uint64_t result = rotl(_s[1] * 5, 7) * 9;
+	uint64_t t = _s[1] << 17;
+
+	_s[2] ^= _s[0];
+	_s[3] ^= _s[1];
+	_s[1] ^= _s[2];
+	_s[0] ^= _s[3];
+	_s[2] ^= t;
+	_s[3] = rotl(_s[3], 45);
+	return result;
+}
+
+// the high 32 bits of x * n are in [0, n), the low ones tell when x
+// fell in the part of the range that would favour some values
+uint32_t Random::below(uint32_t n)
+{
+	uint64_t m = (next() >> 32) * n;
+	uint32_t low = (uint32_t)m;
+	if (low < n)
+	{
+		uint32_t threshold = -n % n; // 2^32 % n
+		while (low < threshold)
+		{
+			m = (next() >> 32) * n;
+			low = (uint32_t)m;
+		}
+	}
+	return (uint32_t)(m >> 32);
+}
+
+void Random::fill(uint32_t n, uint32_t *out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		out[i] = below(n);
+}
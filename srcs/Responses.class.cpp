@@ -0,0 +1,100 @@
+#include <stdexcept> // std::out_of_range
+
+#include "Responses.class.hpp"
+
+Responses::Responses()
+	: _size(0)
+{
+
+}
+
+void Responses::push_back(const Message &m)
+{
+	if (_size < _slots.size())
+		_slots[_size] = m;
+	else
+		_slots.push_back(m);
+	++_size;
+}
+
+void Responses::clear()
+{
+	_size = 0;
+}
+
+void Responses::reserve(size_t n)
+{
+	_slots.reserve(n);
+}
+
+size_t Responses::size() const
+{
+	return _size;
+}
+
+bool Responses::empty() const
+{
+	return _size == 0;
+}
+
+Message &Responses::operator[](size_t i)
+{
+	return _slots[i];
+}
+
+const Message &Responses::operator[](size_t i) const
+{
+	return _slots[i];
+}
+
+Message &Responses::at(size_t i)
+{
+	if (i >= _size)
+		throw std::out_of_range("Responses::at");
+	return _slots[i];
+}
+
+const Message &Responses::at(size_t i) const
+{
+	if (i >= _size)
+		throw std::out_of_range("Responses::at");
+	return _slots[i];
+}
+
+Message &Responses::back()
+{
+	return _slots[_size - 1];
+}
+
+const Message &Responses::back() const
+{
+	return _slots[_size - 1];
+}
+
+Responses::iterator Responses::begin()
+{
+	return _slots.begin();
+}
+
+Responses::iterator Responses::end()
+{
+	return _slots.begin() + _size;
+}
+
+Responses::const_iterator Responses::begin() const
+{
+	return _slots.begin();
+}
+
+Responses::const_iterator Responses::end() const
+{
+	return _slots.begin() + _size;
+}
+
+const Message* find_by_fd(const Responses &r, int fd)
+{
+	for (Responses::const_iterator it = r.begin(); it != r.end(); ++it)
+		if (it->fd == fd)
+			return &*it;
+	return 0;
+}
@@ -1,89 +1,94 @@
+#include <sstream>
+
 #include "Rolls.class.hpp"
 #include "colors.hpp"
 
-Rolls::Rolls()
-{
-	std::string	temp_keys[] = {"d2", "d4", "d6", "d8",
-								"d10", "d12", "d20", "d100"};
-
-	_n_keys = sizeof(temp_keys)/sizeof(temp_keys[0]);
-
-	_keys.insert(_keys.end(), temp_keys, temp_keys + _n_keys);
-
-	for (size_t i = 0; i < _n_keys; i++)
-		_counts[_keys[i]] = 0;
-}
-
-static void	clearOss(std::ostringstream& oss)
-{
-	// empty and clear oss
-	oss.str("");
-	oss.clear();
-}
+static const Die g_dice[ROLLS_N_DICE] = {
+	{"d2", 2}, {"d4", 4}, {"d6", 6}, {"d8", 8},
+	{"d10", 10}, {"d12", 12}, {"d20", 20}, {"d100", 100}
+};
 
-static void	addElementsOss(std::ostringstream& oss,
-		std::vector<std::string>& ret_vec,
-		const char* str_to_add)
+Rolls::Rolls()
 {
-	oss << str_to_add;
-	ret_vec.push_back(oss.str());
-	clearOss(oss);
+	for (size_t i = 0; i < ROLLS_N_DICE; i++)
+		_counts[i] = 0;
 }
 
-std::vector<std::string>	Rolls::info() const
+static std::vector<std::string>	renderInfo()
 {
 	std::vector<std::string>	ret_vec;
 	std::ostringstream			oss;
 
-	addElementsOss(oss, ret_vec, "-----");
+	ret_vec.push_back("-----");
 
-	addElementsOss(oss, ret_vec, UGREEN "Available dice:" RESET);
-	for (size_t i = 0; i < _n_keys; i++)
+	ret_vec.push_back(UGREEN "Available dice:" RESET);
+	for (size_t i = 0; i < ROLLS_N_DICE; i++)
 	{
-		oss << _keys.at(i);
-		if (i + 1 < _n_keys)
+		oss << g_dice[i].key;
+		if (i + 1 < ROLLS_N_DICE)
 			oss << ", ";
 	}
 	ret_vec.push_back(oss.str());
-	clearOss(oss);
-	addElementsOss(oss, ret_vec, "");
+	ret_vec.push_back("");
 
-	addElementsOss(oss, ret_vec, UYELLOW "Format:" RESET);
-	addElementsOss(oss, ret_vec, "[multiplier]d<dice_type>");
-	addElementsOss(oss, ret_vec, "The multiplier is optional.");
-	addElementsOss(oss, ret_vec, "");
+	ret_vec.push_back(UYELLOW "Format:" RESET);
+	ret_vec.push_back("[multiplier]d<dice_type>");
+	ret_vec.push_back("The multiplier is optional.");
+	ret_vec.push_back("");
 
-	addElementsOss(oss, ret_vec, UORANGE "Examples:" RESET);
-	addElementsOss(oss, ret_vec, "d6     = roll one 6-sided die");
-	addElementsOss(oss, ret_vec, "3d8    = roll three 8-sided dice");
-	addElementsOss(oss, ret_vec, "10d2   = roll ten 2-sided dice");
-	addElementsOss(oss, ret_vec, "");
-	addElementsOss(oss, ret_vec, "Multiple dice can be rolled at once.");
-	addElementsOss(oss, ret_vec, "Syntax: d2 d4d6 2d8 6d20");
-	addElementsOss(oss, ret_vec, "");
+	ret_vec.push_back(UORANGE "Examples:" RESET);
+	ret_vec.push_back("d6     = roll one 6-sided die");
+	ret_vec.push_back("3d8    = roll three 8-sided dice");
+	ret_vec.push_back("10d2   = roll ten 2-sided dice");
+	ret_vec.push_back("");
+	ret_vec.push_back("Multiple dice can be rolled at once.");
+	ret_vec.push_back("Syntax: d2 d4d6 2d8 6d20");
+	ret_vec.push_back("");
 
-	addElementsOss(oss, ret_vec, URED "Limits:" RESET);
-	addElementsOss(oss, ret_vec, "100 rolls per dice type.");
+	ret_vec.push_back(URED "Limits:" RESET);
+	ret_vec.push_back("100 rolls per dice type.");
 
-	addElementsOss(oss, ret_vec, "-----");
+	ret_vec.push_back("-----");
 
 	return (ret_vec);
 }
 
+const std::vector<std::string>	&Rolls::info()
+{
+	static const std::vector<std::string> lines = renderInfo();
+	return (lines);
+}
+
+size_t	Rolls::getKeysNum()
+{
+	return (ROLLS_N_DICE);
+}
+
+const Die	&Rolls::getDie(size_t index)
+{
+	return (g_dice[index]);
+}
+
+int	Rolls::find(const std::string &token, size_t begin, size_t end)
+{
+	for (size_t i = 0; i < ROLLS_N_DICE; i++)
+		if (token.compare(begin, end - begin, g_dice[i].key) == 0)
+			return (i);
+	return (-1);
+}
+
 std::string	Rolls::list() const
 {
 	std::ostringstream	oss;
 	bool				sep_needed = false;
 
-	for (size_t i = 0; i < _n_keys; i++)
+	for (size_t i = 0; i < ROLLS_N_DICE; i++)
 	{
-		const std::string& key = _keys[i];
-		size_t key_count = _counts.at(key);
-		if (key_count > 0)
+		if (_counts[i] > 0)
 		{
 			if (sep_needed)
 				oss << " / ";
-			oss << key << ": " << key_count;
+			oss << g_dice[i].key << ": " << _counts[i];
 			sep_needed = true;
 		}
 	}
@@ -91,38 +96,15 @@ std::string	Rolls::list() const
 	return (oss.str());
 }
 
-std::string	Rolls::getKey(size_t index) const
+void	Rolls::addToCount(size_t die, int value)
 {
-	if (index < _keys.size())
-		return (_keys[index]);
+	if (_counts[die] + value <= ROLLS_MAX_COUNT)
+		_counts[die] += value;
 	else
-		return ("");
-}
-
-size_t	Rolls::getKeysNum() const
-{
-	return (_n_keys);
+		_counts[die] = ROLLS_MAX_COUNT;
 }
 
-void	Rolls::addToCount(const std::string& key)
+size_t	Rolls::getCount(size_t die) const
 {
-	if (_counts[key] + 1 <= 100)
-		_counts[key]++;
-}
-
-void	Rolls::addToCount(const std::string& key, int value)
-{
-	if (_counts[key] + value <= 100)
-		_counts[key] += value;
-	else
-		_counts[key] = 100;
-}
-
-size_t	Rolls::getCount(const std::string& key) const
-{
-	std::map<std::string, size_t>::const_iterator it = _counts.find(key);
-	if (it != _counts.end())
-		return (it->second);
-	else
-		return (0);
+	return (_counts[die]);
 }
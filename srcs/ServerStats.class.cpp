@@ -0,0 +1,274 @@
+#include <algorithm> // std::min()
+#include <cstring>   // memcmp(), strlen()
+
+#include "ServerStats.class.hpp"
+
+#define VERB_NAME(verb, handler) verb,
+
+// the verbs of messageRouter, the last slot takes any other one
+static const char *g_verbs[STATS_N_VERBS] = { ROUTED_VERBS(VERB_NAME) "*" };
+
+// single writer: a load and a store, never a locked instruction
+template <typename T>
+static void bump(T &counter, T n)
+{
+	__atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + n,
+		__ATOMIC_RELAXED);
+}
+
+template <typename T>
+static T load(const T &counter)
+{
+	return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+}
+
+// 0 to 3 exactly, then 4 buckets per power of two
+static size_t bucketOf(uint64_t nsec)
+{
+	if (nsec > 0xffffffffu)
+		nsec = 0xffffffffu;
+	if (nsec < 4)
+		return nsec;
+	int log = 63 - __builtin_clzll(nsec);
+	return (log - 1) * 4 + ((nsec >> (log - 2)) & 3);
+}
+
+static uint64_t upperBound(size_t bucket)
+{
+	if (bucket < 4)
+		return bucket;
+	int log = bucket / 4 + 1;
+	uint64_t lower = (uint64_t)(4 + bucket % 4) << (log - 2);
+	return lower + ((uint64_t)1 << (log - 2)) - 1;
+}
+
+LatencyHistogram::LatencyHistogram()
+	: _count(0), _max(0), _sum(0)
+{
+	for (size_t i = 0; i < STATS_BUCKETS; ++i)
+		_buckets[i] = 0;
+}
+
+void LatencyHistogram::add(uint64_t nsec)
+{
+	bump(_buckets[bucketOf(nsec)], (size_t)1);
+	bump(_count, (size_t)1);
+	bump(_sum, nsec);
+	if (nsec > load(_max))
+		__atomic_store_n(&_max, nsec, __ATOMIC_RELAXED);
+}
+
+size_t LatencyHistogram::count() const
+{
+	return load(_count);
+}
+
+// the first bucket reaching p of the count
+uint64_t LatencyHistogram::percentile(double p) const
+{
+	size_t count = load(_count);
+	if (!count)
+		return 0;
+	size_t rank = (size_t)(p * count);
+	size_t seen = 0;
+	for (size_t i = 0; i < STATS_BUCKETS; ++i)
+	{
+		seen += load(_buckets[i]);
+		if (seen > rank)
+			return std::min(upperBound(i), load(_max));
+	}
+	return load(_max);
+}
+
+uint64_t LatencyHistogram::max() const
+{
+	return load(_max);
+}
+
+uint64_t LatencyHistogram::sum() const
+{
+	return load(_sum);
+}
+
+SizeHistogram::SizeHistogram()
+	: _count(0), _sum(0)
+{
+	for (size_t i = 0; i <= STATS_SIZE_BUCKETS; ++i)
+		_buckets[i] = 0;
+}
+
+// the smallest i with size <= 2^i
+void SizeHistogram::add(size_t size)
+{
+	size_t i = size <= 1 ? 0 : 64 - __builtin_clzll((uint64_t)size - 1);
+	bump(_buckets[i < STATS_SIZE_BUCKETS ? i : STATS_SIZE_BUCKETS], (size_t)1);
+	bump(_count, (size_t)1);
+	bump(_sum, (uint64_t)size);
+}
+
+size_t SizeHistogram::bucket(size_t i) const
+{
+	return load(_buckets[i]);
+}
+
+size_t SizeHistogram::count() const
+{
+	return load(_count);
+}
+
+uint64_t SizeHistogram::sum() const
+{
+	return load(_sum);
+}
+
+ServerStats::ServerStats()
+	: _iterations(0), _busy_wakeups(0), _ready(0), _max_ready(0),
+	  _accepted(0), _connections(0), _send_queued(0), _bytes_in(0),
+	  _bytes_out(0)
+{
+	for (size_t i = 0; i < STATS_N_VERBS; ++i)
+	{
+		_verbs[i].verb = g_verbs[i];
+		_verbs[i].bytes = 0;
+	}
+}
+
+// the lengths differ for most verbs, memcmp runs once or twice
+static size_t verbIndex(const std::string &verb)
+{
+	static size_t lengths[STATS_N_VERBS];
+	if (!lengths[0])
+		for (size_t i = 0; i < STATS_N_VERBS; ++i)
+			lengths[i] = strlen(g_verbs[i]);
+	for (size_t i = 0; i + 1 < STATS_N_VERBS; ++i)
+		if (verb.size() == lengths[i]
+			&& memcmp(verb.data(), g_verbs[i], lengths[i]) == 0)
+			return i;
+	return STATS_N_VERBS - 1;
+}
+
+void ServerStats::message(const std::string &verb, size_t bytes, uint64_t nsec)
+{
+	VerbStats &stats = _verbs[verbIndex(verb)];
+	bump(stats.bytes, bytes);
+	stats.latency.add(nsec);
+}
+
+void ServerStats::wakeup(int ready)
+{
+	bump(_iterations, (size_t)1);
+	if (ready <= 0)
+		return;
+	bump(_busy_wakeups, (size_t)1);
+	bump(_ready, (size_t)ready);
+	if ((size_t)ready > load(_max_ready))
+		__atomic_store_n(&_max_ready, (size_t)ready, __ATOMIC_RELAXED);
+}
+
+void ServerStats::lag(uint64_t nsec)
+{
+	_lag.add(nsec);
+}
+
+void ServerStats::opened()
+{
+	bump(_accepted, (size_t)1);
+	bump(_connections, (size_t)1);
+}
+
+void ServerStats::closed()
+{
+	bump(_connections, (size_t)-1);
+}
+
+void ServerStats::received(size_t bytes)
+{
+	bump(_bytes_in, (uint64_t)bytes);
+}
+
+void ServerStats::queued(size_t bytes)
+{
+	bump(_send_queued, bytes);
+}
+
+void ServerStats::sent(size_t bytes, size_t depth)
+{
+	_send_depth.add(depth);
+	bump(_bytes_out, (uint64_t)bytes);
+	bump(_send_queued, -bytes);
+}
+
+void ServerStats::dropped(size_t bytes)
+{
+	bump(_send_queued, -bytes);
+}
+
+void ServerStats::fanout(size_t messages)
+{
+	_fanout.add(messages);
+}
+
+const VerbStats &ServerStats::verb(size_t i) const
+{
+	return _verbs[i];
+}
+
+size_t ServerStats::iterations() const
+{
+	return load(_iterations);
+}
+
+size_t ServerStats::busyWakeups() const
+{
+	return load(_busy_wakeups);
+}
+
+size_t ServerStats::readyFds() const
+{
+	return load(_ready);
+}
+
+size_t ServerStats::maxReady() const
+{
+	return load(_max_ready);
+}
+
+const LatencyHistogram &ServerStats::loopLag() const
+{
+	return _lag;
+}
+
+size_t ServerStats::accepted() const
+{
+	return load(_accepted);
+}
+
+size_t ServerStats::connections() const
+{
+	return load(_connections);
+}
+
+uint64_t ServerStats::bytesIn() const
+{
+	return load(_bytes_in);
+}
+
+uint64_t ServerStats::bytesOut() const
+{
+	return load(_bytes_out);
+}
+
+size_t ServerStats::sendQueued() const
+{
+	return load(_send_queued);
+}
+
+const SizeHistogram &ServerStats::sendQueueDepth() const
+{
+	return _send_depth;
+}
+
+const SizeHistogram &ServerStats::fanouts() const
+{
+	return _fanout;
+}
@@ -1,80 +1,188 @@
 #include "State.struct.hpp"
+#include "dictionary.hpp"
+#include <cassert>
 #include <vector>
 #include <set>
 #include <algorithm>
 
-void State::removeClient(int fd)
+State::State()
+	: start_time(0), n_registered(0), n_opers(0), max_registered(0)
+{
+
+}
+
+void State::addClient(int fd, const Client &client)
 {
-	std::vector<std::string> emptyChannels;
-	std::map<std::string, Channel>::iterator channel;
-	for (channel = channels.begin(); channel != channels.end(); ++channel)
+	removeClient(fd);
+	clients[fd] = client;
+	if (client.status == WELCOMED)
 	{
-		channel->second.client_ids.erase(fd);
-		channel->second.op_ids.erase(fd);
-		channel->second.invited_ids.erase(fd);
-		if (channel->second.client_ids.empty())
-			emptyChannels.push_back(channel->first);
+		clients[fd].status = AUTHENTICATED;
+		welcome(fd);
 	}
-	clients.erase(fd);
-	std::vector<std::string>::iterator name;
-	for (name = emptyChannels.begin(); name != emptyChannels.end(); ++name)
+	if (client.isOp())
+		++n_opers;
+}
+
+void State::welcome(int fd)
+{
+	Client &client = clients[fd];
+	if (client.status == WELCOMED)
+		return;
+	client.status = WELCOMED;
+	if (++n_registered > max_registered)
+		max_registered = n_registered;
+}
+
+void State::setOper(int fd, bool on)
+{
+	Client &client = clients[fd];
+	if (client.isOp() == on)
+		return;
+	if (on)
 	{
-		channels.erase(*name);
+		client.modes.insert('o');
+		++n_opers;
+	}
+	else
+	{
+		assert(n_opers > 0);
+		client.modes.erase('o');
+		--n_opers;
 	}
 }
 
-std::vector<int> State::clientsInChannelsWith(int fd) const
+size_t State::unregistered() const
 {
-	std::set<int> clients;
-	std::map<std::string, Channel>::const_iterator it;
-	for (it = channels.begin(); it != channels.end(); ++it)
+	assert(clients.size() >= n_registered);
+	return clients.size() - n_registered;
+}
+
+// only visits the channels of the client
+void State::removeClient(int fd)
+{
+	Client *client = clients.find(fd);
+	if (!client)
+		return;
+	// removeMember erases from the set being iterated, work on a copy
+	std::set<int> ids;
+	ids.swap(client->channels);
+	std::set<int>::iterator id;
+	for (id = ids.begin(); id != ids.end(); ++id)
+		if (Channel *channel = channels.find(*id))
+			removeMember(fd, *channel);
+	ids.clear();
+	ids.swap(client->invites);
+	for (id = ids.begin(); id != ids.end(); ++id)
+		if (Channel *channel = channels.find(*id))
+			uninvite(fd, *channel);
+	if (nicks.find(client->nick) == fd)
+		nicks.erase(client->nick);
+	// counted by welcome and setOper, the only ways in
+	if (client->status == WELCOMED)
+	{
+		assert(n_registered > 0);
+		--n_registered;
+	}
+	if (client->isOp())
 	{
-		if (it->second.client_ids.count(fd) != 0)
-		{
-			clients.insert(it->second.client_ids.begin(), it->second.client_ids.end());
-		}
+		assert(n_opers > 0);
+		--n_opers;
 	}
 	clients.erase(fd);
-	return std::vector<int>(clients.begin(), clients.end());
 }
 
-int State::findClientByNick(const std::string &nick) const
+void State::addMember(int fd, Channel &channel, unsigned int flags)
 {
-	for (std::map<int, Client>::const_iterator it = clients.begin();
-		 it != clients.end(); ++it)
-	{
-		if (it->second.nick == nick)
-			return it->first;
-	}
-	return (-1);
+	Client &client = clients[fd];
+	channel.addMember(fd, flags, client.nick);
+	client.channels.insert(channel.id);
 }
 
-// for NAME command, it gives a single string with nicks
-// channel op are marked with @, for example "tom,@john,ric,clank"
-std::string State::getNamesInChannel(const std::string &channel_name)
+void State::addMember(int fd, const std::string &channel_name, unsigned int flags)
 {
-	std::string names;
+	addMember(fd, channels[channel_name], flags);
+}
 
-	if (!channels.count(channel_name))
-		return names;
-	Channel &channel = channels[channel_name];
-	std::set<int>::const_iterator it;
+// the last member out deletes the channel and its pending invites
+void State::removeMember(int fd, Channel &channel)
+{
+	Client *client = clients.find(fd);
+	if (client)
+		client->channels.erase(channel.id);
+	channel.removeMember(fd);
+	if (!channel.empty())
+		return;
+	std::map<int, time_t>::const_iterator it;
+	for (it = channel.invites.begin(); it != channel.invites.end(); ++it)
+		if (Client *invited = clients.find(it->first))
+			invited->invites.erase(channel.id);
+	channels.erase(channel.id);
+}
 
-	// operators first
-	for (it = channel.client_ids.begin(); it != channel.client_ids.end(); ++it)
+// expired invites are dropped when a new one is added
+void State::invite(int fd, Channel &channel)
+{
+	time_t now = time(0);
+	std::map<int, time_t>::iterator it = channel.invites.begin();
+	while (it != channel.invites.end())
 	{
-		if (channel.op_ids.count(*it))
-		{
-			names += "@" + clients[*it].nick + " ";
-		}
+		int invited = it->first;
+		if ((it++)->second <= now)
+			uninvite(invited, channel);
 	}
+	channel.invite(fd, now + INVITE_TTL);
+	clients[fd].invites.insert(channel.id);
+}
+
+void State::uninvite(int fd, Channel &channel)
+{
+	Client *client = clients.find(fd);
+	if (client)
+		client->invites.erase(channel.id);
+	channel.uninvite(fd);
+}
 
-	// then regular users
-	for (it = channel.client_ids.begin(); it != channel.client_ids.end(); ++it)
+// the other members of the client's own channels, each one once
+std::vector<int> State::clientsInChannelsWith(int fd) const
+{
+	std::vector<int> members;
+	const Client *client = clients.find(fd);
+	if (!client)
+		return members;
+	std::set<int>::const_iterator id;
+	for (id = client->channels.begin(); id != client->channels.end(); ++id)
 	{
-		if (!channel.op_ids.count(*it))
-			names += clients[*it].nick + " ";
+		const Channel *channel = channels.find(*id);
+		if (!channel)
+			continue;
+		const Members &in_channel = channel->members;
+		for (Members::const_iterator m = in_channel.begin(); m != in_channel.end(); ++m)
+			if (m->fd != fd)
+				members.push_back(m->fd);
 	}
+	std::sort(members.begin(), members.end());
+	members.erase(std::unique(members.begin(), members.end()), members.end());
+	return members;
+}
 
-	return names;
+void State::setNick(int fd, const std::string &nick)
+{
+	Client &client = clients[fd];
+	if (!client.nick.empty() && nicks.find(client.nick) == fd)
+		nicks.erase(client.nick);
+	if (!nick.empty())
+		nicks.insert(nick, fd);
+	client.setNick(nick);
+	std::set<int>::const_iterator id;
+	for (id = client.channels.begin(); id != client.channels.end(); ++id)
+		if (Channel *channel = channels.find(*id))
+			channel->renameMember(fd, nick);
+}
+
+int State::findClientByNick(const std::string &nick) const
+{
+	if (nick.empty())
+		return (-1);
+	return nicks.find(nick);
 }
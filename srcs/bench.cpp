@@ -0,0 +1,89 @@
+#include <cstdlib>  // malloc(), free()
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include <sys/time.h> // gettimeofday()
+
+#include "bench.hpp"
+#include "replies.hpp"
+
+void bench_bot();
+void bench_channels();
+void bench_logs();
+void bench_membership();
+void bench_privmsg();
+
+struct Bench
+{
+	const char	*name;
+	void		(*run)();
+};
+
+static const Bench g_benches[] = {
+	{"bot", bench_bot},
+	{"channels", bench_channels},
+	{"logs", bench_logs},
+	{"membership", bench_membership},
+	{"privmsg", bench_privmsg},
+};
+
+static size_t g_allocations = 0;
+
+// every new in the program goes through here, delete[] and new[] included
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+	++g_allocations;
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+size_t	benchAllocations()
+{
+	return g_allocations;
+}
+
+double	benchNow()
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec / 1e6;
+}
+
+void	benchReport(const std::string &name, size_t ops, double seconds)
+{
+	std::cout << "  " << name << ": " << ops << " ops, "
+		<< std::fixed << std::setprecision(3)
+		<< seconds * 1e6 / (ops ? ops : 1) << " us/op" << std::endl;
+}
+
+void	benchReport(const std::string &name, size_t ops, double seconds,
+	size_t allocations)
+{
+	std::cout << "  " << name << ": " << ops << " ops, "
+		<< std::fixed << std::setprecision(3)
+		<< seconds * 1e6 / (ops ? ops : 1) << " us/op, "
+		<< std::setprecision(2)
+		<< (double)allocations / (ops ? ops : 1) << " allocs/op" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	initReplies();
+	size_t n_benches = sizeof(g_benches) / sizeof(g_benches[0]);
+	for (size_t i = 0; i < n_benches; ++i)
+	{
+		if (argc > 1 && std::string(argv[1]) != g_benches[i].name)
+			continue;
+		std::cout << g_benches[i].name << std::endl;
+		g_benches[i].run();
+	}
+	return 0;
+}
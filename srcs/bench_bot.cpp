@@ -0,0 +1,62 @@
+#include <cstdlib> // rand()
+#include <iostream>
+
+#include "bench.hpp"
+#include "handlers.hpp"
+#include "Random.class.hpp"
+
+#define BENCH_ROUNDS 2000
+#define BENCH_DRAWS 1000000
+
+// every die at the maximum count, the largest answer the bot can give
+static const char g_request[] =
+	"clank 100d2 100d4 100d6 100d8 100d10 100d12 100d20 100d100";
+
+// one request as the worker thread answers it, the reply reused
+static void benchAnswer()
+{
+	BotRequest request = {{42, 0}, {3, 0}, g_request};
+	BotReply reply;
+	botAnswer(request, reply);
+
+	size_t allocations = benchAllocations();
+	double start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+	{
+		reply.lines.clear();
+		botAnswer(request, reply);
+	}
+	double seconds = benchNow() - start;
+	allocations = benchAllocations() - allocations;
+	benchReport("dice request x800 rolls", BENCH_ROUNDS, seconds, allocations);
+}
+
+// the generator alone, against the rand() % n it replaces
+static void benchDraws()
+{
+	static uint32_t out[BENCH_DRAWS];
+	Random rng(42);
+	unsigned sum = 0;
+
+	double start = benchNow();
+	rng.fill(100, out, BENCH_DRAWS);
+	double seconds = benchNow() - start;
+	benchReport("Random::fill d100", BENCH_DRAWS, seconds);
+
+	start = benchNow();
+	for (size_t i = 0; i < BENCH_DRAWS; ++i)
+		out[i] = rand() % 100;
+	seconds = benchNow() - start;
+	benchReport("rand() % 100", BENCH_DRAWS, seconds);
+
+	for (size_t i = 0; i < BENCH_DRAWS; i += 4096)
+		sum += out[i];
+	if (sum == 1) // keeps the loops from being optimized out
+		std::cout << sum << std::endl;
+}
+
+void bench_bot()
+{
+	benchAnswer();
+	benchDraws();
+}
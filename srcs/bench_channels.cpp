@@ -0,0 +1,64 @@
+#include <sstream>
+
+#include "bench.hpp"
+#include "handlers.hpp"
+
+#define BENCH_CHURN_CHANNELS 50 // cycled through by the churning client
+#define BENCH_ROUNDS 20000
+
+static std::string channelName(size_t i)
+{
+	std::ostringstream oss;
+	oss << "#churn" << i;
+	return oss.str();
+}
+
+// a bot cycling through channels it is alone in: each JOIN creates
+// the channel and each PART deletes it
+static void benchChurn()
+{
+	State s;
+	s.welcome(1);
+	s.setNick(1, "cycler");
+	std::vector<std::string> names;
+	for (size_t i = 0; i < BENCH_CHURN_CHANNELS; ++i)
+		names.push_back(channelName(i));
+
+	// first round outside the measure, it fills the pool
+	for (size_t i = 0; i < names.size(); ++i)
+		s.removeMember(1, s.channels[names[i]]);
+
+	size_t allocations = benchAllocations();
+	double start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+	{
+		const std::string &name = names[i % names.size()];
+		s.addMember(1, name, MEMBER_OP);
+		s.removeMember(1, s.channels[name]);
+	}
+	benchReport("state join+part", BENCH_ROUNDS, benchNow() - start,
+		benchAllocations() - allocations);
+
+	std::vector<Message> joins, parts;
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		joins.push_back(Message(1, "JOIN", names[i]));
+		parts.push_back(Message(1, "PART", names[i]));
+	}
+	Responses r;
+	allocations = benchAllocations();
+	start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+	{
+		r.clear();
+		joinHandler(joins[i % joins.size()], s, r);
+		partHandler(parts[i % parts.size()], s, r);
+	}
+	benchReport("JOIN+PART handlers", BENCH_ROUNDS, benchNow() - start,
+		benchAllocations() - allocations);
+}
+
+void bench_channels()
+{
+	benchChurn();
+}
@@ -0,0 +1,44 @@
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>  // open()
+#include <unistd.h> // close()
+
+#include "bench.hpp"
+#include "Logs.class.hpp"
+
+#define BENCH_ROUNDS 200000
+
+// what the reactor pays for the log of one read, the writer aside
+static void benchLogs(bool async, const std::string &name)
+{
+	Logs logs(time(0));
+	std::string buffer = "PRIVMSG #bench :the quick brown fox jumps over the lazy dog\r\n";
+	std::filebuf null;
+	null.open("/dev/null", std::ios::out);
+	std::streambuf *saved = std::cout.rdbuf(&null);
+	int fd = open("/dev/null", O_WRONLY);
+	if (async)
+		startLogWriter(fd);
+
+	double start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+		logs.logsBuffer(1 + i % 50, buffer, i % 2);
+	double seconds = benchNow() - start;
+
+	stopLogWriter();
+	close(fd);
+	std::cout.rdbuf(saved);
+	benchReport(name, BENCH_ROUNDS, seconds);
+}
+
+void bench_logs()
+{
+	benchLogs(false, "logsBuffer, rendered in place");
+	benchLogs(true, "logsBuffer, through the ring");
+
+	LogConfig off = {LOG_LEVEL_OFF, 1, 0}, full = {LOG_LEVEL_FULL, 1, 0};
+	setLogConfig(LOG_CAT_BUFFER, off);
+	benchLogs(true, "logsBuffer, buffers off");
+	setLogConfig(LOG_CAT_BUFFER, full);
+}
@@ -0,0 +1,75 @@
+#include <sstream>
+
+#include "bench.hpp"
+#include "handlers.hpp"
+
+#define BENCH_OTHERS 1000 // clients filling the other channels
+#define BENCH_OWN_CHANNELS 10
+#define BENCH_ROUNDS 2000
+
+static std::string channelName(size_t i)
+{
+	std::ostringstream oss;
+	oss << "#chan" << i;
+	return oss.str();
+}
+
+// n_channels channels of 2 members, alice (fd 1) in the first ones
+static void fillState(State &s, size_t n_channels)
+{
+	for (int fd = 2; fd < 2 + BENCH_OTHERS; ++fd)
+	{
+		std::ostringstream nick;
+		nick << "user" << fd;
+		s.welcome(fd);
+		s.setNick(fd, nick.str());
+	}
+	for (size_t i = 0; i < n_channels; ++i)
+	{
+		s.addMember(2 + i % BENCH_OTHERS, channelName(i));
+		s.addMember(2 + (i + 1) % BENCH_OTHERS, channelName(i));
+	}
+}
+
+static void joinOwnChannels(State &s)
+{
+	s.welcome(1);
+	s.setNick(1, "alice");
+	for (size_t i = 0; i < BENCH_OWN_CHANNELS; ++i)
+		s.addMember(1, channelName(i));
+}
+
+// QUIT and NICK only depend on the client's own channels,
+// the time per operation should not change with the total
+static void benchFanOut(size_t n_channels)
+{
+	State s;
+	fillState(s, n_channels);
+	std::ostringstream suffix;
+	suffix << " x" << BENCH_OWN_CHANNELS << " channels ("
+		<< n_channels << " total)";
+
+	joinOwnChannels(s);
+	double start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+	{
+		Responses r;
+		nickHandler(Message(1, i % 2 ? "NICK alice" : "NICK bob"), s, r);
+	}
+	benchReport("nick" + suffix.str(), BENCH_ROUNDS, benchNow() - start);
+
+	start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+	{
+		Responses r;
+		joinOwnChannels(s);
+		quitHandler(Message(1, "QUIT :bye"), s, r);
+	}
+	benchReport("join+quit" + suffix.str(), BENCH_ROUNDS, benchNow() - start);
+}
+
+void bench_membership()
+{
+	benchFanOut(5000);
+	benchFanOut(50000);
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <sstream>
+
+#include "bench.hpp"
+#include "Connection.class.hpp"
+#include "handlers.hpp"
+
+#define BENCH_MEMBERS 50 // in #bench, fds 1 to BENCH_MEMBERS
+#define BENCH_WARMUP 100
+#define BENCH_ROUNDS 20000
+
+// one read of a client: a channel message and a private one
+static const char g_lines[] =
+	"PRIVMSG #bench :the quick brown fox jumps over the lazy dog\r\n"
+	"PRIVMSG user2 :and a private answer, long enough for the heap\r\n";
+
+static void fillState(State &s)
+{
+	for (int fd = 1; fd <= BENCH_MEMBERS; ++fd)
+	{
+		std::ostringstream nick;
+		nick << "user" << fd;
+		s.welcome(fd);
+		s.setNick(fd, nick.str());
+		s.addMember(fd, "#bench");
+	}
+}
+
+// what sendData does once the socket took everything
+static void sendAll(Connection &connection)
+{
+	for (int fd = 1; fd <= BENCH_MEMBERS; ++fd)
+		connection.pendingOutput(fd).clear();
+}
+
+// lines fed to the reactor, the same path as a recv() of a client:
+// once the buffers are warm, nothing should be allocated, with the bot
+// subscribed or not since it is in none of these channels
+static void benchReactor(bool bot)
+{
+	State s;
+	fillState(s);
+	if (bot)
+	{
+		s.addClient(BOT_ID, createBotClient());
+		s.setNick(BOT_ID, BOT_NICK);
+		botSubscribe(s);
+	}
+	Connection connection(s, messageRouter);
+	std::streambuf *logs = std::cout.rdbuf(NULL);
+
+	for (size_t i = 0; i < BENCH_WARMUP; ++i)
+	{
+		connection.feed(1 + i % BENCH_MEMBERS, g_lines, sizeof(g_lines) - 1);
+		sendAll(connection);
+	}
+	size_t allocations = benchAllocations();
+	double start = benchNow();
+	for (size_t i = 0; i < BENCH_ROUNDS; ++i)
+	{
+		connection.feed(1 + i % BENCH_MEMBERS, g_lines, sizeof(g_lines) - 1);
+		sendAll(connection);
+	}
+	double seconds = benchNow() - start;
+	allocations = benchAllocations() - allocations;
+
+	std::cout.rdbuf(logs);
+	std::ostringstream name;
+	name << "PRIVMSG feed x" << BENCH_MEMBERS << " members"
+		<< (bot ? ", bot subscribed" : "");
+	benchReport(name.str(), BENCH_ROUNDS * 2, seconds, allocations);
+}
+
+void bench_privmsg()
+{
+	benchReactor(false);
+	benchReactor(true);
+}
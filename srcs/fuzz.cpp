@@ -0,0 +1,287 @@
+#include <algorithm> // std::min()
+#include <cstdlib>  // abort()
+#include <ctime>    // clock()
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdint.h> // uint8_t
+
+#include "Connection.class.hpp"
+#include "dictionary.hpp"
+#include "handlers.hpp"
+#include "replies.hpp"
+
+// Fuzzing harness for the parser, the framing and the MODE loop.
+// The first byte of an input picks the target, the rest is the payload.
+//
+//   make fuzz                        standalone/AFL driver (-fsanitize)
+//   ./ircfuzz < input                one input from stdin (AFL)
+//   ./ircfuzz input...               replay inputs (crashes, corpus)
+//   ./ircfuzz --scale input          growth of time/output with size
+//   make fuzz FUZZ_CC=afl-c++        AFL instrumentation
+//   make fuzz FUZZ_CC=clang++ FUZZ_FLAGS="-fsanitize=fuzzer,address -DLIBFUZZER"
+//
+// An invariant that does not hold aborts, so every engine records it.
+
+enum e_target
+{
+	TARGET_MESSAGE,
+	TARGET_FRAMING,
+	TARGET_MODE,
+	TARGET_COUNT
+};
+
+static const char *g_target_names[TARGET_COUNT] = {
+	"message", "framing", "mode"
+};
+
+// linear budgets: anything above grows faster than its input
+#define FUZZ_BASE_USEC 20000
+#define FUZZ_USEC_PER_BYTE 20
+#define FUZZ_SCALE_STEPS 6
+#define FUZZ_SCALE_MAX_RATIO 3.0 // per doubling of the input
+
+struct FuzzCost
+{
+	size_t	output;
+	clock_t	time;
+};
+
+static void fail(e_target target, const std::string &what)
+{
+	std::cerr << "fuzz(" << g_target_names[target] << "): " << what << std::endl;
+	abort();
+}
+
+static bool hasControl(const std::string &str)
+{
+	return str.find_first_of(std::string("\r\n\0", 3)) != std::string::npos;
+}
+
+static bool isClean(const Message &m)
+{
+	if (hasControl(m.tags) || hasControl(m.source) || hasControl(m.verb))
+		return false;
+	for (size_t i = 0; i < m.params.size(); ++i)
+		if (hasControl(m.params[i]))
+			return false;
+	return true;
+}
+
+// parse, bounded sizes, and assemble(parse(raw)) parses back the same
+static size_t fuzzMessage(const std::string &payload)
+{
+	Message m(42, payload);
+	if (m.tags.size() > MAX_TAGS_LEN - 2)
+		fail(TARGET_MESSAGE, "tags over MAX_TAGS_LEN");
+
+	std::string body;
+	m.assembleBody(body);
+	// a last middle param gains a ':' when assembled
+	if (body.size() > MAX_MSG_LEN + 1)
+		fail(TARGET_MESSAGE, "assembled body over MAX_MSG_LEN");
+
+	std::string value;
+	m.getTag("+a", value);
+	if (m.clientTags().size() > m.tags.size())
+		fail(TARGET_MESSAGE, "client tags longer than tags");
+
+	if (m.isValid() && isClean(m) && body.size() <= MAX_MSG_LEN)
+	{
+		std::string raw = m.assemble();
+		if (!(Message(42, raw) == m))
+			fail(TARGET_MESSAGE, "round trip mismatch: " + raw);
+	}
+	return body.size();
+}
+
+static size_t g_frames;
+
+static void countFrames(const Message &m, State &s, Responses &r)
+{
+	(void)m, (void)s, (void)r;
+	++g_frames;
+}
+
+// the payload is fed in chunks, every "\r\n" is exactly one message
+static size_t fuzzFraming(const std::string &payload)
+{
+	State state;
+	Connection connection(state, countFrames);
+	size_t chunk = payload.empty() ? 1 : (unsigned char)payload[0] % 64 + 1;
+	size_t expected = 0;
+
+	g_frames = 0;
+	for (size_t i = 0; i < payload.size(); i += chunk)
+	{
+		size_t len = std::min(chunk, payload.size() - i);
+		// a line split between two chunks is counted once both are fed
+		for (size_t j = (i ? i - 1 : 0); j + 1 < i + len; ++j)
+			if (payload[j] == '\r' && payload[j + 1] == '\n')
+				++expected;
+		if (connection.feed(42, payload.data() + i, len) == NOK)
+			break;
+	}
+	if (g_frames != expected)
+		fail(TARGET_FRAMING, "frames lost or duplicated");
+	return g_frames;
+}
+
+// one op and two members, the payload is the end of "MODE #fuzz "
+static size_t fuzzMode(const std::string &payload)
+{
+	State s;
+	const char *nicks[] = {"alice", "bob", "carol"};
+	for (int fd = 42; fd < 45; ++fd)
+	{
+		s.welcome(fd);
+		s.setNick(fd, nicks[fd - 42]);
+		s.addMember(fd, "#fuzz");
+	}
+	s.channels["#fuzz"].setFlag(42, MEMBER_OP, true);
+
+	Responses r;
+	modeHandler(Message(42, "MODE #fuzz " + payload), s, r);
+
+	// each flag is one error at most, the changes one broadcast line,
+	// the flags past MAX_MODES one error
+	size_t members = s.channels["#fuzz"].size();
+	if (r.size() > MAX_MODES * members + 2)
+		fail(TARGET_MODE, "too many responses for one MODE");
+
+	size_t output = 0;
+	for (size_t i = 0; i < r.size(); ++i)
+		output += r[i].assemble().size();
+	return output;
+}
+
+static FuzzCost runTarget(e_target target, const std::string &payload)
+{
+	FuzzCost cost;
+	clock_t start = clock();
+	if (target == TARGET_MESSAGE)
+		cost.output = fuzzMessage(payload);
+	else if (target == TARGET_FRAMING)
+		cost.output = fuzzFraming(payload);
+	else
+		cost.output = fuzzMode(payload);
+	cost.time = clock() - start;
+	return cost;
+}
+
+static void runInput(const uint8_t *data, size_t size)
+{
+	if (size == 0)
+		return;
+	e_target target = static_cast<e_target>(data[0] % TARGET_COUNT);
+	std::string payload(reinterpret_cast<const char *>(data) + 1, size - 1);
+
+	FuzzCost cost = runTarget(target, payload);
+	double usec = cost.time * 1e6 / CLOCKS_PER_SEC;
+	if (usec > FUZZ_BASE_USEC + FUZZ_USEC_PER_BYTE * (double)size)
+		fail(target, "processing time over the linear budget");
+}
+
+// repeats the payload 1, 2, 4... times and compares each step to the previous
+static int scaleInput(const std::string &input, std::ostream &report)
+{
+	if (input.empty())
+		return (error("empty input"), NOK);
+	e_target target = static_cast<e_target>((unsigned char)input[0] % TARGET_COUNT);
+	std::string payload = input.substr(1);
+	FuzzCost previous = {0, 0};
+	int status = OK;
+
+	for (int step = 0; step < FUZZ_SCALE_STEPS; ++step)
+	{
+		// repeat a few times so the clock resolution does not matter
+		FuzzCost cost = {0, 0};
+		for (int i = 0; i < 16; ++i)
+		{
+			FuzzCost run = runTarget(target, payload);
+			cost.output = run.output;
+			cost.time += run.time;
+		}
+		report << g_target_names[target] << " x" << (1 << step)
+			<< ": " << payload.size() << " bytes in, " << cost.output
+			<< " out, " << cost.time * 1e6 / CLOCKS_PER_SEC / 16 << " us";
+		if (step && previous.output
+			&& cost.output > FUZZ_SCALE_MAX_RATIO * previous.output)
+		{
+			report << " <- output grows superlinearly";
+			status = NOK;
+		}
+		if (step && previous.time > CLOCKS_PER_SEC / 1000
+			&& cost.time > FUZZ_SCALE_MAX_RATIO * previous.time)
+		{
+			report << " <- time grows superlinearly";
+			status = NOK;
+		}
+		report << std::endl;
+		previous = cost;
+		payload += payload;
+	}
+	return status;
+}
+
+static void silenceLogs()
+{
+	static bool silenced = false;
+	if (silenced)
+		return;
+	std::cout.rdbuf(NULL);
+	initReplies();
+	silenced = true;
+}
+
+#ifdef LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	silenceLogs();
+	runInput(data, size);
+	return 0;
+}
+
+#else
+
+static std::string readAll(std::istream &in)
+{
+	return std::string(std::istreambuf_iterator<char>(in),
+		std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && std::string("--scale") == argv[1])
+	{
+		std::ifstream file(argv[2], std::ios::binary);
+		if (!file)
+			return (error("cannot open input"), NOK);
+		std::string input = readAll(file);
+		// keep the report, the connection logs go nowhere
+		std::ostream report(std::cout.rdbuf());
+		silenceLogs();
+		return scaleInput(input, report);
+	}
+
+	silenceLogs();
+	if (argc == 1)
+	{
+		std::string input = readAll(std::cin);
+		runInput(reinterpret_cast<const uint8_t *>(input.data()), input.size());
+		return (OK);
+	}
+	for (int i = 1; i < argc; ++i)
+	{
+		std::ifstream file(argv[i], std::ios::binary);
+		if (!file)
+			return (error("cannot open input"), NOK);
+		std::string input = readAll(file);
+		runInput(reinterpret_cast<const uint8_t *>(input.data()), input.size());
+	}
+	return (OK);
+}
+
+#endif // #ifdef LIBFUZZER
@@ -1,5 +1,6 @@
 #include "handlers.hpp"
 #include "numerics.hpp"
+#include "replies.hpp"
 #include "utils.hpp"
 
 // Example: PASS secretpassword
@@ -10,13 +11,13 @@ void passHandler(const Message &m, State &s, Responses &r)
 		return;
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "PASS", RED "Need more params" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "PASS"));
 	if (s.clients[m.fd].status == WELCOMED)
-		return r.push_back(Message(m.fd, ERR_ALREADYREGISTERED, client, RED "Already registered" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_ALREADYREGISTERED, client));
 	if (m.params.at(0) != s.password)
 	{
 		s.clients[m.fd].status = CONNECTED;
-		return r.push_back(Message(m.fd, ERR_PASSWDMISMATCH, client, RED "Incorrect password" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_PASSWDMISMATCH, client));
 	}
 	else
 		s.clients[m.fd].status = AUTHENTICATED;
@@ -42,16 +43,14 @@ void nickHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NONICKNAMEGIVEN, client, RED "No nick given" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NONICKNAMEGIVEN, client));
 	std::string new_nick = m.params.at(0);
 	if (!isValidNick(new_nick))
-		return r.push_back(Message(m.fd, ERR_ERRONEUSNICKNAME, client, "*", RED "Erroneus nick" RESET));
-	for (std::map<int, Client>::iterator it = s.clients.begin();
-		 it != s.clients.end(); ++it)
-	{
-		if ((*it).second.nick == new_nick)
-			return r.push_back(Message(m.fd, ERR_NICKNAMEINUSE, client, new_nick, RED "Nick in use" RESET));
-	}
+		return r.push_back(numericReply(m.fd, REPLY_ERRONEUSNICKNAME, client, "*"));
+	// a client can change the case of its own nick
+	int owner = s.findClientByNick(new_nick);
+	if (owner != -1 && (owner != m.fd || new_nick == client.nick))
+		return r.push_back(numericReply(m.fd, REPLY_NICKNAMEINUSE, client, new_nick));
 	std::string old_nick = s.clients[m.fd].nick;
 	if (!old_nick.empty())
 	{
@@ -59,9 +58,9 @@ void nickHandler(const Message &m, State &s, Responses &r)
 		std::vector<int> others = s.clientsInChannelsWith(m.fd);
 		std::vector<Message> messages = broadcast.repeat(others);
 		r.push_back(broadcast);
-		r.insert(r.end(), messages.begin(), messages.end());
+		r.append(messages.begin(), messages.end());
 	}
-	s.clients[m.fd].nick = new_nick;
+	s.setNick(m.fd, new_nick);
 }
 
 // Example: USER alice 0 * :Alice Smith
@@ -70,13 +69,13 @@ void userHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 4)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "USER", RED "Need more params" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "USER"));
 	if (client.status == WELCOMED)
-		return r.push_back(Message(m.fd, ERR_ALREADYREGISTERED, client, RED "Already registered" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_ALREADYREGISTERED, client));
 	std::string username = m.params.at(0);
 	if (username.at(0) != '~') // no ident server
 		username = "~" + username;
-	client.username = username;
+	client.setUsername(username);
 	client.realname = m.params.at(3);
 }
 
@@ -92,33 +91,29 @@ void quitHandler(const Message &m, State &s, Responses &r)
 			broadcast.params.push_back(m.params.at(0));
 		std::vector<int> others = s.clientsInChannelsWith(m.fd);
 		std::vector<Message> messages = broadcast.repeat(others);
-		r.insert(r.end(), messages.begin(), messages.end());
+		r.append(messages.begin(), messages.end());
 	}
 	r.push_back(Message(m.fd, "ERROR", "Terminated"));
 	s.removeClient(m.fd);
+
+	Event quit = {EVENT_QUIT, m.fd, -1, -1, &m};
+	s.events.publish(quit, s, r);
 }
 
 // Example: after NICK + USER completed
-// send 001, 002, 003, 004 numeric messages to client
+// send 001, 002, 003, 004, 005 numeric messages to client, LUSERS and MOTD
 void welcomeHandler(const Message &m, State &s, Responses &r)
 {
-	std::string client = s.clients[m.fd];
-	Message m1(m.fd, RPL_WELCOME, client, RED "Welcome!" RESET);
-	Message m2(m.fd, RPL_YOURHOST, client, ORANGE "Your host is 0.0.0.0, running " SERVER_NAME RESET);
-	Message m3(m.fd, RPL_CREATED, client, YELLOW "Created at " + timeToStr(s.start_time), dateToStr(s.start_time) + RESET);
-	Message m4(m.fd, RPL_MYINFO, client, GREEN SERVER_NAME);
-	m4.params.push_back(SERVER_VERSION); // server version
-	m4.params.push_back("o"); // available user modes
-	m4.params.push_back("it"); // available channel modes
-	m4.params.push_back("klo" RESET); // available channel modes with parameters
-	Message m5(m.fd, RPL_ISUPPORT, client);
-	m5.params.push_back(TEAL "CASEMAPPING=ascii");
-	m5.params.push_back("is supported by this server" RESET);
-	r.push_back(m1);
-	r.push_back(m2);
-	r.push_back(m3);
-	r.push_back(m4);
-	r.push_back(m5);
-	s.clients[m.fd].status = WELCOMED;
+	Client &client = s.clients[m.fd];
+	r.push_back(numericReply(m.fd, REPLY_WELCOME, client));
+	r.push_back(numericReply(m.fd, REPLY_YOURHOST, client));
+	const ReplyTemplate &created = replyTemplate(REPLY_CREATED, client);
+	r.push_back(numericReply(m.fd, REPLY_CREATED, client,
+		created.color + "Created at " + timeToStr(s.start_time),
+		dateToStr(s.start_time) + created.reset));
+	r.push_back(numericReply(m.fd, REPLY_MYINFO, client));
+	r.push_back(numericReply(m.fd, REPLY_ISUPPORT, client));
+	s.welcome(m.fd);
+	lusersHandler(m, s, r);
 	return motdHandler(m, s, r);
 }
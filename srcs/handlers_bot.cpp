@@ -1,29 +1,37 @@
 #include <cerrno>
 #include <cstdlib>
+#include <ctime>    // time()
+#include <sstream>
+#include <unistd.h> // getpid()
 
 #include "handlers.hpp"
 #include "BotLogs.class.hpp"
+#include "Random.class.hpp"
 #include "Rolls.class.hpp"
 
 // --- Helper Functions Declaration ---
-static void		autoInviteService(const Message &msg, State &state, Responses &resp);
+static void		onJoin(const Event &event, State &s, Responses &r);
+static void		onPart(const Event &event, State &s, Responses &r);
+static void		onQuit(const Event &event, State &s, Responses &r);
+static void		onPrivmsg(const Event &event, State &s, Responses &r);
+static void		botCommand(const Message &command, State &s, Responses &r);
+static void		leaveIfAlone(int channel_id, State &s, Responses &r);
 static bool		checkClankMessageValid(const std::string &message, bool priv_msg);
 static bool		parseInfoClankMessage(const std::string &message, bool priv_msg);
 static bool		parseDiceClankMessage(const std::string &message, Rolls &rolls);
-static Message	diceRoll(const std::string &key, size_t key_value,
-		size_t count, const std::string &dest);
-static void		vectorToStr(std::vector<int> &ret_vector,
-		std::string &ret_str);
+static void		diceRoll(size_t die, size_t count, std::string &out);
+
+static BotLogs	*g_bot_logs = NULL;
+static BotWorker	g_worker(botAnswer); // joined by botStop()
+static Random		g_random; // the worker's only
 
 // --- Main File Functions ---
 Client createBotClient()
 {
-	std::srand(std::time(0) ^ (getpid()<<16)); // seed for the incoming rolls
-	
 	Client bot;
 
-	bot.nick = BOT_NICK;
-	bot.username = BOT_USERNAME;
+	bot.setNick(BOT_NICK);
+	bot.setUsername(BOT_USERNAME);
 	bot.realname = BOT_REALNAME;
 	bot.status = WELCOMED; // registered
 	bot.modes.insert('o'); // can join any server
@@ -31,182 +39,151 @@ Client createBotClient()
 	return (bot);
 }
 
-void botRouter(const Message &msg, State &s, Responses &r)
+// the bot only hears about the events below, the rest of the traffic
+// does not go through it
+// the rolls are done by the worker, the membership changes stay here
+void botSubscribe(State &s)
 {
-	// handle as usual
-	messageRouter(msg, s, r);
+	static BotLogs bot_logs(s.start_time);
+	g_bot_logs = &bot_logs;
+	if (!g_worker.running()) // seeded before the worker can roll
+		g_random.seed(std::time(0) ^ (getpid() << 16));
+	if (g_worker.start() == ERROR)
+		error("the bot will not answer");
+
+	s.events.subscribe(EVENT_JOIN, BOT_ID, onJoin);
+	s.events.subscribe(EVENT_PART, BOT_ID, onPart);
+	s.events.subscribe(EVENT_QUIT, BOT_ID, onQuit);
+	s.events.subscribe(EVENT_PRIVMSG, BOT_ID, onPrivmsg);
+}
 
-	// handle server responses for the bot
-	size_t i = 0;
-	while (i < r.size())
-	{
-		if (r[i].fd == BOT_ID)
-			botHandler(r[i], s, r);
-		
-		// someone joined a channel
-		else if (r[i].verb == "JOIN")
-			autoInviteService(msg, s, r);
-		++i;
-	}
+// I joined a channel: greetings
+// someone else did: I join too (auto invite service)
+static void onJoin(const Event &event, State &s, Responses &r)
+{
+	const Channel *channel = s.channels.find(event.channel);
+	if (!channel)
+		return;
+	if (event.fd == BOT_ID)
+		return botCommand(Message(BOT_ID, "NOTICE", channel->name, "is ready!"), s, r);
+	if (!channel->isMember(BOT_ID))
+		botCommand(Message(BOT_ID, "JOIN", channel->name), s, r);
 }
 
-void botHandler(const Message &msg, State &s, Responses &r)
+static void onPart(const Event &event, State &s, Responses &r)
 {
-	static BotLogs bot_logs(s.start_time);
-	static Client &my = s.clients[BOT_ID];
+	if (event.fd != BOT_ID)
+		leaveIfAlone(event.channel, s, r);
+}
 
-	// Log message received
-	std::string buffer = msg.assemble();
-	bot_logs.botLogsBuffer(buffer, true);
+static void onQuit(const Event &event, State &s, Responses &r)
+{
+	(void)event;
+	// my own channels only, copied since PART changes them
+	std::set<int> ids = s.clients[BOT_ID].channels;
+	for (std::set<int>::iterator it = ids.begin(); it != ids.end(); ++it)
+		leaveIfAlone(*it, s, r);
+}
 
-	// I am the message source
-	// (for example the confirmation that I joined a channel)
-	if (msg.source == my.hostmask())
-	{
-		// I have joined a channel, send greetings
-		if (msg.verb == "JOIN")
-		{
-			Message command(BOT_ID, "NOTICE", msg.params[0], "is ready!");
-			bot_logs.botLogsBuffer(command.assemble(), false);
-			messageRouter(command, s, r);
-		}
-	}
+// Someone sent a message to the bot, or to one of its channels
+// a full queue drops it: the reactor never waits for the bot
+static void onPrivmsg(const Event &event, State &s, Responses &r)
+{
+	(void)r;
+	const Message &msg = *event.message;
+	bool	priv_msg = event.target == BOT_ID;
+	if (!checkClankMessageValid(msg.params[1], priv_msg))
+		return;
+	g_bot_logs->botLogsBuffer(msg.assemble(), true);
+
+	if (!g_worker.push(s.clients.ref(event.fd),
+			s.channels.ref(priv_msg ? -1 : event.channel), msg.params[1]))
+		error("bot queue full, request dropped");
+}
 
-	// Someone else is the source
-	// (for example, someone left the channel)
-	else if (!msg.source.empty())
-	{
-		// Someone left the channel or quit
-		if (msg.verb == "PART")
-		{
-			const std::string &channel_name = msg.params[0];
-			if (s.channels.count(channel_name)) // Check if channel exists
-			{
-				Channel &channel = s.channels[channel_name];
-				if (channel.client_ids.size() == 1 && channel.client_ids.count(BOT_ID))
-				{
-					// I am alone here, leave
-					Message command(BOT_ID, "PART", channel_name);
-					bot_logs.botLogsBuffer(command.assemble(), false);
-					messageRouter(command, s, r);
-				}
-			}
-		}
-		else if (msg.verb == "QUIT")
-		{
-			std::map<std::string, Channel>::iterator it;
-			for (it = s.channels.begin(); it != s.channels.end();)
-			{
-				std::map<std::string, Channel>::iterator next = it;
-				next++;
+int botWakeFd()
+{
+	return g_worker.wakeFd();
+}
 
-				if (it->second.client_ids.size() == 1)
-				{
-					// I am alone here, leave
-					Message command(BOT_ID, "PART", it->first);
-					bot_logs.botLogsBuffer(command.assemble(), false);
-					messageRouter(command, s, r);
-				}
-				it = next;
-			}
-		}
-		// Someone sent a message to the bot, or the channel
-		else if (msg.verb == "PRIVMSG")
-		{
-			bool	priv_msg = false;
-			std::string destination;
-			if (msg.params[0] == my.nick)
-			{
-				size_t excl_pos = msg.source.find('!', 0);
-				destination = msg.source.substr(0, excl_pos);
-				priv_msg = true;
-			}
-			else
-				destination = msg.params[0];
+void botStop()
+{
+	g_worker.stop();
+}
+
+// where a reply goes now, empty if the requester quit (its fd may be
+// someone else's) or left the channel since the request, or the channel
+// is gone (its id may be another channel's)
+static std::string replyDestination(const BotReply &reply, State &s)
+{
+	const Client *client = s.clients.find(reply.requester);
+	if (!client)
+		return "";
+	if (reply.channel.id < 0)
+		return client->nick;
+	const Channel *channel = s.channels.find(reply.channel);
+	if (!channel || !channel->isMember(reply.requester.fd))
+		return "";
+	return channel->name;
+}
 
-			const std::string &message = msg.params[1];
+// the replies ready, sent as the bot's NOTICEs
+void botDrain(State &s, Responses &r)
+{
+	g_worker.clearWake();
+	BotReply *reply;
+	while ((reply = g_worker.front()))
+	{
+		std::string destination = replyDestination(*reply, s);
+		for (size_t i = 0; !destination.empty() && i < reply->lines.size(); ++i)
+			botCommand(Message(BOT_ID, "NOTICE", destination,
+				reply->lines[i]), s, r);
+		g_worker.pop();
+	}
+}
 
-			Rolls rolls;
-			if (checkClankMessageValid(message, priv_msg))
-			{
-				if (parseInfoClankMessage(message, priv_msg))
-				{
-					std::vector<std::string> rolls_info = rolls.info();
-					for (size_t i = 0; i < rolls_info.size(); i++)
-					{
-						Message info_msg(BOT_ID, "NOTICE", destination, rolls_info.at(i));
-						bot_logs.botLogsBuffer(info_msg.assemble(), false);
-						messageRouter(info_msg, s, r);
-					}
-				}
-				else if (parseDiceClankMessage(message, rolls))
-				{
-					Message line_top(BOT_ID, "NOTICE", destination, "-----");
-					Message command(BOT_ID, "NOTICE", destination,
-							REVERSED "List of requested rolls" RESET " => " + rolls.list());
-					bot_logs.botLogsBuffer(line_top.assemble(), false);
-					bot_logs.botLogsBuffer(command.assemble(), false);
-					messageRouter(line_top, s, r);
-					messageRouter(command, s, r);
-
-					size_t	n_keys = rolls.getKeysNum();
-					for (size_t i = 0; i < n_keys; i++)
-					{
-						std::string key = rolls.getKey(i);
-						size_t		count = rolls.getCount(key);
-						if (count > 0)
-						{
-							int	key_value = std::atoi(key.substr(1, key.size() - 1).c_str());
-							Message empty_line(BOT_ID, "NOTICE", destination, "");
-							Message dice_roll_ret = diceRoll(key, static_cast<size_t>(key_value),
-									count, destination);
-							bot_logs.botLogsBuffer("", false);
-							bot_logs.botLogsBuffer(dice_roll_ret.assemble(), false);
-							messageRouter(empty_line, s, r);
-							messageRouter(dice_roll_ret, s, r);
-						}
-					}
-					Message line_bot(BOT_ID, "NOTICE", destination, "-----");
-					bot_logs.botLogsBuffer(line_bot.assemble(), false);
-					messageRouter(line_bot, s, r);
-				}
-			}
-		}
+// on the worker thread: only the request, never the state
+void botAnswer(const BotRequest &request, BotReply &reply)
+{
+	std::vector<std::string> &lines = reply.lines;
+	Rolls rolls;
+	if (parseInfoClankMessage(request.text, request.channel.id < 0))
+	{
+		lines = Rolls::info();
+		return;
 	}
+	if (!parseDiceClankMessage(request.text, rolls))
+		return;
+	lines.push_back("-----");
+	lines.push_back(REVERSED "List of requested rolls" RESET " => " + rolls.list());
 
-	// The server sent me a message
-	else
+	for (size_t i = 0; i < Rolls::getKeysNum(); i++)
 	{
-		// Someone just connected ot the server
-		if (msg.verb == "INVITE")
+		size_t	count = rolls.getCount(i);
+		if (count > 0)
 		{
-			// Their Irssi sent "JOIN :" and I am getting this invite
-			if (msg.params[1].empty())
-			{
-			}
-			// I am invited to a channel
-			else
-			{
-				Message command(BOT_ID, "JOIN", msg.params[1]);
-				bot_logs.botLogsBuffer(command.assemble(), false);
-				messageRouter(command, s, r);
-			}
+			lines.push_back(""); // a blank line, then the rolls
+			lines.push_back("");
+			diceRoll(i, count, lines.back());
 		}
 	}
+	lines.push_back("-----");
 }
 
-// --- Helper Functions ---
-static void autoInviteService(const Message &msg, State &state, Responses &r)
+// sent by the bot as if it were a client
+static void botCommand(const Message &command, State &s, Responses &r)
 {
-	// assume msg.verb is a JOIN broadcast from the joinHandler
-	const std::string &channel_name = msg.params[0];
-	Channel &channel = state.channels[channel_name];
+	if (g_bot_logs)
+		g_bot_logs->botLogsBuffer(command.assemble(), false);
+	messageRouter(command, s, r);
+}
 
-	// if the bot is not in the channel, invite
-	if (!channel.client_ids.count(BOT_ID))
-	{
-		r.push_back(Message(BOT_ID, "INVITE", "*", channel_name));
-	}
+// a channel with only the bot left is not kept alive by it
+static void leaveIfAlone(int channel_id, State &s, Responses &r)
+{
+	const Channel *channel = s.channels.find(channel_id);
+	if (channel && channel->size() == 1 && channel->isMember(BOT_ID))
+		botCommand(Message(BOT_ID, "PART", channel->name), s, r);
 }
 
 static bool	checkClankMessageValid(const std::string &message, bool priv_msg)
@@ -254,18 +231,9 @@ static bool parseDiceClankMessage(const std::string &message, Rolls &rolls)
 			while (start > 0 && std::isdigit(token[start - 1]))
 				start--;
 			// Check if the previous digits belong to another dice
-			if (start > 0 && token[start - 1] == 'd')
-			{
-				std::string prev_dice = "d" + token.substr(start, dpos - start);
-				for (size_t i = 0; !rolls.getKey(i).empty(); i++)
-				{
-					if (prev_dice == rolls.getKey(i))
-					{
-						start = dpos;
-						break;
-					}
-				}
-			}
+			if (start > 0 && token[start - 1] == 'd'
+				&& Rolls::find(token, start - 1, dpos) != -1)
+				start = dpos;
 
 			// Read digits after 'd'
 			size_t end = dpos + 1;
@@ -304,18 +272,12 @@ static bool parseDiceClankMessage(const std::string &message, Rolls &rolls)
 			}
 
 
-			std::string dice_type = "d" + token.substr(dpos + 1, end - (dpos + 1));
-
 			// Validate that this dice type exists
-			for (size_t i = 0; !rolls.getKey(i).empty(); i++)
+			int die = Rolls::find(token, dpos, end);
+			if (die != -1)
 			{
-				if (dice_type == rolls.getKey(i))
-				{
-					if (!found_dice)
-						found_dice = true;
-					rolls.addToCount(dice_type, multiplier);
-					break;
-				}
+				found_dice = true;
+				rolls.addToCount(die, multiplier);
 			}
 
 			// Move past the entire match
@@ -326,32 +288,34 @@ static bool parseDiceClankMessage(const std::string &message, Rolls &rolls)
 	return (found_dice);
 }
 
-static Message	diceRoll(const std::string &key, size_t key_value,
-		size_t count, const std::string &dest)
+static void	appendNumber(std::string &out, uint32_t n)
 {
-	std::vector<int> ret_vector;
-	for (size_t i = 0; i < count; i++)
-		ret_vector.push_back((std::rand() % key_value) + 1);
-
-	std::string ret_str;
-	vectorToStr(ret_vector, ret_str);
-
-	Message command(BOT_ID, "NOTICE", dest, 
-			UBOLD + key + ":" + RESET + " " + ret_str);
-	return (command);
+	char	digits[10];
+	size_t	len = 0;
+	do
+	{
+		digits[len++] = '0' + n % 10;
+		n /= 10;
+	} while (n);
+	while (len)
+		out += digits[--len];
 }
 
-static void	vectorToStr(std::vector<int> &ret_vector,
-		std::string &ret_str)
+// Example: "d6: 5, 6, 1", the rolls of one die in a single pass
+static void	diceRoll(size_t die, size_t count, std::string &out)
 {
-	size_t				vector_size = ret_vector.size();
-	std::ostringstream	oss;
-
-	for (size_t i = 0; i < vector_size; i++)
+	const Die	&d = Rolls::getDie(die);
+	uint32_t	rolls[ROLLS_MAX_COUNT];
+	g_random.fill(d.sides, rolls, count);
+
+	out.reserve(count * 5 + 16);
+	out += UBOLD;
+	out += d.key;
+	out += ":" RESET " ";
+	for (size_t i = 0; i < count; i++)
 	{
-		oss << ret_vector[i];
-		if (i + 1 < vector_size)
-			oss << ", ";
+		if (i)
+			out += ", ";
+		appendNumber(out, rolls[i] + 1);
 	}
-	ret_str = oss.str();
 }
@@ -1,6 +1,7 @@
 #include "colors.hpp"
 #include "handlers.hpp"
 #include "numerics.hpp"
+#include "replies.hpp"
 
 static bool isValidChannelName(const std::string &name)
 {
@@ -9,91 +10,136 @@ static bool isValidChannelName(const std::string &name)
 	return name[0] == '#';
 }
 
-void joinHandler(const Message &m, State &s, Responses &r)
+// RPL_TOPIC or RPL_NOTOPIC, for TOPIC <channel> and JOIN
+static void sendTopic(int fd, const Client &client, const Channel &channel,
+	Responses &r)
 {
-	Client &client = s.clients[m.fd];
-	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, m.verb, RED "Not enough parameters" RESET));
+	if (channel.topic.empty())
+		return r.push_back(numericReply(fd, REPLY_NOTOPIC, client, channel.name));
+	r.push_back(numericReply(fd, REPLY_TOPIC, client, channel.name, channel.topic));
+}
 
-	std::string channel_name = m.params.at(0);
+// RPL_NAMREPLY per cached chunk and RPL_ENDOFNAMES, for NAMES and JOIN
+// a nick longer than NAMES_NICK_ROOM needs smaller chunks, built here
+static void sendNames(int fd, const Client &client, const Channel &channel,
+	Responses &r)
+{
+	std::vector<std::string> smaller;
+	if (client.nick.size() > NAMES_NICK_ROOM)
+		channel.names.rechunk(channel.namesBudget(client.nick.size()), smaller);
+	const std::vector<std::string> &chunks = smaller.empty()
+		? channel.names.chunks() : smaller;
+	for (size_t i = 0; i < chunks.size(); ++i)
+		r.push_back(numericReply(fd, REPLY_NAMREPLY, client, "=", channel.name,
+			chunks[i]));
+	r.push_back(numericReply(fd, REPLY_ENDOFNAMES, client, channel.name));
+}
 
+static void joinChannel(const Message &m, const std::string &channel_name,
+	const std::string &key, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
 	if (!isValidChannelName(channel_name))
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client, channel_name, RED "No such channel" RESET));
-
-	// create if no channel
-	if (s.channels.find(channel_name) == s.channels.end())
-	{
-		s.channels[channel_name].name = channel_name;
-	}
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client, channel_name));
 
+	// create if no channel, the name is resolved once
 	Channel &channel = s.channels[channel_name];
 
-	if (channel.client_ids.find(m.fd) != channel.client_ids.end())
-		return r.push_back(Message(m.fd, ERR_USERONCHANNEL, client, "JOIN", RED "Already on channel" RESET));
+	if (channel.isMember(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_USERONCHANNEL, client, client.nick, channel_name));
 
 	// check channel mode +k
-	if (!client.isOp() && channel.modes.count('k'))
+	if (!client.isOp() && channel.modes.has(MODE_KEY))
 	{
-		if (m.params.size() < 2 || m.params.at(1) != channel.key)
-			return r.push_back(Message(m.fd, ERR_BADCHANNELKEY, client, channel_name, RED "Cannot join channel (+k)" RESET));
+		if (key != channel.key)
+			return r.push_back(numericReply(m.fd, REPLY_BADCHANNELKEY, client, channel_name));
 	}
 
 	// check channel mode +l
-	if (!client.isOp() && channel.modes.count('l'))
+	if (!client.isOp() && channel.modes.has(MODE_LIMIT))
 	{
-		if (channel.client_ids.size() >= channel.userlimit)
-			return r.push_back(Message(m.fd, ERR_CHANNELISFULL, client, channel_name, RED "Cannot join channel (+l)" RESET));
+		if (channel.size() >= channel.userlimit)
+			return r.push_back(numericReply(m.fd, REPLY_CHANNELISFULL, client, channel_name));
 	}
 
 	// check channel mode +i
-	if (!client.isOp() && channel.modes.count('i'))
+	if (!client.isOp() && channel.modes.has(MODE_INVITE))
 	{
-		if (!channel.invited_ids.count(m.fd))
-			return r.push_back(Message(m.fd, ERR_INVITEONLYCHAN, client, channel_name, RED "Cannot join channel (+i)" RESET));
+		if (!channel.isInvited(m.fd))
+			return r.push_back(numericReply(m.fd, REPLY_INVITEONLYCHAN, client, channel_name));
 	}
 
-	// add to channel
-	if (channel.client_ids.empty())
-		channel.op_ids.insert(m.fd);
-	channel.client_ids.insert(m.fd);
+	// add to channel, the first member is op
+	s.addMember(m.fd, channel, channel.empty() ? MEMBER_OP : 0);
 
 	// remove from invited list, invites have one-use
-	channel.invited_ids.erase(m.fd);
+	s.uninvite(m.fd, channel);
 
 	// broadcast to everyone in the channel after joining
-	Responses broadcast = Message(client.hostmask(), m.fd, "JOIN", channel_name)
-		.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	channel.broadcast(Message(client.hostmask(), m.fd, "JOIN", channel_name), r);
 
 	// adds TOPIC and NAMES
-	topicHandler(Message(m.fd, "TOPIC", channel_name), s, r);
-	namesHandler(Message(m.fd, "NAMES", channel_name), s, r);
+	sendTopic(m.fd, client, channel, r);
+	sendNames(m.fd, client, channel, r);
+
+	Event joined = {EVENT_JOIN, m.fd, channel.id, -1, &m};
+	s.events.publish(joined, s, r);
 }
 
-void partHandler(const Message &m, State &s, Responses &r)
+// JOIN <channel>{,<channel>} [<key>{,<key>}]
+// keys go to the channels in the same position
+void joinHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
-
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, m.verb, RED "Not enough parameters" RESET));
-
-	std::string channel_name = m.params.at(0);
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, m.verb));
+
+	std::vector<std::string> names = split_targets(m.params[0]);
+	std::vector<std::string> keys;
+	if (m.params.size() >= 2)
+		keys = split_targets(m.params[1]);
+	size_t n_targets = limit_targets(m.fd, client, names, MAX_JOIN_TARGETS, r);
+	std::set<std::string> seen; // case-folded, a repeated channel is skipped
+	for (size_t i = 0; i < n_targets; ++i)
+		if (seen.insert(CaseMap::fold(names[i])).second)
+			joinChannel(m, names[i], i < keys.size() ? keys[i] : "", s, r);
+}
 
-	if (s.channels.find(channel_name) == s.channels.end())
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client, channel_name, RED "No such channel" RESET));
+static void partChannel(const Message &m, const std::string &channel_name,
+	State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+	Channel *found = s.channels.find(channel_name);
+	if (!found)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client, channel_name));
 
-	Channel &channel = s.channels[channel_name];
-	if (channel.client_ids.find(m.fd) == channel.client_ids.end())
-		return r.push_back(Message(m.fd, ERR_NOTONCHANNEL, client, channel_name, RED "You're not on that channel" RESET));
+	Channel &channel = *found;
+	if (!channel.isMember(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_NOTONCHANNEL, client, channel_name));
 
 	// broadcast to everyone in the channel before leaving
-	Responses broadcast = Message(client.hostmask(), m.fd, "PART", channel_name).repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	channel.broadcast(Message(client.hostmask(), m.fd, "PART", channel_name), r);
 
-	channel.client_ids.erase(m.fd); // remove client from channel member list
-	channel.op_ids.erase(m.fd);
-	if (channel.client_ids.empty()) // if no user in channel
-		s.channels.erase(channel_name); // delete channel
+	// remove client from channel member list, delete channel if empty
+	Event parted = {EVENT_PART, m.fd, channel.id, -1, &m};
+	s.removeMember(m.fd, channel);
+	s.events.publish(parted, s, r);
+}
+
+// PART <channel>{,<channel>}
+void partHandler(const Message &m, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+
+	if (m.params.size() < 1)
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, m.verb));
+
+	std::vector<std::string> names = split_targets(m.params[0]);
+	size_t n_targets = limit_targets(m.fd, client, names, MAX_PART_TARGETS, r);
+	std::set<std::string> seen; // case-folded, a repeated channel is skipped
+	for (size_t i = 0; i < n_targets; ++i)
+		if (seen.insert(CaseMap::fold(names[i])).second)
+			partChannel(m, names[i], s, r);
 }
 
 void kickHandler(const Message &m, State &s, Responses &r)
@@ -101,7 +147,7 @@ void kickHandler(const Message &m, State &s, Responses &r)
 	Client &client = s.clients[m.fd];
 
 	if (m.params.size() < 2)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "KICK", RED "Not enough parameters" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "KICK"));
 
 	std::string channel_name = m.params.at(0);
 	std::string target_nick = m.params.at(1);
@@ -109,41 +155,38 @@ void kickHandler(const Message &m, State &s, Responses &r)
 	if (m.params.size() >= 3 && !m.params.at(2).empty())
 		reason = m.params.at(2);
 
-	if (s.channels.find(channel_name) == s.channels.end())
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client, channel_name, RED "No such channel" RESET));
+	Channel *found = s.channels.find(channel_name);
+	if (!found)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client, channel_name));
 
-	Channel &channel = s.channels[channel_name];
-	if (!client.isOp() && channel.client_ids.find(m.fd) == channel.client_ids.end())
-		return r.push_back(Message(m.fd, ERR_NOTONCHANNEL, client, channel_name, RED "You're not on that channel" RESET));
+	Channel &channel = *found;
+	if (!client.isOp() && !channel.isMember(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_NOTONCHANNEL, client, channel_name));
 
-	if (!client.isOp() && channel.op_ids.find(m.fd) == channel.op_ids.end())
-		return r.push_back(Message(m.fd, ERR_CHANOPRIVSNEEDED, client, channel_name, RED "You're not channel operator" RESET));
+	if (!client.isOp() && !channel.isOp(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_CHANOPRIVSNEEDED, client, channel_name));
 
 	int target_fd = s.findClientByNick(target_nick);
 	if (target_fd == -1) // target nick not found
-		return r.push_back(Message(m.fd, ERR_NOSUCHNICK, client, target_nick, RED "No such nick"));
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHNICK, client, target_nick));
 
-	if (channel.client_ids.find(target_fd) == channel.client_ids.end()) // target not in channel
-		return r.push_back(Message(m.fd, ERR_USERNOTINCHANNEL, client, target_nick + " " + channel_name, RED "They aren't on that channel" RESET));
+	if (!channel.isMember(target_fd)) // target not in channel
+		return r.push_back(numericReply(m.fd, REPLY_USERNOTINCHANNEL, client, target_nick, channel_name));
 
 	// broadcast to everyone in the channel
-	Responses broadcast = Message(client.hostmask(), m.fd, "KICK", channel_name, s.clients[target_fd], reason)
-		.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	channel.broadcast(Message(client.hostmask(), m.fd, "KICK", channel_name,
+		s.clients[target_fd], reason), r);
 
 	// remove target from channel
-	channel.client_ids.erase(target_fd); // remove target from channel member list
-	channel.invited_ids.erase(target_fd); // remove target from channel invit list
-	channel.op_ids.erase(target_fd); // remove from ops if was op
-	if (channel.client_ids.empty()) // if no user in channel
-		s.channels.erase(channel_name); // delete channel
+	s.uninvite(target_fd, channel); // remove target from channel invit list
+	s.removeMember(target_fd, channel); // also ops, deletes channel if empty
 }
 
 void inviteHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 2)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "INVITE", RED "Not enough parameters" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "INVITE"));
 
 	std::string target_nick = m.params.at(0);
 	std::string channel_name = m.params.at(1);
@@ -151,26 +194,27 @@ void inviteHandler(const Message &m, State &s, Responses &r)
 	if (m.params.size() >= 3)
 		reason = m.params.at(2);
 
-	if (s.channels.find(channel_name) == s.channels.end())
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client, channel_name, RED "No such channel" RESET));
+	Channel *found = s.channels.find(channel_name);
+	if (!found)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client, channel_name));
 
-	Channel &channel = s.channels[channel_name];
-	if (!client.isOp() && channel.client_ids.find(m.fd) == channel.client_ids.end())
-		return r.push_back(Message(m.fd, ERR_NOTONCHANNEL, client, channel_name, RED "You're not on that channel" RESET));
+	Channel &channel = *found;
+	if (!client.isOp() && !channel.isMember(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_NOTONCHANNEL, client, channel_name));
 
 	
-	if (!client.isOp() && channel.op_ids.find(m.fd) == channel.op_ids.end())
-		return r.push_back(Message(m.fd, ERR_CHANOPRIVSNEEDED, client, channel_name, RED "You're not channel operator" RESET));
+	if (!client.isOp() && !channel.isOp(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_CHANOPRIVSNEEDED, client, channel_name));
 
 	int target_fd = s.findClientByNick(target_nick);
 	if (target_fd == -1) // target nick not found
-		return r.push_back(Message(m.fd, ERR_NOSUCHNICK, client, target_nick, RED "No such nick"));
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHNICK, client, target_nick));
 
-	if (channel.client_ids.find(target_fd) != channel.client_ids.end()) // target in channel
-		return r.push_back(Message(m.fd, ERR_USERONCHANNEL, client, RED + target_nick + " " + channel_name, "is already on channel" RESET));
+	if (channel.isMember(target_fd)) // target in channel
+		return r.push_back(numericReply(m.fd, REPLY_USERONCHANNEL, client, target_nick, channel_name));
 
-	channel.invited_ids.insert(target_fd);
-	r.push_back(Message(m.fd, RPL_INVITING, client, target_nick, channel_name));
+	s.invite(target_fd, channel);
+	r.push_back(numericReply(m.fd, REPLY_INVITING, client, target_nick, channel_name));
 	r.push_back(Message(client.hostmask(), target_fd, "INVITE", target_nick, channel_name));
 }
 
@@ -178,46 +222,39 @@ void topicHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "TOPIC", RED "Not enough parameters" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "TOPIC"));
 
 	std::string channel_name = m.params.at(0);
-	if (s.channels.find(channel_name) == s.channels.end())
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client, channel_name, RED "No such channel" RESET));
-	Channel &channel = s.channels[channel_name];
+	Channel *found = s.channels.find(channel_name);
+	if (!found)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client, channel_name));
+	Channel &channel = *found;
 
 	if (m.params.size() < 2) // view topic only
-	{
-		if (channel.topic.empty())
-			return r.push_back(Message(m.fd, RPL_NOTOPIC, client, channel_name, "No topic is set"));
-		return r.push_back(Message(m.fd, RPL_TOPIC, client, channel_name, channel.topic));
-	}
+		return sendTopic(m.fd, client, channel, r);
 
 	std::string new_topic = m.params.at(1);
 
-	if (!client.isOp() && channel.client_ids.find(m.fd) == channel.client_ids.end())
-		return r.push_back(Message(m.fd, ERR_NOTONCHANNEL, client, channel_name, RED "You're not on that channel" RESET));
+	if (!client.isOp() && !channel.isMember(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_NOTONCHANNEL, client, channel_name));
 
-	if (!client.isOp() && channel.modes.count('t') && channel.op_ids.find(m.fd) == channel.op_ids.end())
-		return r.push_back(Message(m.fd, ERR_CHANOPRIVSNEEDED, client, channel_name, RED "You're not channel operator. Mode is +t" RESET));
+	if (!client.isOp() && channel.modes.has(MODE_TOPIC) && !channel.isOp(m.fd))
+		return r.push_back(numericReply(m.fd, REPLY_TOPICPROTECTED, client, channel_name));
 
 	channel.topic = new_topic;
-	Responses broadcast = Message(client.hostmask(), m.fd, "TOPIC", channel_name, channel.topic)
-		.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	channel.broadcast(Message(client.hostmask(), m.fd, "TOPIC", channel_name, channel.topic), r);
 }
 
 void namesHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "NAMES", RED "Not enough parameters" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "NAMES"));
 
 	std::string channel_name = m.params.at(0);
-	if (s.channels.find(channel_name) == s.channels.end())
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client, channel_name, RED "No such channel" RESET));
+	const Channel *channel = s.channels.find(channel_name);
+	if (!channel)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client, channel_name));
 
-	Message namreply(m.fd, RPL_NAMREPLY, client, "=", channel_name);
-	namreply.params.push_back(s.getNamesInChannel(channel_name));
-	r.push_back(namreply);
-	r.push_back(Message(m.fd, RPL_ENDOFNAMES, client, channel_name, "End of /names reply"));
+	sendNames(m.fd, client, *channel, r);
 }
@@ -1,23 +1,24 @@
 #include "colors.hpp"
 #include "handlers.hpp"
 #include "numerics.hpp"
+#include "replies.hpp"
 
 static void errorNeedMoreParams(const Message &m, State &s, Responses &r)
 {
-	return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, s.clients[m.fd],
-							   m.verb, RED "Not enough parameters" RESET));
+	return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS,
+							   s.clients[m.fd], m.verb));
 }
 
 static void errorNoSuchNick(const Message &m, State &s, Responses &r)
 {
-	return r.push_back(Message(m.fd, ERR_NOSUCHNICK, s.clients[m.fd],
-							   m.verb, RED "No such nick/channel" RESET));
+	return r.push_back(numericReply(m.fd, REPLY_NOSUCHNICK,
+							   s.clients[m.fd], m.verb));
 }
 
 static void errorUnknownFlag(const Message &m, State &s, Responses &r)
 {
-	return r.push_back(Message(m.fd, ERR_UMODEUNKNOWNFLAG, s.clients[m.fd],
-							   RED "Unknown MODE flag" RESET));
+	return r.push_back(numericReply(m.fd, REPLY_UMODEUNKNOWNFLAG,
+							   s.clients[m.fd]));
 }
 
 static void userModeHandler(const Message &m, State &s, Responses &r)
@@ -25,25 +26,22 @@ static void userModeHandler(const Message &m, State &s, Responses &r)
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 2)
 	{
-		std::string modestring = "+" +
-								 std::string(client.modes.begin(), client.modes.end());
-		return r.push_back(Message(m.fd, RPL_UMODEIS, client, modestring));
+		return r.push_back(numericReply(m.fd, REPLY_UMODEIS, client,
+			client.modes.render()));
 	}
 	std::string target = m.params.at(0);
-	if (s.findClientByNick(target) == -1)
-		return r.push_back(Message(m.fd, ERR_NOSUCHNICK, client, target,
-								   RED "No such nick" RESET));
-	if (target != client.nick)
-		return r.push_back(Message(m.fd, ERR_USERSDONTMATCH, client,
-								   RED "Cant change mode for other users" RESET));
+	int target_fd = s.findClientByNick(target);
+	if (target_fd == -1)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHNICK, client, target));
+	if (target_fd != m.fd)
+		return r.push_back(numericReply(m.fd, REPLY_USERSDONTMATCH, client));
 	std::string modestring = m.params.at(1);
 	if (modestring.empty())
 		return errorUnknownFlag(m, s, r);
 	if (modestring[0] == '+')
 	{
 		if (modestring.find('o') != std::string::npos)
-			return r.push_back(Message(m.fd, ERR_NOPRIVILEGES, client,
-									   RED "Permission denied - You're not an IRC op" RESET));
+			return r.push_back(numericReply(m.fd, REPLY_NOPRIVILEGES, client));
 		// irssi sends MODE +i even if it is not supported, replying UMODEIS
 		if (modestring == "+i")
 			return userModeHandler(Message(m.fd, "MODE", client.nick), s, r);
@@ -53,7 +51,7 @@ static void userModeHandler(const Message &m, State &s, Responses &r)
 	{
 		if (modestring.find('o') != std::string::npos)
 		{
-			client.modes.clear();
+			s.setOper(m.fd, false);
 			return userModeHandler(Message(m.fd, "MODE", m.params[0]), s, r);
 		}
 		return errorUnknownFlag(m, s, r);
@@ -62,7 +60,7 @@ static void userModeHandler(const Message &m, State &s, Responses &r)
 	{
 		if (modestring.find('i') != std::string::npos)
 		{
-			client.modes.clear();
+			s.setOper(m.fd, false);
 			return userModeHandler(Message(m.fd, "MODE", m.params[0]), s, r);
 		}
 		return errorUnknownFlag(m, s, r);
@@ -75,147 +73,163 @@ static void userModeHandler(const Message &m, State &s, Responses &r)
 // - as a response to MODE <channel>
 // - as a response to setting a flag that is already set
 // - NOT as a response to changing a flag, that response is "MODE"
-static void channelQueryModeHandler(const Message &m, State &s, Responses &r)
+static void channelQueryModeHandler(const Message &m, const Channel &channel,
+	Responses &r)
 {
 	const std::string &ch_name = m.params[0];
-	const Channel &channel = s.channels[ch_name];
-	Message response = Message(m.fd, RPL_CHANNELMODEIS, ch_name, "+");
-	std::set<char>::const_iterator it;
-	for (it = channel.modes.begin(); it != channel.modes.end(); ++it)
-	{
-		response.params[1] += *it;
-		if (*it == 'l')
-			response.params.push_back(size_to_str(channel.userlimit));
-	}
+	Message response = Message(m.fd, RPL_CHANNELMODEIS, ch_name,
+		channel.modes.render());
+	if (channel.modes.has(MODE_LIMIT))
+		response.params.push_back(size_to_str(channel.userlimit));
 
 	r.push_back(response);
 }
 
-static void inviteFlagHandler(const Message &m, State &s, Responses &r)
+// a flag (or a member for o) changed by a MODE command, in the order
+// first seen, with its state before the command
+struct ModeTouch
 {
-	const std::string &ch_name = m.params[0];
-	Channel &channel = s.channels[ch_name];
-	if (m.params[1][0] == '-')
+	char	flag;
+	int		fd; // o only
+	bool	was_set;
+};
+
+// state of the channel before a MODE command, only the net change
+// is broadcast: "+i-i" sends nothing, "+l 5+l 6" sends "+l 6"
+struct ModeChanges
+{
+	ModeMask				modes;
+	std::string				key;
+	size_t					userlimit;
+	std::vector<ModeTouch>	touched;
+
+	explicit ModeChanges(const Channel &channel)
+		: modes(channel.modes), key(channel.key),
+		  userlimit(channel.userlimit)
 	{
-		if (!channel.modes.count('i'))
-			return ;
-		channel.modes.erase('i');
 	}
-	else
+
+	void touch(char flag, int fd, bool was_set)
 	{
-		if (channel.modes.count('i'))
-			return ;
-		channel.modes.insert('i');
+		for (size_t i = 0; i < touched.size(); ++i)
+			if (touched[i].flag == flag && touched[i].fd == fd)
+				return ;
+		ModeTouch t = {flag, fd, was_set};
+		touched.push_back(t);
 	}
+};
 
-	Message notification = m;
-	notification.source = s.clients[m.fd].hostmask();
-	Responses broadcast = notification.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+static void inviteFlagHandler(const Message &m, Channel &channel)
+{
+	if (m.params[1][0] == '-')
+		channel.modes.erase('i');
+	else
+		channel.modes.insert('i');
 }
 
-static void topicFlagHandler(const Message &m, State &s, Responses &r)
+static void topicFlagHandler(const Message &m, Channel &channel)
 {
-	Channel &channel = s.channels[m.params[0]];
 	if (m.params[1][0] == '-')
-	{
-		if (!channel.modes.count('t'))
-			return ;
 		channel.modes.erase('t');
-	}
 	else
-	{
-		if (channel.modes.count('t'))
-			return ;
 		channel.modes.insert('t');
-	}
-	Message notification = m;
-	notification.source = s.clients[m.fd].hostmask();
-	Responses broadcast = notification.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
 }
 
-static void keyFlagHandler(const Message &m, State &s, Responses &r)
+static void keyFlagHandler(const Message &m, Channel &channel, State &s,
+	Responses &r)
 {
-	Channel &channel = s.channels[m.params[0]];
 	if (m.params[1][0] == '-')
 	{
-		if (!channel.modes.count('k'))
-			return ;
 		channel.modes.erase('k');
 		channel.key.clear();
+		return ;
 	}
-	else
-	{
-		std::string key = m.params[2];
-		// Key can't be empty or contain spaces
-		if (key.empty())
-			return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS,
-				s.clients[m.fd], "MODE", RED "Key cannot be empty" RESET));
-		if (key.find(' ') != std::string::npos || key.find(',') != std::string::npos)
-			return r.push_back(Message(m.fd, ERR_INVALIDKEY,
-				s.clients[m.fd], m.params[0], RED "Invalid key" RESET));
-		channel.modes.insert('k');
-		channel.key = key;
-	}
-	// Broadcast without revealing the key
-	Message notification(s.clients[m.fd], m.fd, "MODE", m.params[0], m.params[1]);
-	notification.source = s.clients[m.fd].hostmask();
-	Responses broadcast = notification.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	const std::string &key = m.params[2];
+	// Key can't be empty or contain spaces
+	if (key.empty())
+		return r.push_back(numericReply(m.fd, REPLY_EMPTYKEY,
+			s.clients[m.fd], "MODE"));
+	if (key.find(' ') != std::string::npos || key.find(',') != std::string::npos)
+		return r.push_back(numericReply(m.fd, REPLY_INVALIDKEY,
+			s.clients[m.fd], m.params[0]));
+	channel.modes.insert('k');
+	channel.key = key;
 }
 
-static void opFlagHandler(const Message &m, State &s, Responses &r)
+static void opFlagHandler(const Message &m, Channel &channel, State &s,
+	Responses &r, ModeChanges &changes)
 {
-	if (m.params.size() < 3)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS,
-			s.clients[m.fd], "MODE", RED "Need more params" RESET));
-	std::string ch_name = m.params[0];
-	Channel &channel = s.channels[ch_name];
 	const std::string &target_nick = m.params[2];
 	int target_fd = s.findClientByNick(target_nick);
-	if (!channel.client_ids.count(target_fd))
-		return r.push_back(Message(m.fd, ERR_USERNOTINCHANNEL,
-			s.clients[m.fd], target_nick, ch_name));
-	if (m.params[1][0] == '-')
-	{
-		if (!channel.op_ids.count(target_fd))
-			return ;
-		channel.op_ids.erase(target_fd);
-	}
-	else
-	{
-		if (channel.op_ids.count(target_fd))
-			return ;
-		channel.op_ids.insert(target_fd);
-	}
-	Message notification = m;
-	notification.source = s.clients[m.fd].hostmask();
-	Responses broadcast = notification.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	if (!channel.isMember(target_fd))
+		return r.push_back(numericReply(m.fd, REPLY_USERNOTINCHANNEL,
+			s.clients[m.fd], target_nick, m.params[0]));
+	changes.touch('o', target_fd, channel.isOp(target_fd));
+	channel.setFlag(target_fd, MEMBER_OP, m.params[1][0] == '+');
 }
 
-static void limitFlagHandler(const Message &m, State &s, Responses &r)
+static void limitFlagHandler(const Message &m, Channel &channel)
 {
-	Channel &channel = s.channels[m.params[0]];
 	if (m.params[1][0] == '-')
+		return channel.modes.erase('l');
+	channel.modes.insert('l');
+	channel.userlimit = str_to_size(m.params[2]);
+}
+
+// one line, split only if it would go over MAX_MSG_LEN: there are
+// MAX_MODES changes at most, channelModeHandler applies no more flags
+static void broadcastModes(const Message &m, const Channel &channel,
+	const ModeChanges &changes, State &s, Responses &r)
+{
+	const std::string &source = s.clients[m.fd].hostmask();
+	// ":<source> MODE <channel> ", the ':' of the last param and "\r\n"
+	size_t fixed = source.size() + channel.name.size() + 11;
+	Message line(source, m.fd, "MODE", channel.name, "");
+	size_t n_modes = 0, len = fixed;
+	char sign = '?';
+
+	for (size_t i = 0; i < changes.touched.size(); ++i)
 	{
-		if (!channel.modes.count('l'))
-			return ;
-		channel.modes.erase('l');
-	}
-	else
-	{
-		size_t newlimit = str_to_size(m.params[2]);
-		if (channel.modes.count('l') && channel.userlimit == newlimit)
-			return ;
-		channel.modes.insert('l');
-		channel.userlimit = newlimit;
+		const ModeTouch &t = changes.touched[i];
+		bool set = t.flag == 'o' ? channel.isOp(t.fd)
+			: channel.modes.count(t.flag);
+		std::string param;
+		if (t.flag == 'o')
+			param = s.clients[t.fd].nick;
+		else if (t.flag == 'l' && set)
+			param = size_to_str(channel.userlimit);
+		// a new key or limit is a change, the key itself is never sent
+		bool changed = set != t.was_set;
+		if (set && t.flag == 'k')
+			changed |= channel.key != changes.key;
+		if (set && t.flag == 'l')
+			changed |= channel.userlimit != changes.userlimit;
+		if (!changed)
+			continue;
+
+		size_t extra = 2 + (param.empty() ? 0 : param.size() + 1);
+		if (n_modes && len + extra > MAX_MSG_LEN)
+		{
+			channel.broadcast(line, r);
+			line.params.resize(2);
+			line.params[1].clear();
+			n_modes = 0;
+			len = fixed;
+			sign = '?';
+		}
+		if (sign != (set ? '+' : '-'))
+		{
+			sign = set ? '+' : '-';
+			line.params[1] += sign;
+		}
+		line.params[1] += t.flag;
+		if (!param.empty())
+			line.params.push_back(param);
+		++n_modes;
+		len += extra;
 	}
-	Message notification = m;
-	notification.source = s.clients[m.fd].hostmask();
-	Responses broadcast = notification.repeat(channel.client_ids);
-	r.insert(r.end(), broadcast.begin(), broadcast.end());
+	if (n_modes)
+		channel.broadcast(line, r);
 }
 
 static void channelModeHandler(const Message &m, State &s, Responses &r)
@@ -225,25 +239,33 @@ static void channelModeHandler(const Message &m, State &s, Responses &r)
 	Client &client = s.clients[m.fd];
 
 	const std::string &ch_name = m.params[0];
-	if (!s.channels.count(ch_name))
-		return r.push_back(Message(m.fd, ERR_NOSUCHCHANNEL, client,
-			ch_name, RED "No such channel" RESET));
-	Channel &channel = s.channels[ch_name];
+	Channel *found = s.channels.find(ch_name);
+	if (!found)
+		return r.push_back(numericReply(m.fd, REPLY_NOSUCHCHANNEL, client,
+			ch_name));
+	Channel &channel = *found;
 
 	if (m.params.size() == 1)
-		return channelQueryModeHandler(m, s, r);
+		return channelQueryModeHandler(m, channel, r);
 
-	if (!channel.op_ids.count(m.fd) && !client.isOp())
-		return r.push_back(Message(m.fd, ERR_CHANOPRIVSNEEDED, client,
-			ch_name, RED "You are not channel operator" RESET));
+	if (!channel.isOp(m.fd) && !client.isOp())
+		return r.push_back(numericReply(m.fd, REPLY_CHANOPRIVSNEEDED, client,
+			ch_name));
 
 	std::string modestring = m.params.at(1);
 	if (modestring == "b" || modestring == "I")
 		// guard for irssi sending unsupported mode queries
 		return;
 
+	// the flags are applied one by one, then broadcast together
+	// past MAX_MODES (ISUPPORT MODES) they are only sent back, in a 400,
+	// and their parameters are not read
+	ModeChanges changes(channel);
 	char plusminus = '?';
 	size_t flag_uses_param_index = 2;
+	size_t n_flags = 0;
+	std::string ignored;
+	char ignored_sign = '?';
 	for (size_t i = 0; i < modestring.size(); ++i)
 	{
 		char flag = modestring[i];
@@ -254,10 +276,18 @@ static void channelModeHandler(const Message &m, State &s, Responses &r)
 		}
 		if (plusminus == '?')
 			return errorUnknownFlag(m, s, r);
+		if (n_flags == MAX_MODES)
+		{
+			if (ignored_sign != plusminus)
+				ignored += (ignored_sign = plusminus);
+			ignored += flag;
+			continue;
+		}
+		++n_flags;
 		Message tmp(m.fd, "MODE", ch_name, std::string(1, plusminus) + flag);
 		if (flag == 'o' || (plusminus == '+' && (flag == 'k' || flag == 'l')))
 		{
-			if (m.params.size() < flag_uses_param_index)
+			if (m.params.size() <= flag_uses_param_index)
 			{
 				errorNeedMoreParams(tmp, s, r);
 				continue;
@@ -265,19 +295,25 @@ static void channelModeHandler(const Message &m, State &s, Responses &r)
 			tmp.params.push_back(m.params[flag_uses_param_index]);
 			flag_uses_param_index++;
 		}
+		if (flag == 'i' || flag == 't' || flag == 'k' || flag == 'l')
+			changes.touch(flag, -1, changes.modes.count(flag));
 		if (flag == 'i')
-			inviteFlagHandler(tmp, s, r);
+			inviteFlagHandler(tmp, channel);
 		else if (flag == 't')
-			topicFlagHandler(tmp, s, r);
+			topicFlagHandler(tmp, channel);
 		else if (flag == 'k')
-			keyFlagHandler(tmp, s, r);
+			keyFlagHandler(tmp, channel, s, r);
 		else if (flag == 'o')
-			opFlagHandler(tmp, s, r);
+			opFlagHandler(tmp, channel, s, r, changes);
 		else if (flag == 'l')
-			limitFlagHandler(tmp, s, r);
+			limitFlagHandler(tmp, channel);
 		else
 			errorUnknownFlag(tmp, s, r);
 	}
+	broadcastModes(m, channel, changes, s, r);
+	if (!ignored.empty())
+		r.push_back(numericReply(m.fd, REPLY_TOOMANYMODES, client, "MODE",
+			ignored));
 }
 
 void modeHandler(const Message &m, State &s, Responses &r)
@@ -299,9 +335,8 @@ void operHandler(const Message &m, State &s, Responses &r)
 	if (m.params.size() < 2)
 		return errorNeedMoreParams(m, s, r);
 	if (m.params.at(0) != s.oper_name || m.params.at(1) != s.oper_pass)
-		return r.push_back(Message(m.fd, ERR_PASSWDMISMATCH, client,
-								   RED "Oper name or password incorrect" RESET));
-	client.modes.insert('o');
-	r.push_back(Message(m.fd, RPL_YOUREOPER, client, "You are server operator"));
+		return r.push_back(numericReply(m.fd, REPLY_OPERMISMATCH, client));
+	s.setOper(m.fd, true);
+	r.push_back(numericReply(m.fd, REPLY_YOUREOPER, client));
 	r.push_back(Message(client.hostmask(), m.fd, "221", client, "+o"));
 }
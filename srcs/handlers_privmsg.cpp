@@ -1,95 +1,182 @@
 #include "colors.hpp"
 #include "handlers.hpp"
 #include "numerics.hpp"
+#include "replies.hpp"
 
-// PRIVMSG <target> :<message>
-void privmsgHandler(const Message &m, State &s, Responses &r)
-{	
-	// au moins 1 parametre
-	if (m.params.size() < 1)
-	return r.push_back(Message(m.fd, ERR_NORECIPIENT, s.clients[m.fd], RED "No recipient given PRIVMSG" RESET));
-	
-	// au moins 2 parametres (target + message)
-	if (m.params.size() < 2)
-	return r.push_back(Message(m.fd, ERR_NOTEXTTOSEND, s.clients[m.fd], RED "No text to send" RESET));
-	
-	std::string target = m.params[0];
-	std::string text = m.params[1];
-	
+// a target resolved once: a channel, or a nick (fd)
+struct Target
+{
+	const std::string	*name;
+	const Channel		*channel;
+	int					fd;
+};
+
+// false if the target does not exist, or the sender can't send there
+// errors go in r, only if replies (PRIVMSG, not NOTICE)
+static bool resolveTarget(const Message &m, const std::string &name,
+	State &s, Responses &r, bool replies, Target &target)
+{
+	target.name = &name;
+	target.channel = NULL;
+	target.fd = -1;
 	// SI target : channel
-	if (target[0] == '#')
+	if (!name.empty() && name[0] == '#')
 	{
-		if (s.channels.find(target) == s.channels.end())
-			return r.push_back(Message(m.fd, ERR_CANNOTSENDTOCHAN, s.clients[m.fd], target, RED "No such channel" RESET));
-		Channel &channel = s.channels[target];
-
-		if (channel.client_ids.find(m.fd) == channel.client_ids.end())
-			return r.push_back(Message(m.fd, ERR_CANNOTSENDTOCHAN, s.clients[m.fd], target, RED "Cannot send to channel" RESET));
-
-		// envoi a tous les membres SAUF a celui qui envoie
-		std::string source = s.clients[m.fd].hostmask();
-		for (std::set<int>::iterator it = channel.client_ids.begin();
-			 it != channel.client_ids.end(); ++it)
-		{
-			if (*it != m.fd)
-			{
-				Message msg(source, *it, "PRIVMSG", target, text);
-				r.push_back(msg);
-			}
-		}
+		target.channel = s.channels.find(name);
+		if (target.channel && target.channel->isMember(m.fd))
+			return true;
+		if (replies)
+			r.push_back(numericReply(m.fd, REPLY_CANNOTSENDTOCHAN, s.clients[m.fd], name));
+		return false;
 	}
 	// SI target : un nickname
-	else
-	{
-		int target_fd = s.findClientByNick(target);
-		if (target_fd == -1)
-			return r.push_back(Message(m.fd, ERR_NOSUCHNICK, s.clients[m.fd], target, RED "No such nick/channel" RESET));
+	target.fd = s.findClientByNick(name);
+	if (target.fd != -1)
+		return true;
+	if (replies)
+		r.push_back(numericReply(m.fd, REPLY_NOSUCHNICK, s.clients[m.fd], name));
+	return false;
+}
 
-		std::string source = s.clients[m.fd].hostmask();
-		Message msg(source, target_fd, "PRIVMSG", target, text);
-		r.push_back(msg);
+// resolves the whole target list before anything is sent,
+// a channel or a nick given twice is only sent to once
+static std::vector<Target> resolveTargets(const Message &m,
+	const std::vector<std::string> &names, size_t n_names, State &s,
+	Responses &r, bool replies)
+{
+	std::vector<Target> targets;
+	std::set<int> channel_ids, fds;
+	for (size_t i = 0; i < n_names; ++i)
+	{
+		Target target;
+		if (!resolveTarget(m, names[i], s, r, replies, target))
+			continue;
+		if (target.channel && !channel_ids.insert(target.channel->id).second)
+			continue;
+		if (!target.channel && !fds.insert(target.fd).second)
+			continue;
+		targets.push_back(target);
 	}
+	return targets;
 }
 
-void noticeHandler(const Message &m, State &s, Responses &r)
+static void sendText(Message &msg, const Target &target, int sender,
+	Responses &r)
 {
-	if (m.params.size() < 2)
+	msg.params[0] = *target.name;
+	// envoi a tous les membres SAUF a celui qui envoie
+	if (target.channel)
+		return target.channel->broadcast(msg, r, sender);
+	msg.fd = target.fd;
+	r.push_back(msg);
+}
+
+// NOTICE is not published: it never gets an answer
+static void publishText(const Message &m, const Target &target, State &s,
+	Responses &r)
+{
+	if (!s.events.wants(EVENT_PRIVMSG))
 		return;
+	Event sent = {EVENT_PRIVMSG, m.fd,
+		target.channel ? target.channel->id : -1, target.fd, &m};
+	s.events.publish(sent, s, r);
+}
 
-	std::string target = m.params[0];
-	std::string text = m.params[1];
+// PRIVMSG and NOTICE <target>{,<target>} :<message>
+// the relayed message is a scratch reused by every call, and a single
+// target (the usual case) skips the list: nothing is allocated
+static void relayText(const Message &m, State &s, Responses &r, bool replies)
+{
+	static Message msg(-1, "");
+	msg.source = s.clients[m.fd].hostmask();
+	msg.verb = m.verb;
+	msg.params.resize(2);
+	msg.params[1] = m.params[1];
+	msg.tags = m.clientTags();
 
-	// SI target : un channel
-	if (target[0] == '#')
+	if (m.params[0].find(',') == std::string::npos)
 	{
-		if (s.channels.find(target) == s.channels.end())
+		Target target;
+		if (!resolveTarget(m, m.params[0], s, r, replies, target))
 			return;
+		sendText(msg, target, m.fd, r);
+		if (replies)
+			publishText(m, target, s, r);
+		return;
+	}
 
-		Channel &channel = s.channels[target];
+	std::vector<std::string> names = split_targets(m.params[0]);
+	size_t n_names = names.size();
+	if (replies)
+		n_names = limit_targets(m.fd, s.clients[m.fd], names, MAX_MSG_TARGETS, r);
+	else if (n_names > MAX_MSG_TARGETS)
+		n_names = MAX_MSG_TARGETS;
+	std::vector<Target> targets = resolveTargets(m, names, n_names, s, r, replies);
+	for (size_t i = 0; i < targets.size(); ++i)
+		sendText(msg, targets[i], m.fd, r);
+	// once msg is no longer used, a subscriber may reply with a NOTICE
+	for (size_t i = 0; replies && i < targets.size(); ++i)
+		publishText(m, targets[i], s, r);
+}
 
-		if (channel.client_ids.find(m.fd) == channel.client_ids.end())
-			return;
+// PRIVMSG <target>{,<target>} :<message>
+void privmsgHandler(const Message &m, State &s, Responses &r)
+{
+	// au moins 1 parametre
+	if (m.params.size() < 1)
+		return r.push_back(numericReply(m.fd, REPLY_NORECIPIENT, s.clients[m.fd]));
+
+	// au moins 2 parametres (target + message)
+	if (m.params.size() < 2)
+		return r.push_back(numericReply(m.fd, REPLY_NOTEXTTOSEND, s.clients[m.fd]));
+
+	relayText(m, s, r, true);
+}
 
-		std::string source = s.clients[m.fd].hostmask();
-		for (std::set<int>::iterator it = channel.client_ids.begin();
-			 it != channel.client_ids.end(); ++it)
+// NOTICE never gets a reply, even an error
+void noticeHandler(const Message &m, State &s, Responses &r)
+{
+	if (m.params.size() < 2)
+		return;
+	relayText(m, s, r, false);
+}
+
+// TAGMSG <target>, a message with only client tags (ex: +typing)
+// only relayed to the clients that negotiated message-tags
+void tagmsgHandler(const Message &m, State &s, Responses &r)
+{
+	if (m.params.size() < 1)
+		return r.push_back(numericReply(m.fd, REPLY_NORECIPIENT, s.clients[m.fd]));
+
+	const std::string &target = m.params[0];
+	Message msg(s.clients[m.fd].hostmask(), m.fd, "TAGMSG", target);
+	msg.tags = m.clientTags();
+	if (msg.tags.empty())
+		return;
+
+	if (target[0] == '#')
+	{
+		const Channel *channel = s.channels.find(target);
+		if (!channel || !channel->isMember(m.fd))
+			return r.push_back(numericReply(m.fd, REPLY_CANNOTSENDTOCHAN, s.clients[m.fd], target));
+		for (Members::const_iterator it = channel->members.begin();
+			 it != channel->members.end(); ++it)
 		{
-			if (*it != m.fd)
+			if (it->fd != m.fd && (s.clients[it->fd].caps & CAP_MESSAGE_TAGS))
 			{
-				Message msg(source, *it, "NOTICE", target, text);
+				msg.fd = it->fd;
 				r.push_back(msg);
 			}
 		}
 	}
-	// SI target : un nickname
 	else
 	{
 		int target_fd = s.findClientByNick(target);
 		if (target_fd == -1)
+			return r.push_back(numericReply(m.fd, REPLY_NOSUCHNICK, s.clients[m.fd], target));
+		if (!(s.clients[target_fd].caps & CAP_MESSAGE_TAGS))
 			return;
-
-		std::string source = s.clients[m.fd].hostmask();
-		Message msg(source, target_fd, "NOTICE", target, text);
+		msg.fd = target_fd;
 		r.push_back(msg);
 	}
 }
@@ -1,12 +1,36 @@
 #include "colors.hpp"
 #include "handlers.hpp"
 #include "numerics.hpp"
+#include "replies.hpp"
+#include "verbs.hpp"
 
-void messageRouter(const Message &m, State &s, std::vector<Message> &r)
+struct Route
+{
+	const char			*verb;
+	message_handler_fn	*handler;
+};
+
+#define VERB_ROUTE(verb, handler) { verb, handler },
+
+static const Route g_routes[N_ROUTED_VERBS] = { ROUTED_VERBS(VERB_ROUTE) };
+
+// NULL for the verbs not routed
+static message_handler_fn *routeOf(const std::string &verb)
+{
+	for (size_t i = 0; i < N_ROUTED_VERBS; ++i)
+		if (verb == g_routes[i].verb)
+			return g_routes[i].handler;
+	return NULL;
+}
+
+void messageRouter(const Message &m, State &s, Responses &r)
 {
 	int id = m.fd;
 	Client &c = s.clients[id]; // IMPORTANT: this creates entry if it doesn't exist
 
+	if (m.too_long)
+		return r.push_back(numericReply(id, REPLY_INPUTTOOLONG, c));
+
 	if (m.verb == "CAP")
 		return capHandler(m, s, r);
 	if (m.verb == "PASS")
@@ -25,12 +49,12 @@ void messageRouter(const Message &m, State &s, std::vector<Message> &r)
 		else if (m.verb == "JOIN")
 			return ;
 		else
-			return r.push_back(Message(id, ERR_NOTREGISTERED, c, RED "You have not registered" RESET));
+			return r.push_back(numericReply(id, REPLY_NOTREGISTERED, c));
 		if (c.username.empty() || c.nick.empty())
 			return;
 		if (c.status != AUTHENTICATED)
 		{
-			r.push_back(Message(id, ERR_PASSWDMISMATCH, c, RED "Password incorrect" RESET));
+			r.push_back(numericReply(id, REPLY_PASSWDMISMATCH, c));
 			r.push_back(Message(id, "ERROR", "Closing Link: " + c.nick + " (Connection failed)"));
 			s.removeClient(m.fd);
 			return ;
@@ -38,34 +62,9 @@ void messageRouter(const Message &m, State &s, std::vector<Message> &r)
 		return welcomeHandler(m, s, r);
 	}
 
-	if (m.verb == "USER")
-		return userHandler(m, s, r);
-	if (m.verb == "NICK")
-		return nickHandler(m, s, r);
-	if (m.verb == "PART")
-		return partHandler(m, s, r);
-	if (m.verb == "JOIN")
-		return joinHandler(m, s, r);
-	if (m.verb == "PING")
-		return pingHandler(m, s, r);
-	if (m.verb == "KICK")
-		return kickHandler(m, s, r);
-	if (m.verb == "PRIVMSG")
-		return privmsgHandler(m, s, r);
-	if (m.verb == "NOTICE")
-		return noticeHandler(m, s, r);
-	if (m.verb == "MOTD")
-		return motdHandler(m, s, r);
-	if (m.verb == "MODE")
-		return modeHandler(m, s, r);
-	if (m.verb == "OPER")
-		return operHandler(m, s, r);
-	if (m.verb == "INVITE")
-		return inviteHandler(m, s, r);
-	if (m.verb == "TOPIC")
-		return topicHandler(m, s, r);
-	if (m.verb == "NAMES")
-		return namesHandler(m, s, r);
+	message_handler_fn *handler = routeOf(m.verb);
+	if (handler)
+		handler(m, s, r);
 }
 
 // a handler that does not route messages but simply repeats
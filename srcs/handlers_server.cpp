@@ -1,6 +1,59 @@
+#include <sstream>
+
 #include "colors.hpp"
 #include "handlers.hpp"
+#include "Logs.class.hpp"
 #include "numerics.hpp"
+#include "replies.hpp"
+
+static unsigned int capFromName(const std::string &name)
+{
+	if (name == "message-tags")
+		return CAP_MESSAGE_TAGS;
+	if (name == "server-time")
+		return CAP_SERVER_TIME;
+	if (name == COMPACT_CAP)
+		return CAP_COMPACT;
+	return 0;
+}
+
+static std::string capsToStr(unsigned int caps)
+{
+	std::string names;
+	if (caps & CAP_MESSAGE_TAGS)
+		names += "message-tags ";
+	if (caps & CAP_SERVER_TIME)
+		names += "server-time ";
+	if (caps & CAP_COMPACT)
+		names += COMPACT_CAP " ";
+	if (!names.empty())
+		names.erase(names.size() - 1);
+	return names;
+}
+
+// Example: CAP REQ :message-tags -server-time
+// all or nothing, one unknown capability and the whole request is NAK
+static void capReqHandler(const Message &m, Client &client, Responses &r)
+{
+	const std::string &requested = m.params.size() > 1 ? m.params[1] : "";
+	unsigned int enable = 0;
+	unsigned int disable = 0;
+	std::istringstream iss(requested);
+	std::string name;
+	while (iss >> name)
+	{
+		bool remove = name[0] == '-';
+		unsigned int cap = capFromName(remove ? name.substr(1) : name);
+		if (!cap)
+			return r.push_back(Message(SERVER_NAME, m.fd, "CAP", client, "NAK", requested));
+		if (remove)
+			disable |= cap;
+		else
+			enable |= cap;
+	}
+	client.caps = (client.caps | enable) & ~disable;
+	r.push_back(Message(SERVER_NAME, m.fd, "CAP", client, "ACK", requested));
+}
 
 // Example: CAP LS
 // Answers the client for a list of the server's capabilities
@@ -10,10 +63,14 @@ void capHandler(const Message &m, State &s, Responses &r)
 		return;
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "CAP", RED "Need more params" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "CAP"));
 	std::string arg = m.params.at(0);
 	if (arg == "LS")
-		return r.push_back(Message(m.fd, "CAP * LS :none"));
+		return r.push_back(Message(SERVER_NAME, m.fd, "CAP", client, "LS", SUPPORTED_CAPS));
+	if (arg == "LIST")
+		return r.push_back(Message(SERVER_NAME, m.fd, "CAP", client, "LIST", capsToStr(client.caps)));
+	if (arg == "REQ")
+		return capReqHandler(m, client, r);
 }
 
 // Example: PING localhost
@@ -24,7 +81,7 @@ void pingHandler(const Message &m, State &s, Responses &r)
 		return;
 	Client &client = s.clients[m.fd];
 	if (m.params.size() < 1)
-		return r.push_back(Message(m.fd, ERR_NEEDMOREPARAMS, client, "PING", RED "Need more params" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client, "PING"));
 	std::string token = m.params.at(0);
 	return r.push_back(Message(m.fd, "PONG", token));
 }
@@ -33,12 +90,8 @@ void motdHandler(const Message &m, State &s, Responses &r)
 {
 	Client &client = s.clients[m.fd];
 	if (s.motd.empty())
-	{
-		Message msg = Message(m.fd, ERR_NOMOTD, client, PURPLE "No message of the day" RESET);
-		r.push_back(msg);
-		return ;
-	}
-	r.push_back(Message(m.fd, RPL_MOTDSTART, client, PURPLE "- Message of the day -" RESET));
+		return r.push_back(numericReply(m.fd, REPLY_NOMOTD, client));
+	r.push_back(numericReply(m.fd, REPLY_MOTDSTART, client));
 
 	// Split MOTD by newlines, send each line as separate RPL_MOTD
 	std::string motd_copy = s.motd;
@@ -48,11 +101,182 @@ void motdHandler(const Message &m, State &s, Responses &r)
 	{
 		line = motd_copy.substr(0, pos);
 		if (!line.empty())
-			r.push_back(Message(m.fd, RPL_MOTD, client, line));
+			r.push_back(numericReply(m.fd, REPLY_MOTD, client, line));
 		motd_copy.erase(0, pos + 1);
 	}
 	if (!motd_copy.empty())
-		r.push_back(Message(m.fd, RPL_MOTD, client, motd_copy));
+		r.push_back(numericReply(m.fd, REPLY_MOTD, client, motd_copy));
+
+	r.push_back(numericReply(m.fd, REPLY_ENDOFMOTD, client));
+}
+
+// LUSERS, also sent in the welcome burst
+// the counts are kept up to date by State, nothing is scanned
+void lusersHandler(const Message &m, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+	std::string users = size_to_str(s.n_registered);
+	std::string max = size_to_str(s.max_registered);
+
+	r.push_back(numericReply(m.fd, REPLY_LUSERCLIENT, client,
+		"There are " + users + " users and 0 invisible on 1 servers"));
+	r.push_back(numericReply(m.fd, REPLY_LUSEROP, client,
+		size_to_str(s.n_opers)));
+	r.push_back(numericReply(m.fd, REPLY_LUSERUNKNOWN, client,
+		size_to_str(s.unregistered())));
+	r.push_back(numericReply(m.fd, REPLY_LUSERCHANNELS, client,
+		size_to_str(s.channels.size())));
+	r.push_back(numericReply(m.fd, REPLY_LUSERME, client,
+		"I have " + users + " clients and 0 servers"));
+	r.push_back(numericReply(m.fd, REPLY_LOCALUSERS, client, users, max,
+		"Current local users " + users + ", max " + max));
+	r.push_back(numericReply(m.fd, REPLY_GLOBALUSERS, client, users, max,
+		"Current global users " + users + ", max " + max));
+}
+
+static bool isNumber(const std::string &str)
+{
+	return !str.empty() && str.size() < 10
+		&& str.find_first_not_of("0123456789") == std::string::npos;
+}
+
+static void logNotice(const Message &m, const Client &client,
+	const std::string &text, Responses &r)
+{
+	r.push_back(Message(SERVER_NAME, m.fd, "NOTICE", client, text));
+}
+
+// Example: "buffer: full, 1 in 10, first 256 bytes"
+static void logConfigNotices(const Message &m, const Client &client,
+	Responses &r)
+{
+	for (int i = 0; i < LOG_CAT_COUNT; ++i)
+	{
+		e_log_category category = static_cast<e_log_category>(i);
+		const LogConfig &config = logConfig(category);
+		std::string text = std::string(logCategoryName(category)) + ": "
+			+ logLevelName(config.level);
+		if (config.level == LOG_LEVEL_FULL && config.sample > 1)
+			text += ", 1 in " + size_to_str(config.sample);
+		if (config.level == LOG_LEVEL_FULL && config.max_bytes)
+			text += ", first " + size_to_str(config.max_bytes) + " bytes";
+		logNotice(m, client, text, r);
+	}
+	if (quietLogs())
+		logNotice(m, client, "quiet: errors only until the next SIGUSR1", r);
+}
+
+// LOGLEVEL [<category|*> <off|short|full> [<1 in N> [<first K bytes>]]]
+// operators only, without parameters the current levels are listed
+void logLevelHandler(const Message &m, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+	if (!client.isOp())
+		return r.push_back(numericReply(m.fd, REPLY_NOPRIVILEGES, client));
+	if (m.params.empty())
+		return logConfigNotices(m, client, r);
+	if (m.params.size() < 2)
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client,
+			m.verb));
+
+	const std::string &name = m.params[0];
+	e_log_category category = logCategoryByName(name);
+	if (name != "*" && category == LOG_CAT_COUNT)
+		return logNotice(m, client, "LOGLEVEL: unknown category " + name, r);
+	LogConfig config = {logLevelByName(m.params[1]), 1, 0};
+	if (config.level == static_cast<e_log_level>(-1))
+		return logNotice(m, client, "LOGLEVEL: unknown level " + m.params[1], r);
+	for (size_t i = 2; i < m.params.size() && i < 4; ++i)
+		if (!isNumber(m.params[i]))
+			return logNotice(m, client, "LOGLEVEL: not a number " + m.params[i], r);
+	if (m.params.size() > 2)
+		config.sample = str_to_size(m.params[2]);
+	if (m.params.size() > 3)
+		config.max_bytes = str_to_size(m.params[3]);
+
+	for (int i = 0; i < LOG_CAT_COUNT; ++i)
+		if (name == "*" || i == category)
+			setLogConfig(static_cast<e_log_category>(i), config);
+	logConfigNotices(m, client, r);
+}
+
+// Example: 1234567 ns gives "1234.57us"
+static std::string usecToStr(uint64_t nsec)
+{
+	std::string cents = size_to_str(nsec / 10 % 100);
+	return size_to_str(nsec / 1000) + (cents.size() < 2 ? ".0" : ".")
+		+ cents + "us";
+}
+
+static std::string latencyToStr(const LatencyHistogram &latency)
+{
+	return "p50 " + usecToStr(latency.percentile(0.5))
+		+ " p99 " + usecToStr(latency.percentile(0.99))
+		+ " max " + usecToStr(latency.max());
+}
+
+// <verb> <count> <bytes> <remote count> :<latency>, the verbs used only
+static void statsCommands(const Message &m, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+	for (size_t i = 0; i < STATS_N_VERBS; ++i)
+	{
+		const VerbStats &verb = s.stats.verb(i);
+		if (!verb.latency.count())
+			continue;
+		r.push_back(numericReply(m.fd, REPLY_STATSCOMMANDS, client, verb.verb,
+			size_to_str(verb.latency.count()), size_to_str(verb.bytes)));
+		r.back().params.push_back("0");
+		r.back().params.push_back(latencyToStr(verb.latency));
+	}
+}
+
+// Example: "Server Up 0 days 1:02:03"
+static void statsUptime(const Message &m, State &s, Responses &r)
+{
+	time_t up = time(0) - s.start_time;
+	std::string minutes = size_to_str(up / 60 % 60);
+	std::string seconds = size_to_str(up % 60);
+	r.push_back(numericReply(m.fd, REPLY_STATSUPTIME, s.clients[m.fd],
+		"Server Up " + size_to_str(up / 86400) + " days "
+		+ size_to_str(up / 3600 % 24) + (minutes.size() < 2 ? ":0" : ":")
+		+ minutes + (seconds.size() < 2 ? ":0" : ":") + seconds));
+}
 
-	r.push_back(Message(m.fd, RPL_ENDOFMOTD, client, PURPLE "- End of /MOTD -" RESET));
+// the poll() loop: how often it wakes, for how many fds, how late
+static void statsEventLoop(const Message &m, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+	const ServerStats &stats = s.stats;
+	size_t busy = stats.busyWakeups();
+	size_t ready_x100 = busy ? stats.readyFds() * 100 / busy : 0;
+	std::string cents = size_to_str(ready_x100 % 100);
+
+	r.push_back(numericReply(m.fd, REPLY_STATSDEBUG, client,
+		"event loop: " + size_to_str(stats.iterations()) + " iterations, "
+		+ size_to_str(busy) + " with ready fds"));
+	r.push_back(numericReply(m.fd, REPLY_STATSDEBUG, client,
+		"ready fds per wakeup: " + size_to_str(ready_x100 / 100)
+		+ (cents.size() < 2 ? ".0" : ".") + cents + " avg, "
+		+ size_to_str(stats.maxReady()) + " max"));
+	r.push_back(numericReply(m.fd, REPLY_STATSDEBUG, client,
+		"loop lag: " + latencyToStr(stats.loopLag())));
+}
+
+// STATS <m|u|e>: commands, uptime, event loop
+// any other letter only gets the end of the report
+void statsHandler(const Message &m, State &s, Responses &r)
+{
+	Client &client = s.clients[m.fd];
+	if (m.params.empty())
+		return r.push_back(numericReply(m.fd, REPLY_NEEDMOREPARAMS, client,
+			m.verb));
+	const std::string &query = m.params[0];
+	if (query == "m")
+		statsCommands(m, s, r);
+	else if (query == "u")
+		statsUptime(m, s, r);
+	else if (query == "e")
+		statsEventLoop(m, s, r);
+	r.push_back(numericReply(m.fd, REPLY_ENDOFSTATS, client, query));
 }
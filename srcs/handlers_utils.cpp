@@ -1,5 +1,8 @@
 #include <sstream>
 
+#include "handlers.hpp"
+#include "replies.hpp"
+
 // returns 0
 size_t str_to_size(const std::string &str)
 {
@@ -16,4 +19,28 @@ std::string size_to_str(size_t size)
 	std::ostringstream str;
 	str << size;
 	return str.str();
-}
\ No newline at end of file
+}
+
+std::vector<std::string> split_targets(const std::string &list)
+{
+	std::vector<std::string> targets;
+	size_t start = 0;
+	size_t comma;
+	while ((comma = list.find(',', start)) != std::string::npos)
+	{
+		targets.push_back(list.substr(start, comma - start));
+		start = comma + 1;
+	}
+	targets.push_back(list.substr(start));
+	return targets;
+}
+
+// the first max targets are processed, the first extra one is reported
+size_t limit_targets(int fd, const Client &client,
+	const std::vector<std::string> &targets, size_t max, Responses &r)
+{
+	if (targets.size() <= max)
+		return targets.size();
+	r.push_back(numericReply(fd, REPLY_TOOMANYTARGETS, client, targets[max]));
+	return max;
+}
@@ -4,23 +4,21 @@
 
 #include <fcntl.h>   // fcntl()
 #include <poll.h>	// poll()
-#include <unistd.h> // write()
+#include <unistd.h>  // STDOUT_FILENO
 
 #include "colors.hpp"
 #include "dictionary.hpp"
 #include "Connection.class.hpp"
 #include "handlers.hpp"
+#include "replies.hpp"
 #include "utils.hpp"
 
-volatile sig_atomic_t g_stop = false;
-
 // --- Helper Functions Declaration ---
 int tests(); // tests.cpp
 
 static int			usage();
 static int			strToPort(const std::string &str);
 static std::string	getMOTD(int argc, char **argv);
-static void			handleSignal(int _);
 
 // --- Main File Functions ---
 int main(int argc, char **argv)
@@ -28,6 +26,23 @@ int main(int argc, char **argv)
 	if (argc == 2 && std::string("--test") == argv[1])
 		return tests();
 
+	// optional last arguments: plain replies for every client,
+	// a capture of the traffic for ircreplay, a metrics endpoint
+	bool compact = false;
+	std::string capture, metrics;
+	while (argc > 3 && std::string(argv[argc - 1]).compare(0, 2, "--") == 0)
+	{
+		std::string option = argv[--argc];
+		if (option == "--compact")
+			compact = true;
+		else if (option.compare(0, 10, "--capture=") == 0)
+			capture = option.substr(10);
+		else if (option.compare(0, 10, "--metrics=") == 0)
+			metrics = option.substr(10);
+		else
+			return usage();
+	}
+
 	if (argc != 3 && argc != 4)
 		return usage();
 
@@ -40,21 +55,34 @@ int main(int argc, char **argv)
 		return (error("password can't be empty."));
 
 	std::signal(SIGINT, handleSignal);
+	std::signal(SIGUSR1, handleLogSignal);
 	// std::signal(SIGQUIT, handleSignal);
 	// std::signal(SIGTERM, handleSignal);
 
 	// Prepare application state
-	State state = State();
+	State state;
 	state.password = password;
 	state.motd = getMOTD(argc, argv);
 	state.start_time = time(0);
 	state.oper_name = OPER_NAME;
 	state.oper_pass = OPER_PASS;
-	state.clients[BOT_ID] = createBotClient();
+	state.addClient(BOT_ID, createBotClient());
+	state.setNick(BOT_ID, BOT_NICK);
+	botSubscribe(state);
+
+	// Render the numeric replies once
+	initReplies(compact);
 
 	// Setup message routing
 	Connection connection(state,
-			password == "--test" ? parrot : botRouter);
+			password == "--test" ? parrot : messageRouter);
+
+	connection.addService(botWakeFd(), botDrain);
+
+	if (!capture.empty() && connection.startCapture(capture) == ERROR)
+		return (NOK);
+	if (!metrics.empty() && connection.startMetrics(metrics) == ERROR)
+		return (NOK);
 
 	// Setup the listening socket
 	int	listen_s_fd = initListeningSocket(port);
@@ -63,25 +91,24 @@ int main(int argc, char **argv)
 
 	displayBanner(port, state);
 
+	// From now on the logs are written by their own thread
+	if (startLogWriter(STDOUT_FILENO) == ERROR)
+		error("the logs will be written synchronously");
+
 	// Start the poll() loop
-	if (connection.pollLoop(listen_s_fd) == ERROR)
+	int status = connection.pollLoop(listen_s_fd);
+	botStop();
+	stopLogWriter();
+	if (status == ERROR)
 		return (NOK);
 
 	return (OK);
 }
 
-bool isStopped()
-{
-	if (!g_stop)
-		return false;
-	std::cout << "\r  \r" REVERSED " stopping signal received " RESET << std::endl;
-	return true;
-}
-
 // --- Helper Functions ---
 static int usage()
 {
-	std::cout << "Usage: ./ircserv <port> <password> [MOTD]" << std::endl;
+	std::cout << "Usage: ./ircserv <port> <password> [MOTD] [--compact] [--capture=<file>] [--metrics=<port|/path>]" << std::endl;
 	return (OK);
 }
 
@@ -118,12 +145,3 @@ static std::string	getMOTD(int argc, char **argv)
 	else
 		return (argv[3]);
 }
-
-static void handleSignal(int _)
-{
-	(void)_;
-	g_stop = true;
-
-	const char msg[] = "\r  \r" REVERSED " stopping signal received " RESET;
-	write(1, msg, sizeof(msg) - 1);
-}
@@ -0,0 +1,197 @@
+#include <algorithm> // std::sort()
+#include <cstdlib>   // strtod()
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <poll.h>   // poll()
+#include <unistd.h> // usleep()
+
+#include "Capture.class.hpp"
+#include "Connection.class.hpp"
+#include "handlers.hpp"
+#include "replies.hpp"
+
+// Replays a capture (ircserv ... --capture=<file>) through the same
+// Connection, messageRouter and State as the server, without sockets.
+//
+//   make replay
+//   ./ircreplay <capture> <password>          at the recorded pace
+//   ./ircreplay <capture> <password> 4        4 times faster
+//   ./ircreplay <capture> <password> max      no pause at all
+//
+// Reports the throughput and, per verb, the time spent in messageRouter.
+// What the server sends is discarded, the bot's answers included.
+
+struct VerbTimes
+{
+	std::string				verb;
+	std::vector<uint32_t>	nsec;
+
+	bool operator<(const VerbTimes &other) const
+	{
+		return nsec.size() > other.nsec.size();
+	}
+};
+
+static std::map<std::string, VerbTimes> g_verbs;
+
+// messageRouter, timed
+static void timedRouter(const Message &m, State &s, Responses &r)
+{
+	uint64_t start = monotonicNsec();
+	messageRouter(m, s, r);
+	uint64_t elapsed = monotonicNsec() - start;
+	VerbTimes &stats = g_verbs[m.verb];
+	stats.nsec.push_back(elapsed > 0xffffffffu ? 0xffffffffu : elapsed);
+}
+
+static void prepareState(State &s, const std::string &password)
+{
+	s.password = password;
+	s.start_time = time(0);
+	s.oper_name = OPER_NAME;
+	s.oper_pass = OPER_PASS;
+	s.addClient(BOT_ID, createBotClient());
+	s.setNick(BOT_ID, BOT_NICK);
+	botSubscribe(s);
+}
+
+// the bot's replies, if any, as the server's service would send them
+static void drainBot(State &s)
+{
+	static Responses ignored;
+	struct pollfd pfd = {botWakeFd(), POLLIN, 0};
+	if (poll(&pfd, 1, 0) <= 0)
+		return;
+	ignored.clear();
+	botDrain(s, ignored);
+}
+
+static double percentile(const std::vector<uint32_t> &sorted, double p)
+{
+	return sorted[(size_t)(p * (sorted.size() - 1))] / 1e3;
+}
+
+static void reportVerbs(std::ostream &report)
+{
+	std::vector<VerbTimes> verbs;
+	for (std::map<std::string, VerbTimes>::iterator it = g_verbs.begin();
+		it != g_verbs.end(); ++it)
+	{
+		verbs.push_back(it->second);
+		verbs.back().verb = it->first;
+	}
+	std::sort(verbs.begin(), verbs.end());
+	report << std::fixed << std::setprecision(2);
+	for (size_t i = 0; i < verbs.size(); ++i)
+	{
+		std::vector<uint32_t> &nsec = verbs[i].nsec;
+		std::sort(nsec.begin(), nsec.end());
+		double total = 0;
+		for (size_t j = 0; j < nsec.size(); ++j)
+			total += nsec[j];
+		report << "  " << std::left << std::setw(10)
+			<< (verbs[i].verb.empty() ? "(empty)" : verbs[i].verb)
+			<< std::right << std::setw(9) << nsec.size() << " msgs, mean "
+			<< total / nsec.size() / 1e3 << " us, p50 " << percentile(nsec, 0.5)
+			<< " us, p99 " << percentile(nsec, 0.99) << " us, max "
+			<< nsec.back() / 1e3 << " us" << std::endl;
+	}
+}
+
+static int usage()
+{
+	std::cout << "Usage: ./ircreplay <capture> <password> [max | <speed>]"
+		<< std::endl;
+	return (NOK);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3 && argc != 4)
+		return usage();
+	double speed = 1; // 0: as fast as possible
+	if (argc == 4)
+		speed = std::string("max") == argv[3] ? 0 : strtod(argv[3], NULL);
+	if (argc == 4 && speed <= 0 && std::string("max") != argv[3])
+		return usage();
+
+	std::ifstream in(argv[1], std::ios::binary);
+	if (!in || !readCaptureHeader(in))
+		return (error(std::string(argv[1]) + ": not a capture"), NOK);
+
+	// keep the report, the connection logs go nowhere
+	std::ostream report(std::cout.rdbuf());
+	std::cout.rdbuf(NULL);
+	initReplies();
+	State state;
+	prepareState(state, argv[2]);
+	Connection connection(state, timedRouter);
+
+	CaptureEntry entry;
+	std::string data;
+	std::set<int> open;
+	size_t entries = 0, connections = 0, bytes = 0, lost = 0;
+	uint64_t start = monotonicNsec() / 1000;
+	while (readCaptureEntry(in, entry, data))
+	{
+		// what follows does not match what the clients sent
+		if (entry.type == CAPTURE_DROPPED)
+		{
+			lost = entry.fd;
+			break;
+		}
+		++entries;
+		if (speed > 0) // the recorded pace, scaled
+		{
+			uint64_t due = start + entry.usec / speed;
+			uint64_t now = monotonicNsec() / 1000;
+			if (due > now)
+				usleep(due - now);
+		}
+		if (entry.type == CAPTURE_ACCEPT)
+		{
+			++connections;
+			open.insert(entry.fd);
+		}
+		else if (entry.type == CAPTURE_DATA)
+		{
+			bytes += data.size();
+			if (connection.feed(entry.fd, data.data(), data.size()) == NOK)
+				entry.type = CAPTURE_CLOSE; // over the limit, as receiveData
+		}
+		if (entry.type == CAPTURE_CLOSE)
+		{
+			connection.hangUp(entry.fd);
+			open.erase(entry.fd);
+		}
+		for (std::set<int>::iterator it = open.begin(); it != open.end(); ++it)
+			connection.pendingOutput(*it).clear();
+		drainBot(state);
+	}
+	double seconds = (monotonicNsec() / 1000 - start) / 1e6;
+
+	size_t messages = 0;
+	for (std::map<std::string, VerbTimes>::iterator it = g_verbs.begin();
+		it != g_verbs.end(); ++it)
+		messages += it->second.nsec.size();
+	report << argv[1] << ": " << entries << " entries, " << connections
+		<< " connections, " << bytes << " bytes in "
+		<< std::fixed << std::setprecision(3) << seconds << " s";
+	if (speed > 0)
+		report << " at x" << std::setprecision(2) << speed << std::endl;
+	else
+		report << " at max speed" << std::endl;
+	report << "  " << std::setprecision(0) << messages / (seconds ? seconds : 1)
+		<< " msgs/s, " << std::setprecision(2)
+		<< bytes / (seconds ? seconds : 1) / 1e6 << " MB/s" << std::endl;
+	reportVerbs(report);
+	if (lost)
+		return (error("replay stopped: " + size_to_str(lost)
+			+ " entries were lost while capturing"), NOK);
+	return (in.eof() ? OK : (error("capture cut short"), NOK));
+}
@@ -0,0 +1,178 @@
+#include "replies.hpp"
+#include "colors.hpp"
+#include "dictionary.hpp"
+#include "numerics.hpp"
+
+#define MAX_FIXED_PARAMS 6
+
+#define STRINGIFY(x) #x
+#define TO_STR(x) STRINGIFY(x)
+
+// the definition of a reply, before rendering
+// color wraps all the fixed params, the last one being the text
+struct ReplySource
+{
+	e_reply		id;
+	const char	*numeric;
+	const char	*color;
+	const char	*params[MAX_FIXED_PARAMS];
+};
+
+static const ReplySource g_sources[] = {
+	{REPLY_WELCOME, RPL_WELCOME, RED, {"Welcome!", 0}},
+	{REPLY_YOURHOST, RPL_YOURHOST, ORANGE, {"Your host is 0.0.0.0, running " SERVER_NAME, 0}},
+	{REPLY_CREATED, RPL_CREATED, YELLOW, {0}},
+	{REPLY_MYINFO, RPL_MYINFO, GREEN, {SERVER_NAME, SERVER_VERSION, "o", "it", "klo", 0}},
+	{REPLY_ISUPPORT, RPL_ISUPPORT, TEAL, {"CASEMAPPING=rfc1459", "MODES=" TO_STR(MAX_MODES),
+		"TARGMAX=JOIN:" TO_STR(MAX_JOIN_TARGETS) ",PART:" TO_STR(MAX_PART_TARGETS)
+		",PRIVMSG:" TO_STR(MAX_MSG_TARGETS) ",NOTICE:" TO_STR(MAX_MSG_TARGETS),
+		"are supported by this server", 0}},
+	{REPLY_UMODEIS, RPL_UMODEIS, "", {0}},
+	{REPLY_LUSERCLIENT, RPL_LUSERCLIENT, "", {0}},
+	{REPLY_LUSEROP, RPL_LUSEROP, "", {"operator(s) online", 0}},
+	{REPLY_LUSERUNKNOWN, RPL_LUSERUNKNOWN, "", {"unknown connection(s)", 0}},
+	{REPLY_LUSERCHANNELS, RPL_LUSERCHANNELS, "", {"channels formed", 0}},
+	{REPLY_LUSERME, RPL_LUSERME, "", {0}},
+	{REPLY_LOCALUSERS, RPL_LOCALUSERS, "", {0}},
+	{REPLY_GLOBALUSERS, RPL_GLOBALUSERS, "", {0}},
+	{REPLY_STATSCOMMANDS, RPL_STATSCOMMANDS, "", {0}},
+	{REPLY_STATSUPTIME, RPL_STATSUPTIME, "", {0}},
+	{REPLY_STATSDEBUG, RPL_STATSDEBUG, "", {0}},
+	{REPLY_ENDOFSTATS, RPL_ENDOFSTATS, "", {"End of /STATS report", 0}},
+	{REPLY_NOTOPIC, RPL_NOTOPIC, "", {"No topic is set", 0}},
+	{REPLY_TOPIC, RPL_TOPIC, "", {0}},
+	{REPLY_INVITING, RPL_INVITING, "", {0}},
+	{REPLY_NAMREPLY, RPL_NAMREPLY, "", {0}},
+	{REPLY_ENDOFNAMES, RPL_ENDOFNAMES, "", {"End of /names reply", 0}},
+	{REPLY_MOTD, RPL_MOTD, "", {0}},
+	{REPLY_MOTDSTART, RPL_MOTDSTART, PURPLE, {"- Message of the day -", 0}},
+	{REPLY_ENDOFMOTD, RPL_ENDOFMOTD, PURPLE, {"- End of /MOTD -", 0}},
+	{REPLY_YOUREOPER, RPL_YOUREOPER, "", {"You are server operator", 0}},
+	{REPLY_NOSUCHNICK, ERR_NOSUCHNICK, RED, {"No such nick/channel", 0}},
+	{REPLY_NOSUCHCHANNEL, ERR_NOSUCHCHANNEL, RED, {"No such channel", 0}},
+	{REPLY_TOOMANYTARGETS, ERR_TOOMANYTARGETS, RED, {"Too many targets", 0}},
+	{REPLY_CANNOTSENDTOCHAN, ERR_CANNOTSENDTOCHAN, RED, {"Cannot send to channel", 0}},
+	{REPLY_NORECIPIENT, ERR_NORECIPIENT, RED, {"No recipient given PRIVMSG", 0}},
+	{REPLY_NOTEXTTOSEND, ERR_NOTEXTTOSEND, RED, {"No text to send", 0}},
+	{REPLY_NOMOTD, ERR_NOMOTD, PURPLE, {"No message of the day", 0}},
+	{REPLY_NONICKNAMEGIVEN, ERR_NONICKNAMEGIVEN, RED, {"No nick given", 0}},
+	{REPLY_ERRONEUSNICKNAME, ERR_ERRONEUSNICKNAME, RED, {"Erroneus nick", 0}},
+	{REPLY_NICKNAMEINUSE, ERR_NICKNAMEINUSE, RED, {"Nick in use", 0}},
+	{REPLY_USERNOTINCHANNEL, ERR_USERNOTINCHANNEL, RED, {"They aren't on that channel", 0}},
+	{REPLY_NOTONCHANNEL, ERR_NOTONCHANNEL, RED, {"You're not on that channel", 0}},
+	{REPLY_INPUTTOOLONG, ERR_INPUTTOOLONG, RED, {"Input line was too long", 0}},
+	{REPLY_USERONCHANNEL, ERR_USERONCHANNEL, RED, {"is already on channel", 0}},
+	{REPLY_NOTREGISTERED, ERR_NOTREGISTERED, RED, {"You have not registered", 0}},
+	{REPLY_NEEDMOREPARAMS, ERR_NEEDMOREPARAMS, RED, {"Not enough parameters", 0}},
+	{REPLY_EMPTYKEY, ERR_NEEDMOREPARAMS, RED, {"Key cannot be empty", 0}},
+	{REPLY_ALREADYREGISTERED, ERR_ALREADYREGISTERED, RED, {"Already registered", 0}},
+	{REPLY_PASSWDMISMATCH, ERR_PASSWDMISMATCH, RED, {"Password incorrect", 0}},
+	{REPLY_OPERMISMATCH, ERR_PASSWDMISMATCH, RED, {"Oper name or password incorrect", 0}},
+	{REPLY_CHANNELISFULL, ERR_CHANNELISFULL, RED, {"Cannot join channel (+l)", 0}},
+	{REPLY_INVITEONLYCHAN, ERR_INVITEONLYCHAN, RED, {"Cannot join channel (+i)", 0}},
+	{REPLY_BADCHANNELKEY, ERR_BADCHANNELKEY, RED, {"Cannot join channel (+k)", 0}},
+	{REPLY_NOPRIVILEGES, ERR_NOPRIVILEGES, RED, {"Permission denied - You're not an IRC op", 0}},
+	{REPLY_CHANOPRIVSNEEDED, ERR_CHANOPRIVSNEEDED, RED, {"You're not channel operator", 0}},
+	{REPLY_TOPICPROTECTED, ERR_CHANOPRIVSNEEDED, RED, {"You're not channel operator. Mode is +t", 0}},
+	{REPLY_UMODEUNKNOWNFLAG, ERR_UMODEUNKNOWNFLAG, RED, {"Unknown MODE flag", 0}},
+	{REPLY_USERSDONTMATCH, ERR_USERSDONTMATCH, RED, {"Cant change mode for other users", 0}},
+	{REPLY_INVALIDKEY, ERR_INVALIDKEY, RED, {"Invalid key", 0}},
+	{REPLY_TOOMANYMODES, ERR_UNKNOWNERROR, RED, {"Too many modes, these were ignored", 0}},
+};
+
+// both renderings are kept, choosing one costs nothing per message
+static std::vector<ReplyTemplate> g_replies[2]; // colored, plain
+static bool g_compact = false;
+
+static ReplyTemplate renderReply(const ReplySource &src, bool plain)
+{
+	ReplyTemplate reply;
+	reply.source = SERVER_NAME;
+	reply.numeric = src.numeric;
+	reply.saved = 0;
+	for (size_t i = 0; i < MAX_FIXED_PARAMS && src.params[i]; ++i)
+		reply.params.push_back(src.params[i]);
+	if (!*src.color)
+		return reply;
+	if (plain)
+	{
+		reply.saved = std::string(src.color).size() + std::string(RESET).size();
+		return reply;
+	}
+	reply.color = src.color;
+	reply.reset = RESET;
+	if (!reply.params.empty())
+	{
+		reply.params.front() = reply.color + reply.params.front();
+		reply.params.back() += reply.reset;
+	}
+	return reply;
+}
+
+void initReplies(bool compact)
+{
+	g_compact = compact;
+	if (!g_replies[0].empty())
+		return;
+	size_t n_sources = sizeof(g_sources) / sizeof(g_sources[0]);
+	for (int plain = 0; plain < 2; ++plain)
+	{
+		g_replies[plain].resize(REPLY_COUNT);
+		for (size_t i = 0; i < n_sources; ++i)
+			g_replies[plain][g_sources[i].id] = renderReply(g_sources[i], plain);
+	}
+}
+
+const ReplyTemplate &replyTemplate(e_reply id, bool plain)
+{
+	if (g_replies[0].empty())
+		initReplies(g_compact);
+	return g_replies[plain][id];
+}
+
+const ReplyTemplate &replyTemplate(e_reply id, const Client &client)
+{
+	return replyTemplate(id, g_compact || (client.caps & CAP_COMPACT));
+}
+
+// appends the fixed params (text) after the variable ones
+// and what the plain rendering saves, counted once the reply is queued
+static Message &finishReply(Message &reply, const ReplyTemplate &t)
+{
+	reply.params.insert(reply.params.end(), t.params.begin(), t.params.end());
+	reply.saved = t.saved;
+	return reply;
+}
+
+Message numericReply(int fd, e_reply id, const Client &client)
+{
+	const ReplyTemplate &t = replyTemplate(id, client);
+	Message reply(t.source, fd, t.numeric, client);
+	return finishReply(reply, t);
+}
+
+Message numericReply(int fd, e_reply id, const Client &client,
+	const std::string &param)
+{
+	const ReplyTemplate &t = replyTemplate(id, client);
+	Message reply(t.source, fd, t.numeric, client, param);
+	return finishReply(reply, t);
+}
+
+Message numericReply(int fd, e_reply id, const Client &client,
+	const std::string &param1, const std::string &param2)
+{
+	const ReplyTemplate &t = replyTemplate(id, client);
+	Message reply(t.source, fd, t.numeric, client, param1, param2);
+	return finishReply(reply, t);
+}
+
+Message numericReply(int fd, e_reply id, const Client &client,
+	const std::string &param1, const std::string &param2,
+	const std::string &param3)
+{
+	const ReplyTemplate &t = replyTemplate(id, client);
+	Message reply(t.source, fd, t.numeric, client, param1, param2);
+	reply.params.push_back(param3);
+	return finishReply(reply, t);
+}
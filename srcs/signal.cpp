@@ -0,0 +1,36 @@
+#include <csignal>
+
+#include <unistd.h> // write()
+
+#include "colors.hpp"
+#include "utils.hpp"
+
+volatile sig_atomic_t g_stop = false;
+volatile sig_atomic_t g_quiet_logs = false;
+
+// the handler already said it
+bool isStopped()
+{
+	return g_stop;
+}
+
+void handleSignal(int _)
+{
+	(void)_;
+	g_stop = true;
+
+	const char msg[] = "\r  \r" REVERSED " stopping signal received " RESET;
+	write(1, msg, sizeof(msg) - 1);
+}
+
+bool quietLogs()
+{
+	return g_quiet_logs;
+}
+
+// SIGUSR1: only the errors are logged, until the next one
+void handleLogSignal(int _)
+{
+	(void)_;
+	g_quiet_logs = !g_quiet_logs;
+}
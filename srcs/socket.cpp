@@ -1,8 +1,12 @@
 #include <cerrno>       // errno
+#include <cstdlib>      // strtol()
+#include <cstring>      // memset(), strncpy()
 #include <fcntl.h>      // fcntl(), F_GETFL, F_SETFL, O_NONBLOCK
 #include <netinet/in.h> // sockaddr_in, INADDR_ANY, htons(), htonl()
 #include <sys/socket.h> // socket(), setsockopt(), bind(), listen()
-#include <unistd.h>     // close()
+#include <sys/stat.h>   // lstat(), S_ISSOCK, umask()
+#include <sys/un.h>     // sockaddr_un
+#include <unistd.h>     // close(), unlink()
 
 #include "dictionary.hpp" // OK, ERROR, L_QUEUE
 #include "utils.hpp"      // spe_error()
@@ -57,3 +61,95 @@ int	initListeningSocket(int port)
 
 	return (s_fd);
 }
+
+// the address of initLocalSocket(): a port on 127.0.0.1 or a path
+static int	localAddress(const std::string &address, sockaddr_storage &addr,
+	socklen_t &len)
+{
+	memset(&addr, 0, sizeof(addr));
+	if (!address.empty() && address[0] == '/')
+	{
+		sockaddr_un *un = (sockaddr_un *)&addr;
+		if (address.size() >= sizeof(un->sun_path))
+			return (error("socket path too long"), ERROR);
+		un->sun_family = AF_UNIX;
+		strncpy(un->sun_path, address.c_str(), sizeof(un->sun_path) - 1);
+		len = sizeof(*un);
+		return (OK);
+	}
+	char *end;
+	long port = strtol(address.c_str(), &end, 10);
+	if (address.empty() || *end || port < 1 || port > 65535)
+		return (error("invalid port " + address), ERROR);
+	sockaddr_in *in = (sockaddr_in *)&addr;
+	in->sin_family = AF_INET;
+	in->sin_addr.s_addr = htonl(INADDR_LOOPBACK); // never reachable from outside
+	in->sin_port = htons(port);
+	len = sizeof(*in);
+	return (OK);
+}
+
+// only a socket left by a previous run is removed, never another file
+static int	removeOldSocket(const std::string &path)
+{
+	struct stat	st;
+
+	if (lstat(path.c_str(), &st) == ERROR)
+	{
+		if (errno != ENOENT)
+			return (spe_error(path.c_str()), ERROR);
+		errno = 0;
+		return (OK);
+	}
+	if (!S_ISSOCK(st.st_mode))
+		return (error(path + " exists and is not a socket"), ERROR);
+	if (unlink(path.c_str()) == ERROR)
+		return (spe_error(path.c_str()), ERROR);
+	return (OK);
+}
+
+int	initLocalSocket(const std::string &address)
+{
+	sockaddr_storage	addr;
+	socklen_t			len;
+	int					s_fd;
+
+	if (localAddress(address, addr, len) == ERROR)
+		return (ERROR);
+	if (addr.ss_family == AF_UNIX && removeOldSocket(address) == ERROR)
+		return (ERROR);
+
+	s_fd = socket(addr.ss_family, SOCK_STREAM, 0);
+	if (s_fd == ERROR)
+		return (spe_error("socket"), ERROR);
+
+	int	opt = 1;
+	if (addr.ss_family != AF_UNIX
+		&& setsockopt(s_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == ERROR)
+		return (close(s_fd), spe_error("setsockopt"), ERROR);
+
+	if (setNonBlocking(s_fd) == ERROR)
+		return (close(s_fd), spe_error("fcntl"), ERROR);
+
+	// the socket file is created by bind(), for its owner only (0600)
+	mode_t	old_mask = umask(0177);
+	int		bound = bind(s_fd, (struct sockaddr*)&addr, len);
+	umask(old_mask);
+	if (bound == ERROR)
+		return (close(s_fd), spe_error("bind"), ERROR);
+
+	if (listen(s_fd, L_QUEUE) == ERROR)
+		return (close(s_fd), spe_error("listen"), ERROR);
+
+	return (s_fd);
+}
+
+int	acceptNonBlocking(int listen_s_fd)
+{
+	int s_fd = accept(listen_s_fd, NULL, NULL);
+	if (s_fd == ERROR)
+		return (ERROR);
+	if (setNonBlocking(s_fd) == ERROR)
+		return (close(s_fd), spe_error("fcntl"), ERROR);
+	return (s_fd);
+}
@@ -4,6 +4,7 @@ int test_exit_code = 0;
 std::string test_name;
 
 void tests_parsing();
+void tests_tags();
 void tests_auth();
 void tests_part();
 void tests_join();
@@ -12,10 +13,18 @@ void tests_motd();
 void tests_privmsg();
 void tests_oper();
 void tests_channel_modes();
+void tests_replies();
+void tests_cap();
+void tests_lusers();
+void tests_stats();
+void tests_metrics();
+void tests_casemap();
+void tests_logs();
 
 int tests()
 {
 	tests_parsing();
+	tests_tags();
 	tests_auth();
 	tests_part();
 	tests_join();
@@ -24,5 +33,12 @@ int tests()
 	tests_privmsg();
 	tests_oper();
 	tests_channel_modes();
+	tests_replies();
+	tests_cap();
+	tests_lusers();
+	tests_stats();
+	tests_metrics();
+	tests_casemap();
+	tests_logs();
 	return test_exit_code;
 }
\ No newline at end of file
@@ -21,7 +21,7 @@ void tests_auth()
 	{ // after PASS/USER/NICK, already registered
 		State s;
 		s.password = "good";
-		s.clients[42].status = WELCOMED;
+		s.welcome(42);
 		Responses r;
 		passHandler(Message(42, "PASS good"), s, r);
 		assert(WELCOMED == s.clients[42].status);
@@ -32,7 +32,7 @@ void tests_auth()
 	{ // same on wrong password
 		State s;
 		s.password = "good";
-		s.clients[42].status = WELCOMED;
+		s.welcome(42);
 		Responses r;
 		passHandler(Message(42, "PASS bad"), s, r);
 		assert(WELCOMED == s.clients[42].status);
@@ -78,15 +78,15 @@ void tests_auth()
 	}
 	{ // nick after welcome
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "oldnick";
+		s.welcome(42);
+		s.setNick(42, "oldnick");
 		Responses r;
 		nickHandler(Message(42, "NICK newnick"), s, r);
 		assert_eq("newnick", s.clients[42].nick);
 	}
 	{ // nick in use before welcome
 		State s;
-		s.clients[1].nick = "samenick";
+		s.setNick(1, "samenick");
 		s.clients[42].status = AUTHENTICATED;
 		Responses r;
 		nickHandler(Message(42, "NICK samenick"), s, r);
@@ -98,9 +98,9 @@ void tests_auth()
 	}
 	{ // nick in use after welcome
 		State s;
-		s.clients[1].nick = "samenick";
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "oldnick";
+		s.setNick(1, "samenick");
+		s.welcome(42);
+		s.setNick(42, "oldnick");
 		Responses r;
 		nickHandler(Message(42, "NICK samenick"), s, r);
 		assert_eq("oldnick", s.clients[42].nick);
@@ -109,6 +109,34 @@ void tests_auth()
 		assert(3 == r.at(0).params.size());
 		assert_eq("samenick", r.at(0).params.at(1));
 	}
+	{ // nicks are case-insensitive (RFC 1459 casemapping)
+		State s;
+		s.setNick(1, "Same[Nick]");
+		s.clients[42].status = AUTHENTICATED;
+		Responses r;
+		nickHandler(Message(42, "NICK sAME{nICK}"), s, r);
+		assert_eq("", s.clients[42].nick);
+		assert_eq("433", r.at(0).verb); // ERR_NICKNAMEINUSE (433)
+		assert_eq(1, s.findClientByNick("same{nick}"));
+	}
+	{ // a client can change the case of its own nick
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		Responses r;
+		nickHandler(Message(42, "NICK Alice"), s, r);
+		assert_eq("Alice", s.clients[42].nick);
+		assert_eq(42, s.findClientByNick("ALICE"));
+	}
+	{ // the old nick is free again
+		State s;
+		s.welcome(42);
+		s.setNick(42, "oldnick");
+		Responses r;
+		nickHandler(Message(42, "NICK newnick"), s, r);
+		assert_eq(-1, s.findClientByNick("oldnick"));
+		assert_eq(42, s.findClientByNick("newnick"));
+	}
 	{ // nick starting with `:`
 		State s;
 		Responses r;
@@ -167,6 +195,19 @@ void tests_auth()
 		nickHandler(Message(42, "NICK " + nick), s, r);
 		assert_eq(nick, s.clients[42].nick);
 	}
+	{ // cached hostmask follows NICK and USER changes
+		State s;
+		s.clients[42].status = AUTHENTICATED;
+		Responses r;
+		assert_eq("*", s.clients[42].hostmask());
+		nickHandler(Message(42, "NICK first"), s, r);
+		userHandler(Message(42, "USER user 0 * :real"), s, r);
+		assert_eq("first!~user@0.0.0.0", s.clients[42].hostmask());
+		nickHandler(Message(42, "NICK second"), s, r);
+		assert_eq("second!~user@0.0.0.0", s.clients[42].hostmask());
+		const std::string &name = s.clients[42];
+		assert_eq("second", name);
+	}
 	{ // starting with number not allowed
 		State s;
 		Responses r;
@@ -199,8 +240,8 @@ void tests_auth()
 	}
 	{ // not change after welcome
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].username = "~olduser";
+		s.welcome(42);
+		s.clients[42].setUsername("~olduser");
 		s.clients[42].realname = "oldreal";
 		Responses r;
 		Message m(42, "USER username 0 * realname");
@@ -275,7 +316,7 @@ void tests_auth()
 		Responses r;
 		State s;
 		s.clients[42].status = AUTHENTICATED;
-		s.clients[42].nick = "ric";
+		s.setNick(42, "ric");
 		quitHandler(Message(42, "QUIT :rage quit"), s, r);
 		assert(s.clients.empty());
 		assert(r.empty() || r[0].fd == 42);
@@ -291,14 +332,31 @@ void tests_auth()
 	{ // removes client registered from state and channels
 		Responses r;
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
-		s.channels["pingpong"].client_ids.insert(42);
-		s.channels["pingpong"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "ric");
+		s.addMember(42, "pingpong");
+		s.channels["pingpong"].setFlag(42, MEMBER_OP, true);
 		quitHandler(Message(42, "QUIT :rage quit"), s, r);
 		assert(s.clients.empty());
-		assert(s.channels["pingpong"].client_ids.count(42) == 0);
-		assert(s.channels["pingpong"].op_ids.count(42) == 0);
+		assert_eq(-1, s.findClientByNick("ric"));
+		assert(s.channels["pingpong"].isMember(42) == 0);
+		assert(s.channels["pingpong"].isOp(42) == 0);
+	}
+	{ // a reference taken before QUIT does not resolve to the next client
+		Responses r;
+		State s;
+		s.welcome(42);
+		s.welcome(BOT_ID);
+		s.setNick(42, "ric");
+		ClientRef before = s.clients.ref(42);
+		assert(s.clients.find(before) == &s.clients[42]);
+		quitHandler(Message(42, "QUIT :rage quit"), s, r);
+		assert(s.clients.find(42) == NULL);
+		s.clients[42].status = CONNECTED; // fd reused
+		assert(s.clients.find(before) == NULL);
+		assert(s.clients.find(s.clients.ref(42)) == &s.clients[42]);
+		assert_eq("", s.clients[42].nick);
+		assert(s.clients.size() == 2 && s.clients.count(BOT_ID) == 1);
 	}
 	TEST_PRINT;
 
@@ -307,8 +365,8 @@ void tests_auth()
 		Responses r;
 		State s;
 		s.password = "goodpass";
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "oldnick";
+		s.welcome(42);
+		s.setNick(42, "oldnick");
 		Message m(42, "NICK newnick");
 		messageRouter(m, s, r);
 		assert_eq("newnick", s.clients[42].nick);
@@ -317,8 +375,8 @@ void tests_auth()
 		Responses r;
 		State s;
 		s.password = "goodpass";
-		s.clients[42].status = WELCOMED;
-		s.clients[42].username = "~oldname";
+		s.welcome(42);
+		s.clients[42].setUsername("~oldname");
 		Message m(42, "USER newname 0 * rlname");
 		messageRouter(m, s, r);
 		assert_eq("~oldname", s.clients[42].username);
@@ -344,12 +402,12 @@ void tests_auth()
 	}
 	{ // NICK broadcasts change to channels
 		State s;
-		s.clients[4].nick = "john";
-		s.clients[4].status = WELCOMED;
-		s.clients[2].nick = "anon";
-		s.clients[2].status = WELCOMED;
-		s.channels["team"].client_ids.insert(4);
-		s.channels["team"].client_ids.insert(2);
+		s.setNick(4, "john");
+		s.welcome(4);
+		s.setNick(2, "anon");
+		s.welcome(2);
+		s.addMember(4, "team");
+		s.addMember(2, "team");
 		Responses r;
 		messageRouter(Message(2, "NICK tom"), s, r);
 		const Message *m;
@@ -368,12 +426,12 @@ void tests_auth()
 	}
 	{ // QUIT broadcasts change to channels
 		State s;
-		s.clients[4].nick = "john";
-		s.clients[4].status = WELCOMED;
-		s.clients[2].nick = "ric";
-		s.clients[2].status = WELCOMED;
-		s.channels["pingpong"].client_ids.insert(4);
-		s.channels["pingpong"].client_ids.insert(2);
+		s.setNick(4, "john");
+		s.welcome(4);
+		s.setNick(2, "ric");
+		s.welcome(2);
+		s.addMember(4, "pingpong");
+		s.addMember(2, "pingpong");
 		Responses r;
 		messageRouter(Message(2, "QUIT :rage quit"), s, r);
 		const Message *m;
@@ -393,7 +451,7 @@ void tests_auth()
 		Responses r;
 		State s;
 		s.clients[42].status = AUTHENTICATED;
-		s.clients[42].nick = "tom";
+		s.setNick(42, "tom");
 		messageRouter(Message(42, "USER tom 0 * :tom"), s, r);
 		assert(r.size() >= 5);
 		assert_eq("001", r.at(0).verb);
@@ -406,7 +464,7 @@ void tests_auth()
 		Responses r;
 		State s;
 		s.clients[42].status = AUTHENTICATED;
-		s.clients[42].username = "john";
+		s.clients[42].setUsername("john");
 		s.clients[42].realname = "john";
 		messageRouter(Message(42, "NICK john"), s, r);
 		assert(r.size() >= 5);
@@ -437,7 +495,7 @@ void tests_auth()
 		Responses r;
 		State s;
 		s.clients[42].status = AUTHENTICATED;
-		s.clients[42].username = "john";
+		s.clients[42].setUsername("john");
 		s.clients[42].realname = "john";
 		messageRouter(Message(42, "NICK john"), s, r);
 		bool has_motd = false;
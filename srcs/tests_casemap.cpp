@@ -0,0 +1,44 @@
+#include "tests.hpp"
+#include "CaseMap.class.hpp"
+
+void tests_casemap()
+{
+	TEST("Case-folded index")
+	{ // RFC 1459 casemapping
+		assert_eq('a', CaseMap::fold('A'));
+		assert_eq('{', CaseMap::fold('['));
+		assert_eq('|', CaseMap::fold('\\'));
+		assert_eq('}', CaseMap::fold(']'));
+		assert_eq('~', CaseMap::fold('^'));
+		assert_eq('_', CaseMap::fold('_'));
+		assert(CaseMap::equal("Nick[away]", "nICK{AWAY}"));
+		assert(!CaseMap::equal("nick", "nick_"));
+	}
+	{ // insert, find, replace, erase
+		CaseMap map;
+		assert_eq(-1, map.find("alice"));
+		map.insert("Alice", 42);
+		assert_eq(42, map.find("ALICE"));
+		map.insert("alice", 43);
+		assert_eq(43, map.find("Alice"));
+		assert_eq(1u, map.size());
+		map.erase("aLiCe");
+		assert_eq(-1, map.find("alice"));
+		assert_eq(0u, map.size());
+	}
+	{ // grows and survives many erased slots
+		CaseMap map;
+		for (int i = 0; i < 1000; ++i)
+		{
+			std::ostringstream oss;
+			oss << "Nick" << i;
+			map.insert(oss.str(), i);
+			if (i % 2)
+				map.erase(oss.str());
+		}
+		assert_eq(500u, map.size());
+		assert_eq(998, map.find("NICK998"));
+		assert_eq(-1, map.find("nick999"));
+	}
+	TEST_PRINT;
+}
@@ -7,29 +7,29 @@ void tests_channel_modes()
 	{
 		{ // can join with -i
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN", "#test"), s, r);
 			messageRouter(Message(1, "MODE", "#test", "-kil"), s, r);
 			messageRouter(Message(2, "JOIN", "#test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 2);
+			assert(s.channels["#test"].size() == 2);
 		}
 		{ // cannot join without invite
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN", "#test"), s, r);
 			messageRouter(Message(1, "MODE", "#test", "-kl+i"), s, r);
 			messageRouter(Message(2, "JOIN", "#test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 1);
+			assert(s.channels["#test"].size() == 1);
 			const Message *m = find_by_fd(r, 2);
 			assert(m);
 			assert_eq("473", m->verb); // ERR_INVITEONLYCHAN (473)
@@ -37,24 +37,24 @@ void tests_channel_modes()
 		}
 		{ // can join with invite
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN #test"), s, r);
 			messageRouter(Message(1, "MODE #test -kl+i"), s, r);
 			messageRouter(Message(1, "INVITE ric #test"), s, r);
 			messageRouter(Message(2, "JOIN #test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 2);
+			assert(s.channels["#test"].size() == 2);
 		}
 		{ // can join after nick change
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN #test"), s, r);
 			messageRouter(Message(1, "MODE #test -kl+i"), s, r);
@@ -62,31 +62,31 @@ void tests_channel_modes()
 			messageRouter(Message(2, "NICK ric"), s, r);
 			messageRouter(Message(2, "JOIN #test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 2);
+			assert(s.channels["#test"].size() == 2);
 		}
 		{ // cannot join after reconnecting with same fd
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN #test"), s, r);
 			messageRouter(Message(1, "MODE #test -kl+i"), s, r);
 			messageRouter(Message(1, "INVITE ric #test"), s, r);
 			messageRouter(Message(2, "QUIT"), s, r);
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(2, "ric");
+			s.welcome(2);
 			messageRouter(Message(2, "JOIN #test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 1);
+			assert(s.channels["#test"].size() == 1);
 		}
 		{ // cannot use invite twice
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN #test"), s, r);
 			messageRouter(Message(1, "MODE #test -kl+i"), s, r);
@@ -95,14 +95,14 @@ void tests_channel_modes()
 			messageRouter(Message(2, "PART #test"), s, r);
 			messageRouter(Message(2, "JOIN #test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 1);
+			assert(s.channels["#test"].size() == 1);
 		}
 		{ // cannot join after being kicked
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN #test"), s, r);
 			messageRouter(Message(1, "MODE #test -kl+i"), s, r);
@@ -111,7 +111,7 @@ void tests_channel_modes()
 			messageRouter(Message(1, "KICK #test ric"), s, r);
 			messageRouter(Message(2, "JOIN #test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 1);
+			assert(s.channels["#test"].size() == 1);
 		}
 	}
 	TEST_PRINT
@@ -120,8 +120,8 @@ void tests_channel_modes()
 	{
 		{ // query no topic
 			State s;
-			s.clients[42].nick = "ric";
-			s.clients[42].status = WELCOMED;
+			s.setNick(42, "ric");
+			s.welcome(42);
 			Responses r;
 			messageRouter(Message(42, "JOIN #test"), s, r);
 			messageRouter(Message(42, "TOPIC #test"), s, r);
@@ -131,8 +131,8 @@ void tests_channel_modes()
 		}
 		{ // query topic
 			State s;
-			s.clients[42].nick = "ric";
-			s.clients[42].status = WELCOMED;
+			s.setNick(42, "ric");
+			s.welcome(42);
 			Responses r;
 			messageRouter(Message(42, "JOIN #test"), s, r);
 			messageRouter(Message(42, "TOPIC #test :the topic"), s, r);
@@ -144,8 +144,8 @@ void tests_channel_modes()
 		}
 		{ // mode +t allows op to change topic
 			State s;
-			s.clients[42].nick = "john";
-			s.clients[42].status = WELCOMED;
+			s.setNick(42, "john");
+			s.welcome(42);
 			Responses r;
 			messageRouter(Message(42, "JOIN #test"), s, r);
 			messageRouter(Message(42, "MODE #test +t"), s, r);
@@ -158,10 +158,10 @@ void tests_channel_modes()
 		}
 		{ // mode +t blocks normal user from changing topic
 			State s;
-			s.clients[42].nick = "john";
-			s.clients[42].status = WELCOMED;
-			s.clients[11].nick = "hacker";
-			s.clients[11].status = WELCOMED;
+			s.setNick(42, "john");
+			s.welcome(42);
+			s.setNick(11, "hacker");
+			s.welcome(11);
 			Responses r;
 			messageRouter(Message(42, "JOIN #test"), s, r);
 			messageRouter(Message(42, "MODE #test +t"), s, r);
@@ -183,10 +183,10 @@ void tests_channel_modes()
 		// Assert: Le mode +k est activé et la clé est stockée
 		{
 			State s;
-			s.clients[42].status = WELCOMED;
-			s.clients[42].nick = "chanop";
-			s.channels["#test"].client_ids.insert(42);
-			s.channels["#test"].op_ids.insert(42);
+			s.welcome(42);
+			s.setNick(42, "chanop");
+			s.addMember(42, "#test");
+			s.channels["#test"].setFlag(42, MEMBER_OP, true);
 			Responses r;
 
 			modeHandler(Message(42, "MODE #test +k secret"), s, r);
@@ -198,12 +198,12 @@ void tests_channel_modes()
 		// Assert: JOIN refusé avec ERR_BADCHANNELKEY (475)
 		{
 			State s;
-			s.clients[42].status = WELCOMED;
-			s.clients[42].nick = "chanop";
-			s.clients[99].status = WELCOMED;
-			s.clients[99].nick = "user";
-			s.channels["#test"].client_ids.insert(42);
-			s.channels["#test"].op_ids.insert(42);
+			s.welcome(42);
+			s.setNick(42, "chanop");
+			s.welcome(99);
+			s.setNick(99, "user");
+			s.addMember(42, "#test");
+			s.channels["#test"].setFlag(42, MEMBER_OP, true);
 			s.channels["#test"].modes.insert('k');
 			s.channels["#test"].key = "secret";
 			Responses r;
@@ -212,34 +212,34 @@ void tests_channel_modes()
 
 			assert(r.size() > 0);
 			assert_eq("475", r[0].verb);
-			assert(s.channels["#test"].client_ids.count(99) == 0);
+			assert(s.channels["#test"].isMember(99) == 0);
 		}
 		// Action: User JOIN avec le bon mot de passe
 		// Assert: JOIN réussit
 		{
 			State s;
-			s.clients[42].status = WELCOMED;
-			s.clients[42].nick = "chanop";
-			s.clients[99].status = WELCOMED;
-			s.clients[99].nick = "user";
-			s.channels["#test"].client_ids.insert(42);
-			s.channels["#test"].op_ids.insert(42);
+			s.welcome(42);
+			s.setNick(42, "chanop");
+			s.welcome(99);
+			s.setNick(99, "user");
+			s.addMember(42, "#test");
+			s.channels["#test"].setFlag(42, MEMBER_OP, true);
 			s.channels["#test"].modes.insert('k');
 			s.channels["#test"].key = "secret";
 			Responses r;
 
 			joinHandler(Message(99, "JOIN #test secret"), s, r);
 
-			assert(s.channels["#test"].client_ids.count(99) == 1);
+			assert(s.channels["#test"].isMember(99) == 1);
 		}
 		// Action: Channel op enlève le mode +k avec MODE -k
 		// Assert: Mode +k désactivé et clé effacée
 		{
 			State s;
-			s.clients[42].status = WELCOMED;
-			s.clients[42].nick = "chanop";
-			s.channels["#test"].client_ids.insert(42);
-			s.channels["#test"].op_ids.insert(42);
+			s.welcome(42);
+			s.setNick(42, "chanop");
+			s.addMember(42, "#test");
+			s.channels["#test"].setFlag(42, MEMBER_OP, true);
 			s.channels["#test"].modes.insert('k');
 			s.channels["#test"].key = "secret";
 			Responses r;
@@ -249,6 +249,22 @@ void tests_channel_modes()
 			assert(s.channels["#test"].modes.count('k') == 0);
 			assert(s.channels["#test"].key.empty());
 		}
+		// Action: Channel op envoie MODE +k sans mot de passe
+		// Assert: ERR_NEEDMOREPARAMS (461), pas de lecture hors limites
+		{
+			State s;
+			s.welcome(42);
+			s.setNick(42, "chanop");
+			s.addMember(42, "#test");
+			s.channels["#test"].setFlag(42, MEMBER_OP, true);
+			Responses r;
+
+			modeHandler(Message(42, "MODE #test +k"), s, r);
+
+			assert(r.size() == 1);
+			assert_eq("461", r[0].verb);
+			assert(s.channels["#test"].modes.count('k') == 0);
+		}
 	}
 	TEST_PRINT
 
@@ -256,8 +272,8 @@ void tests_channel_modes()
 	{
 		{ // no limit by default
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
 			Responses r;
 			messageRouter(Message(1, "JOIN", "#test"), s, r);
 			assert(s.channels.count("#test"));
@@ -265,42 +281,42 @@ void tests_channel_modes()
 		}
 		{ // can join if no limit
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN", "#test"), s, r);
 			messageRouter(Message(1, "MODE", "#test", "-lk"), s, r);
 			messageRouter(Message(2, "JOIN", "#test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 2);
+			assert(s.channels["#test"].size() == 2);
 		}
 		{ // can join big limit
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN", "#test"), s, r);
 			messageRouter(Message(1, "MODE", "#test", "+l-k", "2"), s, r);
 			messageRouter(Message(2, "JOIN", "#test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 2);
+			assert(s.channels["#test"].size() == 2);
 		}
 		{ // cannot join limit reached
 			State s;
-			s.clients[1].nick = "tom";
-			s.clients[1].status = WELCOMED;
-			s.clients[2].nick = "ric";
-			s.clients[2].status = WELCOMED;
+			s.setNick(1, "tom");
+			s.welcome(1);
+			s.setNick(2, "ric");
+			s.welcome(2);
 			Responses r;
 			messageRouter(Message(1, "JOIN", "#test"), s, r);
 			messageRouter(Message(1, "MODE", "#test", "+l-k", "1"), s, r);
 			messageRouter(Message(2, "JOIN", "#test"), s, r);
 			assert(s.channels.count("#test"));
-			assert(s.channels["#test"].client_ids.size() == 1);
+			assert(s.channels["#test"].size() == 1);
 			const Message *m = find_by_fd(r, 2);
 			assert(m);
 			assert_eq("471", m->verb); // ERR_CHANNELISFULL (471)
@@ -308,4 +324,120 @@ void tests_channel_modes()
 	}
 	TEST_PRINT
 
+	TEST("Channel mode flags limit")
+	{ // only the first MAX_MODES flags are applied
+		State s;
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.addMember(42, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
+		Responses r;
+
+		std::string modestring = "+";
+		for (size_t i = 0; i < 200; ++i)
+			modestring += (i % 2) ? "-i" : "+i";
+		modeHandler(Message(42, "MODE #test " + modestring), s, r);
+
+		assert(r.size() <= MAX_MODES);
+		assert_eq("400", r.back().verb); // ERR_UNKNOWNERROR
+	}
+	{ // the flags past MAX_MODES are sent back, not applied
+		State s;
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(42, "#c", MEMBER_OP);
+		s.addMember(43, "#c");
+		Responses r;
+		modeHandler(Message(42, "MODE #c +itklo-t key 5 bob"), s, r);
+		assert(!s.channels["#c"].isOp(43));
+		assert(s.channels["#c"].modes.count('l'));
+		assert_eq("400", r.back().verb);
+		assert_eq(42, r.back().fd);
+		assert_eq("MODE", r.back().params[1]);
+		assert_eq("+o-t", r.back().params[2]);
+	}
+	TEST_PRINT
+
+	TEST("Channel mode coalesced broadcast")
+	{
+		State s;
+		s.welcome(1);
+		s.setNick(1, "tom");
+		s.welcome(2);
+		s.setNick(2, "ric");
+		s.addMember(1, "#test", MEMBER_OP);
+		s.addMember(2, "#test");
+		s.channels["#test"].modes.clear();
+		{ // one line for all the flags, sent once to each member
+			Responses r;
+			modeHandler(Message(1, "MODE #test +it-t+o ric"), s, r);
+			assert_eq(2u, r.size());
+			assert_eq(1, r[0].fd);
+			assert_eq(2, r[1].fd);
+			assert_eq(":tom!@0.0.0.0 MODE #test +io :ric\r\n", r[1].assemble());
+		}
+		{ // nothing changed, nothing sent
+			Responses r;
+			modeHandler(Message(1, "MODE #test -i+i+o ric"), s, r);
+			assert(r.empty());
+		}
+		{ // the last limit wins, the key is not revealed
+			Responses r;
+			modeHandler(Message(1, "MODE #test +lkl 5 secret 7"), s, r);
+			assert_eq(2u, r.size());
+			assert_eq("+lk", r[0].params[1]);
+			assert_eq("7", r[0].params[2]);
+			assert_eq(3u, r[0].params.size());
+			assert_eq(7u, s.channels["#test"].userlimit);
+			assert_eq("secret", s.channels["#test"].key);
+		}
+		{ // errors are still replied, the rest is applied
+			Responses r;
+			modeHandler(Message(1, "MODE #test -l+x+o nobody"), s, r);
+			assert_eq(4u, r.size());
+			assert_eq("501", r[0].verb); // ERR_UMODEUNKNOWNFLAG
+			assert_eq("441", r[1].verb); // ERR_USERNOTINCHANNEL
+			assert_eq("-l", r[2].params[1]);
+		}
+	}
+	TEST_PRINT
+
+	TEST("Mode bitmask")
+	{
+		ModeMask modes;
+		assert(modes.empty());
+		assert_eq("+", modes.render());
+		modes.insert('t');
+		modes.insert('i');
+		modes.insert('#'); // not a mode letter
+		assert_eq("+it", modes.render());
+		assert(modes.has(MODE_INVITE | MODE_KEY));
+		assert(!modes.has(MODE_KEY));
+		modes.erase('i');
+		assert(modes.count('i') == 0 && modes.count('t') == 1);
+		assert(ModeMask::parse("+klo").bits()
+			== (MODE_KEY | MODE_LIMIT | MODE_OPER));
+		assert(ModeMask::parse(modes.render()).bits() == modes.bits());
+	}
+	TEST_PRINT
+
+	TEST("Channel mode query")
+	{ // RPL_CHANNELMODEIS lists the flags in order, the limit as a param
+		State s;
+		s.welcome(1);
+		s.setNick(1, "tom");
+		Responses r;
+		messageRouter(Message(1, "JOIN", "#test"), s, r);
+		messageRouter(Message(1, "MODE", "#test", "+tl", "5"), s, r);
+		r.clear();
+		messageRouter(Message(1, "MODE", "#test"), s, r);
+		assert(r.size() == 1);
+		assert_eq("324", r[0].verb); // RPL_CHANNELMODEIS (324)
+		assert_eq("+lt", r[0].params[1]);
+		assert_eq("5", r[0].params[2]);
+	}
+	TEST_PRINT
+
 }
@@ -1,3 +1,5 @@
+#include <algorithm> // std::count()
+
 #include "tests.hpp"
 #include "handlers.hpp"
 
@@ -8,27 +10,27 @@ void tests_join()
 	TEST("JOIN handler")
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "JOIN #test");
 		Responses r;
 
 		joinHandler(m, s, r);
 
-		assert(s.channels.find("#test") != s.channels.end());
+		assert(s.channels.count("#test"));
 	}
 	// Action: User rejoint un channel avec un nom invalide (sans #)
 	// Assert: Channel pas créé + réponse d'erreur
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "JOIN test");
 		Responses r;
 
 		joinHandler(m, s, r);
 
-		assert(s.channels.find("test") == s.channels.end());
+		assert(!s.channels.count("test"));
 		assert(r.size() > 0);
 		assert_eq("403", r[0].verb);
 	}
@@ -36,60 +38,60 @@ void tests_join()
 	// Assert: User ajouté à la liste des clients du channel
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "JOIN #test");
 		Responses r;
 
 		joinHandler(m, s, r);
 
-		assert(s.channels["#test"].client_ids.count(42) == 1);
-		assert(s.channels["#test"].client_ids.size() == 1);
-		assert(s.channels["#test"].op_ids.count(42) == 1);
-		assert(s.channels["#test"].op_ids.size() == 1);
+		assert(s.channels["#test"].isMember(42) == 1);
+		assert(s.channels["#test"].size() == 1);
+		assert(s.channels["#test"].isOp(42) == 1);
+		assert(s.channels["#test"].countFlag(MEMBER_OP) == 1);
 	}
 	// Action: Deuxième user rejoint un channel existant
 	// Assert: Les deux users sont dans la liste des clients
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(42, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Message m(43, "JOIN #test");
 		Responses r;
 
 		joinHandler(m, s, r);
 
-		assert(s.channels["#test"].client_ids.count(43) == 1);
-		assert(s.channels["#test"].client_ids.size() == 2);
-		assert(s.channels["#test"].op_ids.count(43) == 0);
-		assert(s.channels["#test"].op_ids.size() == 1);
+		assert(s.channels["#test"].isMember(43) == 1);
+		assert(s.channels["#test"].size() == 2);
+		assert(s.channels["#test"].isOp(43) == 0);
+		assert(s.channels["#test"].countFlag(MEMBER_OP) == 1);
 	}
 	// Action: User rejoint un channel où il est déjà
 	// Assert: Pas de duplication dans la liste des clients
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.addMember(42, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Message m(42, "JOIN #test");
 		Responses r;
 
 		joinHandler(m, s, r);
 
-		assert(s.channels["#test"].client_ids.size() == 1);
-		assert(s.channels["#test"].op_ids.size() == 1);
+		assert(s.channels["#test"].size() == 1);
+		assert(s.channels["#test"].countFlag(MEMBER_OP) == 1);
 		assert(r.size() == 1);
 		assert_eq("443", r.at(0).verb); // ERR_USERONCHANNEL (443)
 	}
 	{ // JOIN replies JOIN, TOPIC and NAMES
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "JOIN #test");
 		Responses r;
 
@@ -100,4 +102,196 @@ void tests_join()
 		assert_eq("366", r.back().verb); //RPL_ENDOFNAMES (366)
 	}
 	TEST_PRINT;
-}
\ No newline at end of file
+
+	TEST("JOIN multiple channels")
+	{ // keys by position, a repeated channel is joined once
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		Responses r;
+		joinHandler(Message(42, "JOIN #a,#b"), s, r);
+		modeHandler(Message(42, "MODE #b +k secret"), s, r);
+		r.clear();
+		joinHandler(Message(43, "JOIN #a,#b,#A,bad wrong,secret"), s, r);
+		assert(s.channels["#a"].isMember(43));
+		assert(s.channels["#b"].isMember(43));
+		assert_eq(2u, s.clients[43].channels.size());
+		size_t joins = 0;
+		for (size_t i = 0; i < r.size(); ++i)
+			if (r[i].verb == "JOIN" && r[i].fd == 43)
+				++joins;
+		assert_eq(2u, joins);
+		assert_eq("403", r.back().verb); // ERR_NOSUCHCHANNEL (403)
+		assert_eq("bad", r.back().params[1]);
+	}
+	TEST_PRINT;
+
+	TEST("Channel members table")
+	{ // sorted by fd, flags per member
+		Channel channel;
+		channel.addMember(44);
+		channel.addMember(42, MEMBER_OP);
+		channel.addMember(43);
+		channel.addMember(43, MEMBER_OP); // already in, unchanged
+		assert_eq(3u, channel.size());
+		assert_eq(42, channel.members[0].fd);
+		assert_eq(44, channel.members[2].fd);
+		assert(channel.isOp(42) && !channel.isOp(43));
+		channel.setFlag(44, MEMBER_VOICE, true);
+		assert(channel.hasFlag(44, MEMBER_VOICE) && !channel.isOp(44));
+		assert_eq(1u, channel.countFlag(MEMBER_OP));
+		channel.removeMember(42);
+		assert(!channel.isMember(42) && !channel.isOp(42));
+	}
+	{ // broadcast skips the sender
+		Channel channel;
+		channel.addMember(42);
+		channel.addMember(43);
+		Responses out;
+		channel.broadcast(Message(42, "PING", "x"), out, 42);
+		assert_eq(1u, out.size());
+		assert_eq(43, out[0].fd);
+	}
+	{ // invites expire
+		Channel channel;
+		channel.invite(42, time(0) + 10);
+		channel.invite(43, time(0) - 1);
+		assert(channel.isInvited(42));
+		assert(!channel.isInvited(43));
+		channel.uninvite(42);
+		assert(!channel.isInvited(42));
+	}
+	{ // an expired invite is dropped from the client too
+		State s;
+		s.addMember(42, "#a");
+		Channel &channel = s.channels["#a"];
+		s.invite(43, channel);
+		channel.invites[43] = time(0) - 1;
+		s.invite(44, channel);
+		assert(!channel.invites.count(43));
+		assert(s.clients[43].invites.empty());
+		assert(s.clients[44].invites.count(channel.id));
+	}
+	TEST_PRINT;
+
+	TEST("Channel registry")
+	{ // names are case-insensitive, the first spelling is kept
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		Responses r;
+		joinHandler(Message(42, "JOIN #Dice"), s, r);
+		joinHandler(Message(43, "JOIN #DICE"), s, r);
+		assert_eq(1u, s.channels.size());
+		assert_eq("#Dice", s.channels["#dice"].name);
+		assert_eq(2u, s.channels["#dice"].size());
+		assert(s.clients[43].channels.count(s.channels.id("#dICE")));
+	}
+	{ // ids of deleted channels are reused, their invites are dropped
+		State s;
+		s.welcome(42);
+		s.welcome(43);
+		s.addMember(42, "#a");
+		int a = s.channels.id("#a");
+		ChannelRef ref = s.channels.ref(a);
+		assert(s.channels.find(ref) == s.channels.find(a));
+		s.invite(43, s.channels["#a"]);
+		s.removeMember(42, s.channels["#a"]);
+		assert(s.channels.find(a) == NULL && s.channels.empty());
+		assert(s.clients[43].invites.empty());
+		s.addMember(42, "#b");
+		assert_eq(a, s.channels.id("#b"));
+		assert_eq("#b", s.channels.find(a)->name);
+		assert(s.channels.find(ref) == NULL); // #a's, not #b's
+	}
+	{ // an erased channel is recycled as a new one
+		State s;
+		s.addMember(42, "#a", MEMBER_OP);
+		Channel *recycled = s.channels.find("#a");
+		recycled->topic = "dice";
+		recycled->modes.insert('t');
+		s.removeMember(42, *recycled);
+		assert_eq(1u, s.channels.pooled());
+		Channel &channel = s.channels["#b"];
+		assert(&channel == recycled);
+		assert_eq(0u, s.channels.pooled());
+		assert_eq("#b", channel.name);
+		assert(channel.topic.empty() && channel.modes.empty());
+		assert(channel.empty() && channel.invites.empty());
+	}
+	{ // a burst of channels is not pooled for good
+		State s;
+		for (size_t i = 0; i < CHANNEL_POOL_MAX + 10; ++i)
+			s.addMember(42, "#" + size_to_str(i));
+		for (size_t i = 0; i < CHANNEL_POOL_MAX + 10; ++i)
+			s.removeMember(42, s.channels["#" + size_to_str(i)]);
+		assert(s.channels.empty());
+		assert_eq((size_t)CHANNEL_POOL_MAX, s.channels.pooled());
+	}
+	TEST_PRINT;
+
+	TEST("NAMES cache")
+	{ // entries follow joins, parts, nick and op changes
+		NamesCache names;
+		names.add("@alice", 400);
+		names.add("bob", 400);
+		names.add("carol", 400);
+		names.remove("bob");
+		names.replace("carol", "@carol", 400);
+		assert_eq(1u, names.chunks().size());
+		assert_eq("@alice @carol", names.chunks()[0]);
+		names.remove("alice"); // not an entry, "@alice" is
+		assert_eq("@alice @carol", names.chunks()[0]);
+	}
+	{ // through the state and the handlers
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		Responses r;
+		joinHandler(Message(42, "JOIN #a"), s, r);
+		joinHandler(Message(43, "JOIN #a"), s, r);
+		s.setNick(43, "bobby");
+		modeHandler(Message(42, "MODE #a +o bobby"), s, r);
+		s.setNick(42, "al");
+		r.clear();
+		namesHandler(Message(42, "NAMES #a"), s, r);
+		assert_eq(2u, r.size());
+		assert_eq("353", r[0].verb); // RPL_NAMREPLY (353)
+		assert_eq("@bobby @al", r[0].params.back()); // changed ones go last
+	}
+	{ // a large channel is sent in replies of at most MAX_MSG_LEN
+		State s;
+		for (int fd = 100; fd < 300; ++fd)
+		{
+			s.welcome(fd);
+			s.setNick(fd, "member" + size_to_str(fd));
+			s.addMember(fd, "#big");
+		}
+		std::string long_nick(60, 'x');
+		s.setNick(42, long_nick);
+		s.welcome(42);
+		const char *nicks[] = {"bob", long_nick.c_str()};
+		for (int i = 0; i < 2; ++i)
+		{
+			s.setNick(42, nicks[i]);
+			Responses r;
+			namesHandler(Message(42, "NAMES #big"), s, r);
+			size_t entries = 0;
+			for (size_t j = 0; j + 1 < r.size(); ++j)
+			{
+				assert(r[j].assemble().size() <= MAX_MSG_LEN);
+				std::string names = r[j].params.back();
+				entries += std::count(names.begin(), names.end(), ' ') + 1;
+			}
+			assert(r.size() > 2);
+			assert_eq(200u, entries);
+		}
+	}
+	TEST_PRINT;
+}
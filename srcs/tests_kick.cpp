@@ -8,29 +8,29 @@ void tests_kick()
 	TEST("KICK handler")
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(43);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(42, "#test");
+		s.addMember(43, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Message m(42, "KICK #test bob");
 		Responses r;
 
 		kickHandler(m, s, r);
 
-		assert(s.channels["#test"].client_ids.count(43) == 0);
-		assert(s.channels["#test"].client_ids.count(42) == 1);
+		assert(s.channels["#test"].isMember(43) == 0);
+		assert(s.channels["#test"].isMember(42) == 1);
 	}
 	// Action: User utilise KICK sans spécifier de target
 	// Assert: Erreur paramètres insuffisants
 	{
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.addMember(42, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Message m(42, "KICK #test");
 		Responses r;
 
@@ -42,60 +42,60 @@ void tests_kick()
 	}
 	{ // user cannot kick without being channel op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "tom";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "jack";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "tom");
+		s.welcome(99);
+		s.setNick(99, "jack");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
 		Responses r;
 		kickHandler(Message(42, "KICK #test jack"), s, r);
 		assert(1 == r.size());
 		assert_eq("482", r[0].verb); // ERR_CHANOPRIVSNEEDED (482)
 		assert(r[0].params.size() == 3);
 		assert(r[0].params[1] == "#test");
-		assert(s.channels["#test"].client_ids.count(99));
+		assert(s.channels["#test"].isMember(99));
 	}
 	{ // channel op can kick users
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "chanop";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "victim";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.welcome(99);
+		s.setNick(99, "victim");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Responses r;
 		kickHandler(Message(42, "KICK #test victim"), s, r);
 		assert(r.size() >= 1);
 		assert_eq("KICK", r[0].verb);
-		assert(!s.channels["#test"].client_ids.count(99));
+		assert(!s.channels["#test"].isMember(99));
 	}
 	{ // IRC op can kick without being channel op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "victim";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
+		s.welcome(99);
+		s.setNick(99, "victim");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		kickHandler(Message(42, "KICK #test victim"), s, r);
 		assert(r.size() >= 1);
 		assert_eq("KICK", r[0].verb);
-		assert(!s.channels["#test"].client_ids.count(99));
+		assert(!s.channels["#test"].isMember(99));
 	}
 	{ // IRC op can kick from outside the channel
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "victim";
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
+		s.welcome(99);
+		s.setNick(99, "victim");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		kickHandler(Message(42, "KICK #test victim"), s, r);
 		assert(r.size() >= 1);
@@ -104,16 +104,16 @@ void tests_kick()
 	}
 	{ // should show the reason to everyone
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
-		s.clients[11].status = WELCOMED;
-		s.clients[11].nick = "ric";
-		s.clients[22].status = WELCOMED;
-		s.clients[22].nick = "tom";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(11);
-		s.channels["#test"].client_ids.insert(22);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "john");
+		s.welcome(11);
+		s.setNick(11, "ric");
+		s.welcome(22);
+		s.setNick(22, "tom");
+		s.addMember(42, "#test");
+		s.addMember(11, "#test");
+		s.addMember(22, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Responses r;
 		kickHandler(Message(42, "KICK #test ric :not human"), s, r);
 		const Message *m;
@@ -138,13 +138,13 @@ void tests_kick()
 	}
 	{ // should show a default reason if not given
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
-		s.clients[11].status = WELCOMED;
-		s.clients[11].nick = "ric";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(11);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "john");
+		s.welcome(11);
+		s.setNick(11, "ric");
+		s.addMember(42, "#test");
+		s.addMember(11, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Responses r;
 		kickHandler(Message(42, "KICK #test ric"), s, r);
 		const Message *m;
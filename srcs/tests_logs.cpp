@@ -0,0 +1,283 @@
+#include <csignal>
+#include <cstdio> // tmpfile()
+#include <unistd.h>
+
+#include <cstdlib> // mkstemp()
+#include <cstring> // memcpy()
+#include <fstream>
+
+#include "tests.hpp"
+#include "Connection.class.hpp"
+#include "handlers.hpp"
+#include "Logs.class.hpp"
+#include "utils.hpp"
+
+// logs rendered right away, as before startLogWriter()
+struct CapturedLogs
+{
+	std::ostringstream	text;
+	std::streambuf		*saved;
+	CapturedLogs() : saved(std::cout.rdbuf(text.rdbuf())) {}
+	~CapturedLogs() { std::cout.rdbuf(saved); }
+};
+
+static size_t countOf(const std::string &text, const std::string &needle)
+{
+	size_t n = 0;
+	for (size_t at = text.find(needle); at != std::string::npos;
+		at = text.find(needle, at + 1))
+		++n;
+	return n;
+}
+
+static void logEverything()
+{
+	LogConfig full = {LOG_LEVEL_FULL, 1, 0};
+	for (int i = 0; i < LOG_CAT_COUNT; ++i)
+		setLogConfig(static_cast<e_log_category>(i), full);
+}
+
+// everything written to fd so far
+static std::string readBack(int fd)
+{
+	std::string text;
+	char bytes[4096];
+	ssize_t n;
+	lseek(fd, 0, SEEK_SET);
+	while ((n = read(fd, bytes, sizeof(bytes))) > 0)
+		text.append(bytes, n);
+	return text;
+}
+
+static void formatType(const LogRecord &record, const char *text,
+	std::string &out)
+{
+	if (record.type == LOG_RING_DROPPED)
+		out += "dropped ";
+	out.append(text, record.length);
+	out += '\n';
+}
+
+void tests_logs()
+{
+	TEST("Async logs")
+	{ // the writer thread renders what std::cout used to get
+		FILE *file = tmpfile();
+		assert(file != NULL);
+		time_t start = time(0);
+		Logs logs(start);
+		std::string buffer = "NICK a\r\nUSER\n";
+
+		assert_eq(OK, startLogWriter(fileno(file)));
+		logs.logsConnect(5, 2);
+		logs.logsBuffer(5, buffer, true);
+		logs.logsDisconnect(5, 2);
+		stopLogWriter();
+
+		std::string text = readBack(fileno(file));
+		fclose(file);
+		size_t at = text.find("] ");
+		assert(at != std::string::npos);
+		assert_eq(at + 2, text.find(GREEN "New connection" RESET
+			" with client (5)\nTotal connected: 2\n\n"));
+		assert(text.find(TEAL "Buffer_in" RESET " for client (5):\n"
+			"NICK a\nUSER" RED "\\n" RESET "\n") != std::string::npos);
+		assert(text.find(RED "Disconnected" RESET " client (5)\n"
+			"Total connected: 1\n\n") != std::string::npos);
+	}
+	{ // in order, and a record too big for the ring is counted, not waited for
+		FILE *file = tmpfile();
+		assert(file != NULL);
+		LogRing ring(formatType);
+		std::string big(LOG_RING_BYTES, 'x');
+		std::string expected;
+
+		assert_eq(OK, ring.start(fileno(file)));
+		for (int i = 0; i < 2000; ++i)
+		{
+			std::string line(i % 97, 'a' + i % 26);
+			LogRecord record = {0, i, 0, 0, line.size()};
+			assert(ring.push(record, line.data()));
+			expected += line + "\n";
+		}
+		LogRecord record = {0, -1, 0, 0, big.size()};
+		assert(!ring.push(record, big.data()));
+		assert_eq(1u, ring.dropped());
+		LogRecord last = {0, -1, 0, 0, 4};
+		assert(ring.push(last, "last"));
+		ring.stop();
+
+		// the drop is reported with the next batch, wherever it starts
+		std::string text = readBack(fileno(file));
+		fclose(file);
+		size_t at = text.find("dropped \n");
+		assert(at != std::string::npos);
+		text.erase(at, 9);
+		assert_eq(expected + "last\n", text);
+	}
+	TEST_PRINT
+
+	TEST("Log levels")
+	{ // off: nothing is built
+		logEverything();
+		LogConfig off = {LOG_LEVEL_OFF, 1, 0};
+		setLogConfig(LOG_CAT_BUFFER, off);
+		assert(!logWanted(LOG_BUFFER_IN));
+		assert(logWanted(LOG_CONNECT));
+		CapturedLogs logs;
+		std::string buffer = "NICK a\r\n";
+		Logs(time(0)).logsBuffer(5, buffer, true);
+		logEverything();
+		assert_eq("", logs.text.str());
+	}
+	{ // one in 2, cut at 4 bytes, then only the size
+		LogConfig sampled = {LOG_LEVEL_FULL, 2, 4};
+		setLogConfig(LOG_CAT_BUFFER, sampled);
+		CapturedLogs logs;
+		Logs log(time(0));
+		std::string buffer = "abcdefgh";
+		for (int i = 0; i < 3; ++i)
+			log.logsBuffer(5, buffer, true);
+		LogConfig sizes = {LOG_LEVEL_SHORT, 1, 0};
+		setLogConfig(LOG_CAT_BUFFER, sizes);
+		log.logsBuffer(5, buffer, false);
+		logEverything();
+
+		std::string text = logs.text.str();
+		std::string cut = "abcd" ORANGE "... 8 bytes" RESET "\n";
+		assert_eq(2u, countOf(text, cut));
+		assert_eq(0u, countOf(text, "abcde"));
+		assert_eq(3u, countOf(text, "for client (5)"));
+		assert(text.find(MAGENTA "Buffer_out" RESET " for client (5): 8 bytes\n")
+			!= std::string::npos);
+	}
+	{ // SIGUSR1 keeps the errors only, until the next one
+		logEverything();
+		handleLogSignal(SIGUSR1);
+		assert(!logWanted(LOG_CONNECT));
+		assert(!logWanted(LOG_BOT_IN));
+		assert(logWanted(LOG_POLL_ERROR));
+		handleLogSignal(SIGUSR1);
+		assert(logWanted(LOG_CONNECT));
+	}
+	{ // LOGLEVEL, operators only
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		Responses r;
+		logLevelHandler(Message(42, "LOGLEVEL buffer off"), s, r);
+		assert_eq(1u, r.size());
+		assert_eq("481", r[0].verb); // ERR_NOPRIVILEGES
+		assert(logWanted(LOG_BUFFER_IN));
+
+		s.setOper(42, true);
+		r.clear();
+		logLevelHandler(Message(42, "LOGLEVEL buffer full 10 256"), s, r);
+		assert_eq((size_t)LOG_CAT_COUNT, r.size());
+		assert_eq("NOTICE", r[1].verb);
+		assert_eq("buffer: full, 1 in 10, first 256 bytes", r[1].params.back());
+		assert_eq(10u, logConfig(LOG_CAT_BUFFER).sample);
+
+		r.clear();
+		logLevelHandler(Message(42, "LOGLEVEL * off"), s, r);
+		assert(!logWanted(LOG_CONNECT) && !logWanted(LOG_BOT_OUT));
+		assert_eq("connect: off", r[0].params.back());
+
+		r.clear();
+		logLevelHandler(Message(42, "LOGLEVEL disk full"), s, r);
+		assert_eq(1u, r.size());
+		assert_eq("LOGLEVEL: unknown category disk", r[0].params.back());
+		r.clear();
+		logLevelHandler(Message(42, "LOGLEVEL bot full x"), s, r);
+		assert_eq("LOGLEVEL: not a number x", r[0].params.back());
+		r.clear();
+		logLevelHandler(Message(42, "LOGLEVEL bot"), s, r);
+		assert_eq("461", r[0].verb); // ERR_NEEDMOREPARAMS
+		logEverything();
+	}
+	{ // plain replies are counted once queued, logged at the end
+		State s;
+		s.clients[5].caps = CAP_COMPACT;
+		Connection connection(s, messageRouter);
+		CapturedLogs logs;
+		connection.feed(5, "NICK\r\nNICK\r\n", 12); // 431 twice, in red
+		connection.hangUp(5);
+		size_t saved = 2 * std::string(RED RESET).size();
+		assert(logs.text.str().find(") saved " GREEN + size_to_str(saved)
+			+ " bytes") != std::string::npos);
+	}
+	TEST_PRINT
+
+	TEST("Traffic capture")
+	{ // what a client sent is read back as sent, in order
+		char path[] = "/tmp/ircserv_capture_XXXXXX";
+		int fd = mkstemp(path);
+		assert(fd >= 0);
+		close(fd);
+		{
+			State s;
+			Connection connection(s, parrot);
+			CapturedLogs logs;
+			assert_eq(OK, connection.startCapture(path));
+			connection.feed(5, "NICK a\r\nUS", 10);
+			connection.feed(5, "ER a 0 * :a\r\n", 13);
+			connection.hangUp(5);
+		}
+
+		std::ifstream in(path, std::ios::binary);
+		CaptureEntry entry;
+		std::string data;
+		assert(readCaptureHeader(in));
+		assert(readCaptureEntry(in, entry, data));
+		assert_eq(CAPTURE_DATA, entry.type);
+		assert_eq(5, entry.fd);
+		assert_eq("NICK a\r\nUS", data);
+		uint64_t first = entry.usec;
+		assert(readCaptureEntry(in, entry, data));
+		assert_eq("ER a 0 * :a\r\n", data);
+		assert(entry.usec >= first);
+		assert(!readCaptureEntry(in, entry, data)); // hangUp is not a recv()
+		assert(in.eof());
+		unlink(path);
+	}
+	{ // an entry the ring can't take ends the capture, marked as such
+		char path[] = "/tmp/ircserv_capture_XXXXXX";
+		close(mkstemp(path));
+		{
+			State s;
+			Connection connection(s, parrot);
+			CapturedLogs logs;
+			assert_eq(OK, connection.startCapture(path));
+			connection.feed(5, "NICK a\r\n", 8);
+			std::string flood(LOG_RING_BYTES, 'x');
+			std::streambuf *err = std::cerr.rdbuf(NULL);
+			connection.feed(5, flood.data(), flood.size());
+			std::cerr.rdbuf(err);
+			connection.feed(5, "NICK b\r\n", 8); // not recorded
+		}
+
+		std::ifstream in(path, std::ios::binary);
+		CaptureEntry entry;
+		std::string data;
+		assert(readCaptureHeader(in));
+		assert(readCaptureEntry(in, entry, data));
+		assert_eq("NICK a\r\n", data);
+		assert(readCaptureEntry(in, entry, data));
+		assert_eq(CAPTURE_DROPPED, entry.type);
+		assert_eq(1, entry.fd);
+		assert(!readCaptureEntry(in, entry, data));
+		assert(in.eof());
+		unlink(path);
+	}
+	{ // a length from the file is checked before it is allocated
+		char bytes[17] = {CAPTURE_DATA, 5, 0, 0, 0};
+		uint32_t length = 0xffffffff;
+		memcpy(bytes + 13, &length, 4);
+		std::istringstream in(std::string(bytes, sizeof(bytes)) + "data");
+		CaptureEntry entry;
+		std::string data;
+		assert(!readCaptureEntry(in, entry, data));
+		assert(data.empty());
+	}
+	TEST_PRINT
+}
@@ -6,8 +6,8 @@ void tests_oper()
 	TEST("OPER handler");
 	{ // requires user and pass
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "risotto";
+		s.welcome(42);
+		s.setNick(42, "risotto");
 		Responses r;
 		operHandler(Message(42, "OPER"), s, r);
 		operHandler(Message(42, "OPER name"), s, r);
@@ -22,7 +22,7 @@ void tests_oper()
 		State s;
 		s.oper_name = "goodname";
 		s.oper_pass = "goodpass";
-		s.clients[42].nick = "pepe";
+		s.setNick(42, "pepe");
 		s.clients[42].status = AUTHENTICATED;
 		Responses r;
 		messageRouter(Message(42, "OPER goodname goodpass"), s, r);
@@ -33,8 +33,8 @@ void tests_oper()
 		State s;
 		s.oper_name = "goodname";
 		s.oper_pass = "goodpass";
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "ric");
 		Responses r;
 		operHandler(Message(42, "OPER xxxx yyyyy"), s, r);
 		operHandler(Message(42, "OPER xxxx goodpass"), s, r);
@@ -50,8 +50,8 @@ void tests_oper()
 		State s;
 		s.oper_name = "goodname";
 		s.oper_pass = "goodpass";
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "ric");
 		Responses r;
 		operHandler(Message(42, "OPER goodname goodpass"), s, r);
 		assert(r.size() >= 2);
@@ -67,8 +67,8 @@ void tests_oper()
 	TEST("MODE handler & normal user");
 	{ // does not segfault or create phantom clients or channels
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "ric");
 		Responses r;
 		modeHandler(Message(42, "MODE :"), s, r);
 		modeHandler(Message(42, "MODE kasper :"), s, r);
@@ -79,8 +79,8 @@ void tests_oper()
 	}
 	{ // user can query own modes
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "ric");
 		Responses r;
 		modeHandler(Message(42, "MODE", "ric"), s, r);
 		assert(1 == r.size());
@@ -90,8 +90,8 @@ void tests_oper()
 	}
 	{ // user can't set mode that is not recognised
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
+		s.welcome(42);
+		s.setNick(42, "john");
 		Responses r;
 		modeHandler(Message(42, "MODE john +p"), s, r);
 		assert(!s.clients[42].modes.count('p'));
@@ -101,8 +101,8 @@ void tests_oper()
 	}
 	{ // normal user cannot set +o
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "ric");
 		Responses r;
 		modeHandler(Message(42, "MODE ric +o"), s, r);
 		assert(1 == r.size());
@@ -112,8 +112,8 @@ void tests_oper()
 	}
 	{ // no sneaky +o in many modes
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "ric");
 		Responses r;
 		modeHandler(Message(42, "MODE ric +iow"), s, r);
 		assert(1 == r.size());
@@ -125,12 +125,12 @@ void tests_oper()
 	}
 	{ // error if target other than self
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
-		s.clients[1].status = WELCOMED;
-		s.clients[1].nick = "tom";
-		s.clients[1].modes.insert('o');
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
+		s.welcome(1);
+		s.setNick(1, "tom");
+		s.setOper(1, true);
 		Responses r;
 		modeHandler(Message(42, "MODE tom -o"), s, r);
 		modeHandler(Message(42, "MODE kasper -o"), s, r);
@@ -146,8 +146,8 @@ void tests_oper()
 	}
 	{ // error if no prefix +/-
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
+		s.welcome(42);
+		s.setNick(42, "john");
 		Responses r;
 		modeHandler(Message(42, "MODE john o"), s, r);
 		assert(1 == r.size());
@@ -158,10 +158,10 @@ void tests_oper()
 	}
 	{ // normal user cannot set modes on others
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "ric";
+		s.welcome(42);
+		s.setNick(42, "john");
+		s.welcome(99);
+		s.setNick(99, "ric");
 		Responses r;
 		modeHandler(Message(42, "MODE ric +i"), s, r);
 		assert(1 == r.size());
@@ -171,9 +171,9 @@ void tests_oper()
 	}
 	{ // user cannot set channel modes without being op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "tom";
-		s.channels["#test"].client_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "tom");
+		s.addMember(42, "#test");
 		Responses r;
 		modeHandler(Message(42, "MODE #test +i"), s, r);
 		assert(1 == r.size());
@@ -184,12 +184,12 @@ void tests_oper()
 	}
 	{ // user cannot grant channel op without being op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "tom";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "lisa";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "tom");
+		s.welcome(99);
+		s.setNick(99, "lisa");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
 		Responses r;
 		modeHandler(Message(42, "MODE #test +o lisa"), s, r);
 		assert(1 == r.size());
@@ -197,17 +197,17 @@ void tests_oper()
 		assert(r[0].params.size() == 3);
 		assert(r[0].params[1] == "#test");
 		assert(!s.clients[99].modes.count('o'));
-		assert(!s.channels["#test"].op_ids.count(99));
+		assert(!s.channels["#test"].isOp(99));
 	}
 	{ // user cannot remove channel op without being op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "tom";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "lisa";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "tom");
+		s.welcome(99);
+		s.setNick(99, "lisa");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test -o lisa"), s, r);
 		assert(1 == r.size());
@@ -215,13 +215,13 @@ void tests_oper()
 		assert(r[0].params.size() == 3);
 		assert(r[0].params[1] == "#test");
 		assert(!s.clients[99].modes.count('o'));
-		assert(s.channels["#test"].op_ids.count(99));
+		assert(s.channels["#test"].isOp(99));
 	}
 	{ // user cannot set channel modes without being op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "tom";
-		s.channels["#test"].client_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "tom");
+		s.addMember(42, "#test");
 		Responses r;
 		modeHandler(Message(42, "MODE #test +i"), s, r);
 		assert(1 == r.size());
@@ -233,7 +233,7 @@ void tests_oper()
 	{ // user requires WELCOMED status to use MODE
 		State s;
 		s.clients[42].status = AUTHENTICATED;
-		s.clients[42].nick = "john";
+		s.setNick(42, "john");
 		Responses r;
 		messageRouter(Message(42, "MODE john +i"), s, r);
 		assert(1 == r.size());
@@ -242,8 +242,8 @@ void tests_oper()
 	}
 	{ // user can query their own modes
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
+		s.welcome(42);
+		s.setNick(42, "john");
 		s.clients[42].modes.insert('i');
 		s.clients[42].modes.insert('w');
 		Responses r;
@@ -256,9 +256,9 @@ void tests_oper()
 	}
 	{ // user can query channel modes
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
-		s.channels["#test"].client_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "john");
+		s.addMember(42, "#test");
 		s.channels["#test"].modes.insert('i');
 		s.channels["#test"].modes.insert('t');
 		Responses r;
@@ -271,8 +271,8 @@ void tests_oper()
 	}
 	{ // user cannot query channel modes if channel does not exist
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "john";
+		s.welcome(42);
+		s.setNick(42, "john");
 		Responses r;
 		modeHandler(Message(42, "MODE #test"), s, r);
 		assert(1 == r.size());
@@ -286,46 +286,46 @@ void tests_oper()
 	TEST("MODE handler & channel op");
 	{ // channel op can grant op to another user
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "chanop";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "regular";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.welcome(99);
+		s.setNick(99, "regular");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test +o regular"), s, r);
 		assert(r.size() >= 2);
 		assert_eq("MODE", r[0].verb);
 		assert_eq("MODE", r[1].verb);
-		assert(s.channels["#test"].op_ids.count(99));
+		assert(s.channels["#test"].isOp(99));
 		assert(!s.clients[99].modes.count('o'));
 	}
 	{ // channel op can remove op from another user
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "chanop";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "other";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(42);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.welcome(99);
+		s.setNick(99, "other");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test -o other"), s, r);
 		assert(r.size() >= 2);
 		assert_eq("MODE", r[0].verb);
 		assert_eq("MODE", r[1].verb);
-		assert(!s.channels["#test"].op_ids.count(99));
+		assert(!s.channels["#test"].isOp(99));
 	}
 	{ // cannot grant op to user not in channel
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "chanop";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "outsider";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.welcome(99);
+		s.setNick(99, "outsider");
+		s.addMember(42, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test +o outsider"), s, r);
 		assert(1 == r.size());
@@ -335,31 +335,31 @@ void tests_oper()
 	}
 	{ // multiple ops can coexist in channel
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "op1";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "op2";
-		s.clients[77].status = WELCOMED;
-		s.clients[77].nick = "op3";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].client_ids.insert(77);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "op1");
+		s.welcome(99);
+		s.setNick(99, "op2");
+		s.welcome(77);
+		s.setNick(77, "op3");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.addMember(77, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test +o op2"), s, r);
 		modeHandler(Message(99, "MODE #test +o op3"), s, r);
-		assert(s.channels["#test"].op_ids.count(42));
-		assert(s.channels["#test"].op_ids.count(99));
-		assert(s.channels["#test"].op_ids.count(77));
+		assert(s.channels["#test"].isOp(42));
+		assert(s.channels["#test"].isOp(99));
+		assert(s.channels["#test"].isOp(77));
 	}
 	TEST_PRINT;
 
 	TEST("MODE handler & IRC op");
 	{ // IRC operator can query own modes
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ric";
-		s.clients[42].modes.insert('o');
+		s.welcome(42);
+		s.setNick(42, "ric");
+		s.setOper(42, true);
 		Responses r;
 		modeHandler(Message(42, "MODE", "ric"), s, r);
 		assert(1 == r.size());
@@ -370,14 +370,14 @@ void tests_oper()
 	}
 	{ // IRC operator can set channel modes without being channel op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "regular";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
+		s.welcome(99);
+		s.setNick(99, "regular");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test +i"), s, r);
 		assert(r.size() >= 1);
@@ -386,57 +386,57 @@ void tests_oper()
 	}
 	{ // IRC operator can grant channel op without being channel op
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "target";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
+		s.welcome(99);
+		s.setNick(99, "target");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
 		Responses r;
 		modeHandler(Message(42, "MODE #test +o target"), s, r);
 		assert(r.size() >= 1);
-		assert(s.channels["#test"].op_ids.count(99));
+		assert(s.channels["#test"].isOp(99));
 		assert(!s.clients[99].modes.count('o'));
 	}
 	{ // channel op can remove channel op from IRCop
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "chanop";
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "other";
-		s.clients[99].modes.insert('o');
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(42);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "chanop");
+		s.welcome(99);
+		s.setNick(99, "other");
+		s.setOper(99, true);
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test -o other"), s, r);
 		assert(r.size() >= 1);
 		assert_eq("MODE", r[0].verb);
-		assert(!s.channels["#test"].op_ids.count(99));
+		assert(!s.channels["#test"].isOp(99));
 		assert(s.clients[99].modes.count('o'));
 	}
 	{ // IRC op can remove channel op status
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
-		s.clients[99].status = WELCOMED;
-		s.clients[99].nick = "chanop";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(99);
-		s.channels["#test"].op_ids.insert(99);
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
+		s.welcome(99);
+		s.setNick(99, "chanop");
+		s.addMember(42, "#test");
+		s.addMember(99, "#test");
+		s.channels["#test"].setFlag(99, MEMBER_OP, true);
 		Responses r;
 		modeHandler(Message(42, "MODE #test -o chanop"), s, r);
 		assert(r.size() >= 1);
-		assert(!s.channels["#test"].op_ids.count(99));
+		assert(!s.channels["#test"].isOp(99));
 	}
 	{ // IRC operator can deop themselves
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "ircop";
-		s.clients[42].modes.insert('o');
+		s.welcome(42);
+		s.setNick(42, "ircop");
+		s.setOper(42, true);
 		Responses r;
 		modeHandler(Message(42, "MODE ircop -o"), s, r);
 		assert(r.size() >= 1);
@@ -1,5 +1,8 @@
 #include "tests.hpp"
+#include "dictionary.hpp"
+#include "handlers.hpp"
 #include "Message.struct.hpp"
+#include "Responses.class.hpp"
 
 void tests_parsing()
 {
@@ -336,4 +339,96 @@ void tests_parsing()
 		assert(!m.isValid());
 	}
 	TEST_PRINT;
-}
\ No newline at end of file
+
+	TEST("Message reuse")
+	{ // parsing again leaves nothing of the previous line
+		Message m(42, "@+a=b :alice PRIVMSG #a,#b :hello there\r\n");
+		m.parse(43, "PING x\r\nPRIVMSG bob :next\r\n");
+		assert_eq(43, m.fd);
+		assert("" == m.tags);
+		assert("" == m.source);
+		assert("PING" == m.verb);
+		assert_eq(1u, m.params.size());
+		assert("x" == m.params[0]);
+	}
+	{ // cleared slots are reused, not freed
+		Responses r;
+		r.push_back(Message(42, "PRIVMSG", "#a", "a long enough text"));
+		r.push_back(Message(43, "PING", "x"));
+		const char *text = r[0].params[1].data();
+		r.clear();
+		assert(r.empty());
+		assert(r.begin() == r.end());
+		r.push_back(Message(44, "PRIVMSG", "#b", "short"));
+		assert_eq(1u, r.size());
+		assert_eq(44, r.back().fd);
+		assert("short" == r.at(0).params[1]);
+		assert(text == r[0].params[1].data());
+		assert(!find_by_fd(r, 43));
+	}
+	TEST_PRINT;
+}
+
+void tests_tags()
+{
+	TEST("Message tags")
+	{
+		Message m(42, "@+typing=active;time=x :src TAGMSG #chan\r\n");
+		assert_eq("+typing=active;time=x", m.tags);
+		assert_eq("src", m.source);
+		assert_eq("TAGMSG", m.verb);
+		assert(1 == m.params.size());
+		std::string value;
+		assert(m.getTag("+typing", value));
+		assert_eq("active", value);
+		assert(!m.getTag("+typ", value));
+		assert_eq("+typing=active", m.clientTags());
+	}
+	{ // escaping round trip
+		Message m("src", 42, "PRIVMSG", "#chan", "hi");
+		m.addTag("+note", "a;b c\\d");
+		m.addTag("+flag", "");
+		assert_eq("+note=a\\:b\\sc\\\\d;+flag", m.tags);
+		std::string value;
+		assert(m.getTag("+note", value));
+		assert_eq("a;b c\\d", value);
+		assert(m.getTag("+flag", value));
+		assert_eq("", value);
+		assert(Message(42, m.assemble()) == m);
+	}
+	{ // the 512 bytes limit does not include the tags
+		std::string tags(1000, 'a');
+		std::string text(400, 'b');
+		Message m(42, "@" + tags + " PRIVMSG #chan :" + text + "\r\n");
+		assert_eq(tags, m.tags);
+		assert_eq(text, m.params.at(1));
+		assert(!m.too_long);
+	}
+	{ // tags over the limit are refused, not cut
+		std::string tags = "+a=" + std::string(MAX_TAGS_LEN, 'x');
+		Message m(42, "@" + tags + " PRIVMSG #chan :hi\r\n");
+		assert(m.too_long);
+		assert_eq("", m.tags);
+		assert_eq("PRIVMSG", m.verb);
+
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(42, "#chan");
+		s.addMember(43, "#chan");
+		Responses r;
+		messageRouter(m, s, r);
+		assert_eq(1u, r.size());
+		assert_eq("417", r[0].verb); // ERR_INPUTTOOLONG
+		assert_eq(42, r[0].fd);
+	}
+	{ // invalid client tags are not relayed
+		std::string nul(1, '\0');
+		Message m(42, "@+ok=1;+a\nb=2;+c=3\n4;+/x=5;+x/=6;+ex.com/typing=7;"
+			"+a_b=8;+d=9" + nul + ";+e;+ PRIVMSG #chan :hi\r\n");
+		assert_eq("+ok=1;+ex.com/typing=7;+e", m.clientTags());
+	}
+	TEST_PRINT;
+}
@@ -8,50 +8,110 @@ void tests_part()
 		// Action: User quitte un channel
 		// Assert: User retiré de la liste des clients
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.channels["#test"].client_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.addMember(42, "#test");
 		Message m(42, "PART #test");
 		Responses r;
 
 		partHandler(m, s, r);
 
-		assert(s.channels["#test"].client_ids.count(42) == 0);
+		assert(s.channels["#test"].isMember(42) == 0);
 	}
 	{
 		// Action: Dernier user quitte le channel
 		// Assert: Channel supprimé complètement
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.addMember(42, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Message m(42, "PART #test");
 		Responses r;
 
 		partHandler(m, s, r);
 
-		assert(s.channels.find("#test") == s.channels.end());
+		assert(!s.channels.count("#test"));
 	}
 	{
 		// Action: User quitte un channel avec d'autres users présents
 		// Assert: Channel préservé avec les users restants
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(43);
-		s.channels["#test"].op_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(42, "#test");
+		s.addMember(43, "#test");
+		s.channels["#test"].setFlag(42, MEMBER_OP, true);
 		Message m(42, "PART #test");
 		Responses r;
 
 		partHandler(m, s, r);
 
-		assert(s.channels.find("#test") != s.channels.end());
-		assert(s.channels["#test"].client_ids.size() == 1);
-		assert(s.channels["#test"].op_ids.size() == 0);
+		assert(s.channels.count("#test"));
+		assert(s.channels["#test"].size() == 1);
+		assert(s.channels["#test"].countFlag(MEMBER_OP) == 0);
 	}
 	TEST_PRINT;
-}
\ No newline at end of file
+
+	TEST("PART multiple channels")
+	{
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		Responses r;
+		joinHandler(Message(42, "JOIN #a,#b,#c"), s, r);
+		r.clear();
+		partHandler(Message(42, "PART #a,#A,#nope,#c"), s, r);
+		assert_eq(3u, r.size());
+		assert_eq("PART", r[0].verb);
+		assert_eq("403", r[1].verb); // ERR_NOSUCHCHANNEL (403)
+		assert_eq("PART", r[2].verb);
+		assert_eq(1u, s.channels.size());
+		assert(s.channels.count("#b"));
+	}
+	TEST_PRINT;
+
+	TEST("Reverse membership index")
+	{ // JOIN, PART and KICK keep the client's channels in sync
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		Responses r;
+		joinHandler(Message(42, "JOIN #a"), s, r);
+		joinHandler(Message(42, "JOIN #b"), s, r);
+		joinHandler(Message(43, "JOIN #b"), s, r);
+		assert(2 == s.clients[42].channels.size());
+		assert(1 == s.clients[43].channels.count(s.channels.id("#b")));
+		int a = s.channels.id("#a");
+		partHandler(Message(42, "PART #a"), s, r);
+		assert(0 == s.clients[42].channels.count(a));
+		kickHandler(Message(42, "KICK #b bob"), s, r);
+		assert(s.clients[43].channels.empty());
+	}
+	{ // NICK and QUIT only reach the members of the client's channels
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.welcome(44);
+		s.setNick(44, "carol");
+		s.addMember(42, "#a");
+		s.addMember(43, "#a");
+		s.addMember(43, "#b");
+		s.addMember(44, "#b");
+		std::vector<int> others = s.clientsInChannelsWith(42);
+		assert(1 == others.size());
+		assert_eq(43, others[0]);
+		s.invite(42, s.channels["#b"]);
+		s.removeClient(42);
+		assert(0 == s.channels["#a"].isMember(42));
+		assert(0 == s.channels["#b"].isInvited(42));
+		assert(1 == s.clients[43].channels.count(s.channels.id("#a")));
+	}
+	TEST_PRINT;
+}
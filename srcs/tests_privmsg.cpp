@@ -1,5 +1,28 @@
 #include "tests.hpp"
+#include "colors.hpp"
+#include "Connection.class.hpp"
 #include "handlers.hpp"
+#include "Random.class.hpp"
+#include "Rolls.class.hpp"
+
+#include <iostream>
+#include <poll.h>
+
+// the bot logs go nowhere during a test, back even if it fails
+struct SilentLogs
+{
+	std::streambuf *saved;
+	SilentLogs() : saved(std::cout.rdbuf(NULL)) {}
+	~SilentLogs() { std::cout.rdbuf(saved); }
+};
+
+// the bot answers from its worker, as the reactor does
+static void waitBot(State &s, Responses &r)
+{
+	struct pollfd pfd = {botWakeFd(), POLLIN, 0};
+	poll(&pfd, 1, 2000);
+	botDrain(s, r);
+}
 
 void tests_privmsg()
 {
@@ -8,10 +31,10 @@ void tests_privmsg()
 		// Action: User envoie PRIVMSG à un autre user
 		// Assert: Message reçu par le destinataire
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
 		Message m(42, "PRIVMSG bob :Hello Bob!");
 		Responses r;
 
@@ -29,15 +52,15 @@ void tests_privmsg()
 		// Action: User envoie PRIVMSG à un channel
 		// Assert: Tous les membres sauf l'émetteur reçoivent le message
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.clients[44].status = WELCOMED;
-		s.clients[44].nick = "charlie";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(43);
-		s.channels["#test"].client_ids.insert(44);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.welcome(44);
+		s.setNick(44, "charlie");
+		s.addMember(42, "#test");
+		s.addMember(43, "#test");
+		s.addMember(44, "#test");
 		Message m(42, "PRIVMSG #test :Hello everyone!");
 		Responses r;
 
@@ -56,8 +79,8 @@ void tests_privmsg()
 		// Action: PRIVMSG sans destinataire
 		// Assert: ERR_NORECIPIENT (411)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "PRIVMSG");
 		Responses r;
 
@@ -70,8 +93,8 @@ void tests_privmsg()
 		// Action: PRIVMSG sans texte
 		// Assert: ERR_NOTEXTTOSEND (412)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "PRIVMSG bob");
 		Responses r;
 
@@ -84,8 +107,8 @@ void tests_privmsg()
 		// Action: PRIVMSG vers un nick inexistant
 		// Assert: ERR_NOSUCHNICK (401)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "PRIVMSG unknownuser :Hello");
 		Responses r;
 
@@ -99,8 +122,8 @@ void tests_privmsg()
 		// Action: PRIVMSG vers un channel inexistant
 		// Assert: ERR_CANNOTSENDTOCHAN (404)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "PRIVMSG #nonexistent :Hello");
 		Responses r;
 
@@ -113,11 +136,11 @@ void tests_privmsg()
 		// Action: PRIVMSG vers un channel où le user n'est pas membre
 		// Assert: ERR_CANNOTSENDTOCHAN (404)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.channels["#test"].client_ids.insert(43);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(43, "#test");
 		Message m(42, "PRIVMSG #test :Hello");
 		Responses r;
 
@@ -130,11 +153,11 @@ void tests_privmsg()
 		// Action: Vérifier le format hostmask dans le message
 		// Assert: source contient nick!user@host
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[42].username = "~alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.clients[42].setUsername("~alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
 		Message m(42, "PRIVMSG bob :Hello");
 		Responses r;
 
@@ -149,9 +172,9 @@ void tests_privmsg()
 		// Action: PRIVMSG vers un channel avec seulement l'émetteur
 		// Assert: Aucun message envoyé (pas d'écho)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.channels["#test"].client_ids.insert(42);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.addMember(42, "#test");
 		Message m(42, "PRIVMSG #test :Hello");
 		Responses r;
 
@@ -163,15 +186,15 @@ void tests_privmsg()
 		// Action: Vérifier que tous les membres du channel reçoivent le message
 		// Assert: Chaque membre (sauf émetteur) a exactement le même message
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.clients[44].status = WELCOMED;
-		s.clients[44].nick = "charlie";
-		s.channels["#test"].client_ids.insert(42);
-		s.channels["#test"].client_ids.insert(43);
-		s.channels["#test"].client_ids.insert(44);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.welcome(44);
+		s.setNick(44, "charlie");
+		s.addMember(42, "#test");
+		s.addMember(43, "#test");
+		s.addMember(44, "#test");
 		Message m(42, "PRIVMSG #test :Broadcast test");
 		Responses r;
 
@@ -201,10 +224,10 @@ void tests_privmsg()
 		// Action: User envoie NOTICE à un autre user
 		// Assert: Message reçu par le destinataire (identique à PRIVMSG)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
 		Message m(42, "NOTICE bob :Hello Bob!");
 		Responses r;
 
@@ -218,8 +241,8 @@ void tests_privmsg()
 		// Action: NOTICE sans destinataire
 		// Assert: Pas de réponse d'erreur (silencieux)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "NOTICE");
 		Responses r;
 
@@ -231,8 +254,8 @@ void tests_privmsg()
 		// Action: NOTICE vers un nick inexistant
 		// Assert: Pas de réponse d'erreur (silencieux)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
+		s.welcome(42);
+		s.setNick(42, "alice");
 		Message m(42, "NOTICE unknownuser :Hello");
 		Responses r;
 
@@ -244,11 +267,11 @@ void tests_privmsg()
 		// Action: NOTICE vers un channel où le user n'est pas membre
 		// Assert: Pas de réponse d'erreur (silencieux)
 		State s;
-		s.clients[42].status = WELCOMED;
-		s.clients[42].nick = "alice";
-		s.clients[43].status = WELCOMED;
-		s.clients[43].nick = "bob";
-		s.channels["#test"].client_ids.insert(43);
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.addMember(43, "#test");
 		Message m(42, "NOTICE #test :Hello");
 		Responses r;
 
@@ -257,4 +280,168 @@ void tests_privmsg()
 		assert(r.size() == 0); // NOTICE est silencieux
 	}
 	TEST_PRINT;
+
+	TEST("Multiple targets")
+	{ // each target once, channels and nicks mixed
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.welcome(44);
+		s.setNick(44, "charlie");
+		s.addMember(42, "#test");
+		s.addMember(44, "#test");
+		Responses r;
+		privmsgHandler(Message(42, "PRIVMSG bob,#test,BOB,#TEST :hi"), s, r);
+		assert_eq(2u, r.size());
+		assert_eq(43, r[0].fd);
+		assert_eq("bob", r[0].params[0]);
+		assert_eq(44, r[1].fd);
+		assert_eq("#test", r[1].params[0]);
+	}
+	{ // errors per target, the others are still sent
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		Responses r;
+		privmsgHandler(Message(42, "PRIVMSG nobody,#nowhere,bob :hi"), s, r);
+		assert_eq(3u, r.size());
+		assert_eq("401", r[0].verb); // ERR_NOSUCHNICK (401)
+		assert_eq("404", r[1].verb); // ERR_CANNOTSENDTOCHAN (404)
+		assert_eq(43, r[2].fd);
+		r.clear();
+		noticeHandler(Message(42, "NOTICE nobody,bob :hi"), s, r);
+		assert_eq(1u, r.size());
+		assert_eq(43, r[0].fd);
+	}
+	{ // over TARGMAX, the first ones are sent
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		Responses r;
+		privmsgHandler(Message(42, "PRIVMSG a,b,c,bob,e :hi"), s, r);
+		assert_eq("407", r[0].verb); // ERR_TOOMANYTARGETS (407)
+		assert_eq("e", r[0].params[1]);
+		assert_eq(43, r.back().fd);
+	}
+	TEST_PRINT;
+
+	TEST("Bot events")
+	{
+		SilentLogs silent;
+		State s;
+		s.addClient(BOT_ID, createBotClient());
+		s.setNick(BOT_ID, BOT_NICK);
+		botSubscribe(s);
+		s.welcome(1);
+		s.setNick(1, "alice");
+		s.welcome(2);
+		s.setNick(2, "bob");
+		Responses r;
+
+		// the bot follows alice in, and greets
+		messageRouter(Message(1, "JOIN #dice"), s, r);
+		assert(s.channels["#dice"].isMember(BOT_ID));
+		assert(r.back().fd == 1 && r.back().verb == "NOTICE");
+		assert_eq("is ready!", r.back().params[1]);
+
+		// not for the bot: it gets the line and stays silent
+		r.clear();
+		messageRouter(Message(1, "PRIVMSG #dice :hello"), s, r);
+		messageRouter(Message(1, "PRIVMSG bob :hello"), s, r);
+		assert_eq(2u, r.size());
+		assert_eq(BOT_ID, r[0].fd);
+
+		// a private request is answered in private, later
+		r.clear();
+		messageRouter(Message(1, "PRIVMSG clank :info"), s, r);
+		assert_eq(1u, r.size()); // the line to the bot
+		waitBot(s, r);
+		assert(r.size() > 1);
+		assert(r.back().fd == 1 && r.back().verb == "NOTICE");
+		assert_eq("alice", r.back().params[0]);
+
+		// in a channel, the answer goes to the channel
+		r.clear();
+		messageRouter(Message(1, "PRIVMSG #dice :clank 2d6"), s, r);
+		waitBot(s, r);
+		assert(r.size() > 1);
+		assert(r.back().fd == 1 && r.back().verb == "NOTICE");
+		assert_eq("#dice", r.back().params[0]);
+
+		// a new nick gets the answer, a new client on the same fd does not
+		r.clear();
+		messageRouter(Message(1, "PRIVMSG clank :info"), s, r);
+		messageRouter(Message(1, "NICK alicia"), s, r);
+		waitBot(s, r);
+		assert_eq("alicia", r.back().params[0]);
+		r.clear();
+		messageRouter(Message(2, "PRIVMSG clank :info"), s, r);
+		messageRouter(Message(2, "QUIT"), s, r);
+		s.welcome(2);
+		s.setNick(2, "mallory");
+		r.clear();
+		waitBot(s, r);
+		assert(r.empty());
+
+		// nor a requester who left the channel
+		messageRouter(Message(2, "JOIN #dice"), s, r);
+		messageRouter(Message(2, "PRIVMSG #dice :clank 2d6"), s, r);
+		messageRouter(Message(2, "PART #dice"), s, r);
+		r.clear();
+		waitBot(s, r);
+		assert(r.empty());
+
+		// nor a channel given the id of the requester's one, all in one read
+		messageRouter(Message(1, "JOIN #a"), s, r);
+		int a = s.channels.id("#a");
+		Connection connection(s, messageRouter);
+		std::string lines = "PRIVMSG #a :clank d6\r\nPART #a\r\nJOIN #b\r\n";
+		connection.feed(1, lines.data(), lines.size());
+		assert_eq(a, s.channels.id("#b"));
+		r.clear();
+		waitBot(s, r);
+		assert(r.empty());
+		messageRouter(Message(1, "PART #b"), s, r);
+
+		// alone, it leaves and the channel goes
+		messageRouter(Message(1, "PART #dice"), s, r);
+		assert(!s.channels.count("#dice"));
+		assert(s.clients[BOT_ID].channels.empty());
+	}
+	TEST_PRINT;
+
+	TEST("Dice rolls")
+	{
+		Random a(42), b(42);
+		assert(a.next() == b.next());
+		uint32_t rolls[1000];
+		a.fill(6, rolls, 1000);
+		size_t seen[6] = {0};
+		for (size_t i = 0; i < 1000; ++i)
+		{
+			assert(rolls[i] < 6);
+			++seen[rolls[i]];
+		}
+		for (size_t i = 0; i < 6; ++i)
+			assert(seen[i] > 0);
+
+		assert_eq(2, Rolls::find("3d6", 1, 3));
+		assert_eq(-1, Rolls::find("3d7", 1, 3));
+		assert(Rolls::info().size() > 1);
+		assert(&Rolls::info() == &Rolls::info()); // rendered once
+
+		BotRequest request = {{42, 0}, {3, 0}, "clank 150d6 2d100 d7"};
+		BotReply reply;
+		botAnswer(request, reply);
+		assert_eq(7u, reply.lines.size()); // ----- list, 2x (blank, rolls) -----
+		assert_eq(REVERSED "List of requested rolls" RESET " => d6: 100 / d100: 2",
+			reply.lines[1]);
+	}
+	TEST_PRINT;
 }
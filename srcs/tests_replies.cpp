@@ -0,0 +1,60 @@
+#include "tests.hpp"
+#include "handlers.hpp"
+#include "colors.hpp"
+#include "replies.hpp"
+
+void tests_replies()
+{
+	TEST("Numeric reply templates")
+	{ // server prefix, numeric, client and colored text
+		Client client = Client();
+		client.setNick("alice");
+		Message m = numericReply(42, REPLY_NEEDMOREPARAMS, client, "JOIN");
+		assert_eq(42, m.fd);
+		assert_eq(SERVER_NAME, m.source);
+		assert_eq("461", m.verb); // ERR_NEEDMOREPARAMS (461)
+		assert(3 == m.params.size());
+		assert_eq("alice", m.params[0]);
+		assert_eq("JOIN", m.params[1]);
+		assert_eq(RED "Not enough parameters" RESET, m.params[2]);
+	}
+	{ // unnamed client is *
+		Client client = Client();
+		Message m = numericReply(42, REPLY_NOTREGISTERED, client);
+		assert(2 == m.params.size());
+		assert_eq("*", m.params[0]);
+	}
+	{ // replies without fixed text only carry the given params
+		Client client = Client();
+		client.setNick("bob");
+		Message m = numericReply(42, REPLY_TOPIC, client, "#test", "the topic");
+		assert(3 == m.params.size());
+		assert_eq("the topic", m.params.back());
+	}
+	{ // every reply of the table is rendered
+		for (int id = 0; id < REPLY_COUNT; ++id)
+			assert(!replyTemplate(static_cast<e_reply>(id)).numeric.empty());
+	}
+	{ // compact clients get the plain table, the saving is counted
+		Client client = Client();
+		client.setNick("alice");
+		client.caps = CAP_COMPACT;
+		Message m = numericReply(42, REPLY_NEEDMOREPARAMS, client, "JOIN");
+		assert_eq("Not enough parameters", m.params[2]);
+		assert_eq(std::string(RED RESET).size(), m.saved);
+		m = numericReply(42, REPLY_TOPIC, client, "#test", "the topic");
+		assert_eq(0u, m.saved);
+	}
+	{ // both tables only differ by the colors
+		for (int id = 0; id < REPLY_COUNT; ++id)
+		{
+			const ReplyTemplate &colored = replyTemplate(static_cast<e_reply>(id));
+			const ReplyTemplate &plain = replyTemplate(static_cast<e_reply>(id), true);
+			assert_eq(colored.numeric, plain.numeric);
+			assert_eq(colored.params.size(), plain.params.size());
+			assert(plain.color.empty() && plain.reset.empty());
+			assert_eq(colored.color.size() + colored.reset.size(), plain.saved);
+		}
+	}
+	TEST_PRINT;
+}
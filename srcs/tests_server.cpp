@@ -1,4 +1,10 @@
+#include <cstring>  // memset(), strncpy(), strlen()
+#include <fcntl.h>  // fcntl(), open()
+#include <sys/stat.h> // stat()
+#include <sys/un.h> // sockaddr_un
+
 #include "tests.hpp"
+#include "Connection.class.hpp"
 #include "handlers.hpp"
 
 void tests_motd()
@@ -34,3 +40,313 @@ void tests_motd()
 	}
 	TEST_PRINT
 }
+
+void tests_cap()
+{
+	TEST("CAP negotiation")
+	{
+		State s;
+		Responses r;
+		capHandler(Message(42, "CAP LS 302"), s, r);
+		assert(1 == r.size());
+		assert_eq(SUPPORTED_CAPS, r[0].params.back());
+	}
+	{
+		State s;
+		Responses r;
+		capHandler(Message(42, "CAP REQ :message-tags server-time"), s, r);
+		assert(1 == r.size());
+		assert_eq("ACK", r[0].params.at(1));
+		assert(s.clients[42].caps == (CAP_MESSAGE_TAGS | CAP_SERVER_TIME));
+	}
+	{ // vendor capability for plain replies
+		State s;
+		Responses r;
+		capHandler(Message(42, "CAP REQ " COMPACT_CAP), s, r);
+		assert(1 == r.size());
+		assert_eq("ACK", r[0].params.at(1));
+		assert(s.clients[42].caps & CAP_COMPACT);
+	}
+	{ // all or nothing
+		State s;
+		Responses r;
+		capHandler(Message(42, "CAP REQ :message-tags unknown"), s, r);
+		assert(1 == r.size());
+		assert_eq("NAK", r[0].params.at(1));
+		assert(0 == s.clients[42].caps);
+	}
+	{ // client tags only relayed to clients with message-tags
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.welcome(43);
+		s.setNick(43, "bob");
+		s.clients[43].caps = CAP_MESSAGE_TAGS;
+		s.welcome(44);
+		s.setNick(44, "charlie");
+		s.addMember(42, "#test");
+		s.addMember(43, "#test");
+		s.addMember(44, "#test");
+		Responses r;
+		tagmsgHandler(Message(42, "@+typing=active;time=x TAGMSG #test"), s, r);
+		assert(1 == r.size());
+		assert_eq(43, r[0].fd);
+		assert_eq("+typing=active", r[0].tags);
+	}
+	TEST_PRINT
+}
+
+void tests_lusers()
+{
+	TEST("LUSERS counters")
+	{
+		State s;
+		s.oper_name = "oper";
+		s.oper_pass = "pass";
+		Client bot;
+		bot.status = WELCOMED;
+		bot.modes.insert('o');
+		s.addClient(BOT_ID, bot);
+		Responses r;
+		messageRouter(Message(42, "NICK alice"), s, r);
+		messageRouter(Message(42, "USER alice 0 * :alice"), s, r);
+		messageRouter(Message(43, "NICK bob"), s, r); // not registered yet
+		messageRouter(Message(42, "JOIN #a,#b"), s, r);
+		messageRouter(Message(42, "OPER oper pass"), s, r);
+		assert_eq(2u, s.n_registered);
+		assert_eq(2u, s.n_opers);
+		assert_eq(1u, s.unregistered());
+
+		r.clear();
+		messageRouter(Message(42, "LUSERS"), s, r);
+		assert_eq(7u, r.size());
+		assert_eq("251", r[0].verb); // RPL_LUSERCLIENT (251)
+		assert_eq("There are 2 users and 0 invisible on 1 servers", r[0].params[1]);
+		assert_eq("2", r[1].params[1]); // RPL_LUSEROP (252)
+		assert_eq("1", r[2].params[1]); // RPL_LUSERUNKNOWN (253)
+		assert_eq("2", r[3].params[1]); // RPL_LUSERCHANNELS (254)
+		assert_eq("265", r[5].verb); // RPL_LOCALUSERS (265)
+
+		messageRouter(Message(42, "MODE alice -o"), s, r);
+		assert_eq(1u, s.n_opers);
+		messageRouter(Message(42, "QUIT"), s, r);
+		assert_eq(1u, s.n_registered);
+		assert_eq(2u, s.max_registered);
+	}
+	TEST_PRINT
+}
+
+static const VerbStats &verbStats(const State &s, const std::string &verb)
+{
+	size_t i = 0;
+	while (i + 1 < STATS_N_VERBS && verb != s.stats.verb(i).verb)
+		++i;
+	return s.stats.verb(i);
+}
+
+void tests_stats()
+{
+	TEST("STATS")
+	{ // a percentile is at most a quarter above the real one
+		LatencyHistogram h;
+		assert_eq(0u, h.percentile(0.5));
+		for (uint64_t nsec = 1; nsec <= 1000; ++nsec)
+			h.add(nsec);
+		assert_eq(1000u, h.count());
+		assert(h.percentile(0.5) >= 500 && h.percentile(0.5) <= 625);
+		assert_eq(1000u, h.percentile(0.99)); // the bucket ends above max
+		assert_eq(1000u, h.max());
+		h.add(1ull << 40); // clamped to the last bucket
+		assert_eq(1ull << 40, h.max());
+	}
+	{ // counted around the dispatch, unknown verbs together
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		Connection connection(s, messageRouter);
+		std::streambuf *logs = std::cout.rdbuf(NULL);
+		connection.feed(42, "PING x\r\nWHOIS a\r\nWHO b\r\n", 24);
+		std::cout.rdbuf(logs);
+		assert_eq(1u, verbStats(s, "PING").latency.count());
+		assert_eq(8u, verbStats(s, "PING").bytes);
+		assert_eq(2u, verbStats(s, "*").latency.count());
+		assert_eq(16u, verbStats(s, "*").bytes);
+
+		Responses r;
+		statsHandler(Message(42, "STATS m"), s, r);
+		assert_eq(3u, r.size());
+		assert_eq("212", r[0].verb); // RPL_STATSCOMMANDS
+		assert_eq("PING", r[0].params[1]);
+		assert_eq("1", r[0].params[2]);
+		assert_eq("8", r[0].params[3]);
+		assert_eq(0u, r[0].params[5].find("p50 "));
+		assert_eq("*", r[1].params[1]);
+		assert_eq("219", r[2].verb); // RPL_ENDOFSTATS
+		assert_eq("m", r[2].params[1]);
+	}
+	{ // each routed verb is counted under its own name
+		for (size_t i = 0; i + 1 < STATS_N_VERBS; ++i)
+		{
+			State s;
+			s.welcome(42);
+			s.setNick(42, "alice");
+			Connection connection(s, messageRouter);
+			std::string line = std::string(s.stats.verb(i).verb) + "\r\n";
+			std::streambuf *logs = std::cout.rdbuf(NULL);
+			connection.feed(42, line.data(), line.size());
+			std::cout.rdbuf(logs);
+			assert_eq(1u, s.stats.verb(i).latency.count());
+			assert_eq(0u, verbStats(s, "*").latency.count());
+		}
+	}
+	{ // uptime and event loop
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		s.start_time = time(0) - 90061;
+		Responses r;
+		statsHandler(Message(42, "STATS u"), s, r);
+		assert_eq(2u, r.size());
+		assert_eq("242", r[0].verb); // RPL_STATSUPTIME
+		assert_eq("Server Up 1 days 1:01:01", r[0].params[1]);
+
+		s.stats.wakeup(3);
+		s.stats.wakeup(0);
+		s.stats.lag(2500);
+		r.clear();
+		statsHandler(Message(42, "STATS e"), s, r);
+		assert_eq(4u, r.size());
+		assert_eq("249", r[0].verb); // RPL_STATSDEBUG
+		assert_eq("event loop: 2 iterations, 1 with ready fds", r[0].params[1]);
+		assert_eq("ready fds per wakeup: 3.00 avg, 3 max", r[1].params[1]);
+		assert_eq("loop lag: p50 2.50us p99 2.50us max 2.50us", r[2].params[1]);
+
+		r.clear();
+		statsHandler(Message(42, "STATS x"), s, r);
+		assert_eq(1u, r.size());
+		assert_eq("219", r[0].verb);
+		r.clear();
+		statsHandler(Message(42, "STATS"), s, r);
+		assert_eq("461", r[0].verb); // ERR_NEEDMOREPARAMS
+	}
+	TEST_PRINT
+}
+
+// a client of the Unix socket at path, non-blocking
+static int connectLocal(const char *path)
+{
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) == ERROR)
+		return (close(fd), ERROR);
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return fd;
+}
+
+// sends request as a scraper, returns the reply, steps is the number
+// of events the scrape took before it was closed
+static std::string scrape(Metrics &m, const State &s, const char *request,
+	size_t &steps)
+{
+	int client = connectLocal("/tmp/ircserv_tests.metrics");
+	int fd = m.accept();
+	if (client == ERROR || fd == ERROR)
+		return "";
+	send(client, request, strlen(request), 0);
+
+	std::string reply;
+	char buffer[4096];
+	short events = POLLIN;
+	for (steps = 0; events; ++steps)
+	{
+		events = m.ready(fd, events, s);
+		ssize_t n;
+		while ((n = recv(client, buffer, sizeof(buffer), 0)) > 0)
+			reply.append(buffer, n);
+	}
+	close(client);
+	return reply;
+}
+
+void tests_metrics()
+{
+	TEST("Metrics")
+	{ // power of two buckets, the last one for all the rest
+		SizeHistogram h;
+		h.add(0);
+		h.add(1);
+		h.add(3);
+		h.add(4);
+		h.add(5);
+		h.add(1 << 30);
+		assert_eq(2u, h.bucket(0));
+		assert_eq(0u, h.bucket(1));
+		assert_eq(2u, h.bucket(2));
+		assert_eq(1u, h.bucket(3));
+		assert_eq(1u, h.bucket(STATS_SIZE_BUCKETS));
+		assert_eq(6u, h.count());
+		assert_eq(13u + (1 << 30), h.sum());
+	}
+	{ // the counters kept by Connection, in the Prometheus text format
+		State s;
+		s.welcome(42);
+		s.setNick(42, "alice");
+		Connection connection(s, messageRouter);
+		std::streambuf *logs = std::cout.rdbuf(NULL);
+		connection.feed(42, "PING x\r\nJOIN #a\r\n", 17);
+		std::cout.rdbuf(logs);
+		size_t queued = connection.pendingOutput(42).size();
+		assert(queued > 0);
+		assert_eq(queued, s.stats.sendQueued());
+		assert_eq(2u, s.stats.fanouts().count());
+
+		std::string text = Metrics::render(s);
+		assert_eq(0u, text.find("HTTP/1.0 200 OK\r\n"));
+		assert(text.find("\nircserv_commands_total{verb=\"PING\"} 1\n")
+			!= std::string::npos);
+		assert(text.find("\nircserv_command_bytes_total{verb=\"JOIN\"} 9\n")
+			!= std::string::npos);
+		assert(text.find("\nircserv_sendq_bytes " + size_to_str(queued) + "\n")
+			!= std::string::npos);
+		assert(text.find("\nircserv_fanout_messages_bucket{le=\"+Inf\"} 2\n")
+			!= std::string::npos);
+		assert(text.find("\n# TYPE ircserv_command_duration_seconds summary\n")
+			!= std::string::npos);
+		assert(text.find("\nircserv_log_dropped_total 0\n") != std::string::npos);
+	}
+	{ // served one family per event, then closed
+		State s;
+		s.start_time = time(0);
+		Metrics m;
+		assert_eq(OK, m.listen("/tmp/ircserv_tests.metrics"));
+		assert(m.owns(m.listenFd()));
+		size_t steps;
+		std::string before = Metrics::render(s); // unless a second passes
+		std::string reply = scrape(m, s, "GET /metrics HTTP/1.1\r\n\r\n", steps);
+		assert(reply == before || reply == Metrics::render(s));
+		assert(steps > 5);
+
+		reply = scrape(m, s, "GET / HTTP/1.1\r\nHost: x\r\n\r\n", steps);
+		assert_eq(0u, reply.find("HTTP/1.0 404"));
+		assert_eq(false, m.owns(-1));
+
+		struct stat st;
+		assert_eq(0, stat("/tmp/ircserv_tests.metrics", &st));
+		assert_eq(0600, (int)(st.st_mode & 0777)); // the owner only
+	}
+	{ // a path that is not a socket is left alone
+		const char *path = "/tmp/ircserv_tests.file";
+		close(open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600));
+		Metrics m;
+		std::streambuf *err = std::cerr.rdbuf(NULL);
+		assert_eq(ERROR, m.listen(path));
+		std::cerr.rdbuf(err);
+		assert_eq(-1, m.listenFd());
+		assert_eq(0, access(path, F_OK));
+		unlink(path);
+	}
+	TEST_PRINT
+}
@@ -2,6 +2,9 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdint.h> // uint64_t
+
+#include <sys/time.h>
 
 #include "colors.hpp"
 
@@ -25,20 +28,6 @@ void	displayFullTime(time_t timestamp)
 	std::cout << std::endl;
 }
 
-void	displayElapsedTime(time_t start)
-{
-	time_t elapsed = time(0) - start;
-	int hours = elapsed / 3600;
-	int minutes = (elapsed % 3600) / 60;
-	int seconds = elapsed % 60;
-
-	// Time
-	std::cout << std::setfill('0') << "["
-		<< std::setw(2) << hours << ":"
-		<< std::setw(2) << minutes << ":"
-		<< std::setw(2) << seconds << "] ";
-}
-
 std::string	timeToStr(time_t start)
 {
 	std::ostringstream oss;
@@ -69,3 +58,31 @@ std::string	dateToStr(time_t start)
 
 	return (oss.str());
 }
+
+// Example: "2024-05-01T12:30:00.042Z", for the server-time tag
+std::string	isoTimeStr()
+{
+	std::ostringstream oss;
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	tm* utcTime = gmtime(&now.tv_sec);
+
+	oss << std::setfill('0')
+		<< (utcTime->tm_year + 1900) << "-"
+		<< std::setw(2) << (utcTime->tm_mon + 1) << "-"
+		<< std::setw(2) << utcTime->tm_mday << "T"
+		<< std::setw(2) << utcTime->tm_hour << ":"
+		<< std::setw(2) << utcTime->tm_min << ":"
+		<< std::setw(2) << utcTime->tm_sec << "."
+		<< std::setw(3) << (now.tv_usec / 1000) << "Z";
+
+	return (oss.str());
+}
+
+uint64_t	monotonicNsec()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}